@@ -0,0 +1,376 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/*
+ * Host side benchmarks for the cxl tool, run against the software emulator
+ * so that only our own code is measured: command dispatch, request
+ * marshalling, decode/print of the large payloads and fw transfer
+ * chunking. Each case prints one JSON object per line.
+ */
+
+/* std includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <ccan/endian/endian.h>
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "cxl_main.h"
+#include "event_decode.h"
+#include <ddr.h>
+#include <parse_option.h>
+#include <util_main.h>
+#include <vendor_commands.h>
+#include <vendor_emu.h>
+#include <vendor_timing.h>
+#include <vendor_types.h>
+
+#define BENCH_DEV "mem0"
+#define BENCH_STATS_LOOPS 64
+#define BENCH_FW_SIZE (64 * 1024)
+#define BENCH_STATS_CHUNK (16 * 1024) /* cxl_cmd_ddr_stats_get() default */
+#define BENCH_EVENT_RECORDS 256
+
+static struct cxlmi_ctx *bench_ctx;
+static struct cxlmi_endpoint *bench_ep;
+static ddr_stats_data_t *bench_stats;
+static char bench_fw_path[] = "/tmp/bench_cxl_fw.XXXXXX";
+static struct cxlmi_event_record bench_events[BENCH_EVENT_RECORDS];
+
+/* The subset of cxl_commands[] the dispatch case goes through */
+static struct cmd_struct bench_cmds[] = {
+    {STR_READ_DDR_TEMP, cmd_read_ddr_temp},
+    {STR_GET_DEVICE_INFO, cmd_get_device_info},
+};
+
+/* Case bodies, one iteration each; non zero return aborts the case */
+static int bench_dispatch(void) {
+  const char *argv[] = {STR_READ_DDR_TEMP, BENCH_DEV, NULL};
+
+  return main_run_internal_command(2, argv, bench_ctx, bench_cmds,
+                                   ARRAY_SIZE(bench_cmds));
+}
+
+static int bench_marshal_spd_read(void) {
+  struct cxlmi_cmd_dimm_spd_read_req req = {
+      .spd_id = 0,
+      .offset = 0,
+      .num_bytes = 512,
+  };
+  struct cxlmi_cmd_dimm_spd_read_rsp rsp;
+
+  return cxlmi_cmd_dimm_spd_read(bench_ep, NULL, &req, &rsp);
+}
+
+static int bench_marshal_health_get(void) {
+  struct cxlmi_cmd_health_counters_get rsp;
+
+  return cxlmi_cmd_health_counters_get(bench_ep, NULL, &rsp);
+}
+
+static int bench_marshal_hpa_to_dpa(void) {
+  struct cxlmi_cmd_hpa_to_dpa_req req = {.hpa_address = 0x2000001000ULL};
+  struct cxlmi_cmd_hpa_to_dpa_rsp rsp;
+
+  return cxlmi_cmd_hpa_to_dpa(bench_ep, NULL, &req, &rsp);
+}
+
+static int bench_ddr_stats_decode(void) {
+  display_pmon_stats(bench_stats, BENCH_STATS_LOOPS);
+  display_cs_pm_stats(bench_stats, BENCH_STATS_LOOPS);
+  display_cs_bank_pm_stats(bench_stats, BENCH_STATS_LOOPS);
+  display_mc_pm_stats(bench_stats, BENCH_STATS_LOOPS);
+  return 0;
+}
+
+/* As watch-events does for each record, for BENCH_EVENT_RECORDS records */
+static int bench_event_decode(void) {
+  const struct cxl_event_decoder *dec;
+  int i;
+
+  for (i = 0; i < BENCH_EVENT_RECORDS; i++) {
+    dec = cxl_event_decoder_find(&bench_events[i]);
+    if (!dec)
+      return -EINVAL;
+    cxl_event_decode_json(dec, &bench_events[i]);
+  }
+  return 0;
+}
+
+static int bench_ddr_stats_get(void) {
+  return cxl_cmd_ddr_stats_get(bench_ep, NULL);
+}
+
+static int bench_ddr_margin_get(void) {
+  return cxl_cmd_ddr_margin_get(bench_ep);
+}
+
+static int bench_ltssm_dump(void) {
+  return cxl_cmd_read_ltssm_states(bench_ep);
+}
+
+static int bench_fw_transfer(void) {
+  struct _update_fw_params params = {
+      .filepath = bench_fw_path,
+      .slot = 2,
+      .hbo = true,
+  };
+
+  return cxl_cmd_update_device_fw(bench_ep, false, &params);
+}
+
+/* One time setup, outside of the measured loop */
+static int bench_setup_stats(void) {
+  struct cxlmi_cmd_ddr_stats_run run = {.loop_count = BENCH_STATS_LOOPS};
+  struct cxlmi_cmd_ddr_stats_get_req req;
+  unsigned char *buf;
+  uint32_t off, n, total = BENCH_STATS_LOOPS * sizeof(ddr_stats_data_t);
+  int rc;
+
+  rc = cxlmi_cmd_ddr_stats_run(bench_ep, NULL, &run);
+  if (rc)
+    return rc;
+
+  if (!bench_stats) {
+    bench_stats = malloc(total);
+    if (!bench_stats)
+      return -ENOMEM;
+  }
+
+  /* the decode case works on what the device would have returned */
+  for (off = 0; off < total; off += n) {
+    n = total - off < BENCH_STATS_CHUNK ? total - off : BENCH_STATS_CHUNK;
+    req.offset = off;
+    req.transfer_sz = n;
+    buf = (unsigned char *)bench_stats + off;
+    rc = cxlmi_cmd_ddr_stats_get(bench_ep, NULL, &req, &buf);
+    if (rc)
+      return rc;
+  }
+  return 0;
+}
+
+/* DRAM records with every field valid, and memory module records */
+static int bench_setup_events(void) {
+  static const uint8_t dram[0x10] = {0x60, 0x1d, 0xcb, 0xb3, 0x9c, 0x06,
+                                     0x4e, 0xab, 0xb8, 0xaf, 0x4e, 0x9b,
+                                     0xfb, 0x5c, 0x96, 0x24};
+  static const uint8_t module[0x10] = {0xfe, 0x92, 0x74, 0x75, 0xdd, 0x59,
+                                       0x43, 0x39, 0xa5, 0x86, 0x79, 0xba,
+                                       0xb1, 0x13, 0xb7, 0x74};
+  struct cxlmi_event_record *r;
+  int i, j;
+
+  for (i = 0; i < BENCH_EVENT_RECORDS; i++) {
+    r = &bench_events[i];
+    memcpy(r->uuid, i % 2 ? module : dram, sizeof(r->uuid));
+    r->length = sizeof(*r);
+    r->handle = cpu_to_le16(i + 1);
+    for (j = 0; j < (int)sizeof(r->data); j++)
+      r->data[j] = i + j * 7;
+    if (!(i % 2)) {
+      r->data[0x0b] = 0x7f;
+      r->data[0x0c] = 0;
+    }
+  }
+  return 0;
+}
+
+static int bench_setup_margin(void) {
+  struct cxlmi_cmd_ddr_margin_run run = {};
+
+  return cxlmi_cmd_ddr_margin_run(bench_ep, NULL, &run);
+}
+
+static int bench_setup_fw(void) {
+  unsigned char block[4096];
+  int fd, i;
+
+  fd = mkstemp(bench_fw_path);
+  if (fd < 0)
+    return -errno;
+
+  for (i = 0; i < (int)sizeof(block); i++)
+    block[i] = i * 31;
+  for (i = 0; i < BENCH_FW_SIZE / (int)sizeof(block); i++) {
+    if (write(fd, block, sizeof(block)) != sizeof(block)) {
+      close(fd);
+      return -EIO;
+    }
+  }
+  close(fd);
+  return 0;
+}
+
+static const struct bench_case {
+  const char *name;
+  int iterations;
+  int (*setup)(void);
+  int (*run)(void);
+} bench_cases[] = {
+    {"dispatch", 2000, NULL, bench_dispatch},
+    {"marshal-spd-read", 20000, NULL, bench_marshal_spd_read},
+    {"marshal-health-get", 20000, NULL, bench_marshal_health_get},
+    {"marshal-hpa-to-dpa", 20000, NULL, bench_marshal_hpa_to_dpa},
+    {"ddr-stats-decode", 200, bench_setup_stats, bench_ddr_stats_decode},
+    {"ddr-stats-get", 200, bench_setup_stats, bench_ddr_stats_get},
+    {"event-decode", 2000, bench_setup_events, bench_event_decode},
+    {"ddr-margin-get", 500, bench_setup_margin, bench_ddr_margin_get},
+    {"ltssm-dump", 5000, NULL, bench_ltssm_dump},
+    {"fw-transfer", 20, bench_setup_fw, bench_fw_transfer},
+};
+
+static int bench_cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+static int bench_run(const struct bench_case *c, int iterations, FILE *out) {
+  _cleanup_free_ uint64_t *ns = NULL;
+  uint64_t start, total = 0;
+  int i, rc;
+
+  ns = calloc(iterations, sizeof(*ns));
+  if (!ns)
+    return -ENOMEM;
+
+  if (c->setup) {
+    rc = c->setup();
+    if (rc) {
+      fprintf(stderr, "%s: setup failed (%d)\n", c->name, rc);
+      return rc;
+    }
+  }
+
+  /* one untimed pass to fault in buffers and warm the caches */
+  rc = c->run();
+  for (i = 0; i < iterations && !rc; i++) {
+    start = cxlmi_timing_now();
+    rc = c->run();
+    ns[i] = cxlmi_timing_now() - start;
+    total += ns[i];
+  }
+  if (rc) {
+    fprintf(stderr, "%s: failed at iteration %d (%d)\n", c->name, i, rc);
+    return rc;
+  }
+
+  qsort(ns, iterations, sizeof(*ns), bench_cmp_u64);
+  fprintf(out,
+          "{\"name\": \"%s\", \"iterations\": %d, \"total_ns\": %lu, "
+          "\"mean_ns\": %lu, \"min_ns\": %lu, \"p50_ns\": %lu, "
+          "\"p90_ns\": %lu, \"p99_ns\": %lu, \"max_ns\": %lu}\n",
+          c->name, iterations, (unsigned long)total,
+          (unsigned long)(total / iterations), (unsigned long)ns[0],
+          (unsigned long)ns[iterations / 2],
+          (unsigned long)ns[iterations * 90 / 100],
+          (unsigned long)ns[iterations * 99 / 100],
+          (unsigned long)ns[iterations - 1]);
+  fflush(out);
+
+  return 0;
+}
+
+static struct _bench_params {
+  int iterations;
+  const char *output;
+  bool list;
+} bench_params;
+
+static const struct option bench_options[] = {
+    OPT_INTEGER('n', "iterations", &bench_params.iterations,
+                "iterations per case (default: per case)"),
+    OPT_STRING('o', "output", &bench_params.output, "file",
+               "append JSON results to <file> instead of stdout"),
+    OPT_BOOLEAN('l', "list", &bench_params.list, "list the cases and exit"),
+    OPT_END(),
+};
+
+int main(int argc, const char **argv) {
+  const char *const u[] = {"bench_cxl [<case>..] [<options>]", NULL};
+  FILE *out;
+  int i, j, devnull, rc = 0, ran = 0;
+
+  argc = parse_options(argc, argv, bench_options, u, 0);
+
+  if (bench_params.list) {
+    for (i = 0; i < (int)ARRAY_SIZE(bench_cases); i++)
+      printf("%s\n", bench_cases[i].name);
+    return 0;
+  }
+
+  /* a zero latency emulated device unless the caller configured one */
+  setenv("CXL_EMU", BENCH_DEV, 0);
+  setenv("CXL_EMU_BG", "0", 0);
+  if (cxlmi_emu_init() || !cxlmi_emu_enabled())
+    return EXIT_FAILURE;
+
+  if (bench_params.output)
+    out = fopen(bench_params.output, "a");
+  else
+    out = fdopen(dup(STDOUT_FILENO), "w");
+  if (!out) {
+    fprintf(stderr, "cannot open output: %s\n", strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  /* the decode paths print; send that to /dev/null, but still format it */
+  fflush(stdout);
+  devnull = open("/dev/null", O_WRONLY);
+  if (devnull < 0 || dup2(devnull, STDOUT_FILENO) < 0) {
+    fprintf(stderr, "cannot redirect stdout: %s\n", strerror(errno));
+    return EXIT_FAILURE;
+  }
+  close(devnull);
+
+  bench_ctx = cxlmi_new_ctx(stdout, DEFAULT_LOGLEVEL);
+  if (!bench_ctx)
+    return EXIT_FAILURE;
+  /* dispatch goes through cmd_action(), which must not close bench_ep */
+  cmd_keep_endpoints_open(true);
+  bench_ep = cmd_open_ep(bench_ctx, BENCH_DEV);
+  if (!bench_ep) {
+    fprintf(stderr, "cannot open emulated '%s'\n", BENCH_DEV);
+    rc = EXIT_FAILURE;
+    goto out;
+  }
+
+  for (i = 0; i < (int)ARRAY_SIZE(bench_cases); i++) {
+    const struct bench_case *c = &bench_cases[i];
+    bool wanted = argc == 0;
+
+    for (j = 0; j < argc && !wanted; j++)
+      wanted = strcmp(argv[j], c->name) == 0;
+    if (!wanted)
+      continue;
+
+    ran++;
+    if (bench_run(c,
+                  bench_params.iterations > 0 ? bench_params.iterations
+                                              : c->iterations,
+                  out))
+      rc = EXIT_FAILURE;
+  }
+  if (!ran) {
+    fprintf(stderr, "no such case, see --list\n");
+    rc = EXIT_FAILURE;
+  }
+
+  cmd_close_ep(bench_ep);
+out:
+  if (bench_fw_path[strlen(bench_fw_path) - 1] != 'X')
+    unlink(bench_fw_path);
+  cxlmi_free_ctx(bench_ctx);
+  fclose(out);
+
+  return rc;
+}
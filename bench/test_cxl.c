@@ -0,0 +1,585 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/*
+ * Host side unit checks for the cxl tool, run against the software
+ * emulator like the benchmarks next to them. Each case reports what it
+ * found wrong on stderr and fails.
+ */
+
+/* std includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <ccan/endian/endian.h>
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "cxl_main.h"
+#include "ddr_stats_export.h"
+#include "ep_select.h"
+#include "event_decode.h"
+#include "fw_checkpoint.h"
+#include <ddr.h>
+#include <parse_option.h>
+#include <util_main.h>
+#include <vendor_commands.h>
+#include <vendor_crc.h>
+#include <vendor_emu.h>
+#include <vendor_types.h>
+
+#define TEST_DEV "mem0"
+#define TEST_DEVS "mem0,mem1,mem3"
+#define TEST_STATS_LOOPS 8
+#define TEST_STATS_CHUNK (16 * 1024)
+#define TEST_STATS_NR_COLS 341
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #cond);                                                          \
+      return -1;                                                               \
+    }                                                                          \
+  } while (0)
+
+static struct cxlmi_ctx *test_ctx;
+static struct cxlmi_endpoint *test_ep;
+static char test_dir[] = "/tmp/test_cxl.XXXXXX";
+
+static int test_select(const char *sel, int nr_expect, const char *expect) {
+  struct ep_table tbl;
+  char names[128] = "";
+  int i, rc;
+
+  rc = ep_select(&tbl, 1, &sel);
+  if (rc < 0)
+    return rc;
+  for (i = 0; i < tbl.nr; i++)
+    snprintf(names + strlen(names), sizeof(names) - strlen(names), "%s%s",
+             i ? " " : "", tbl.ents[i].name);
+  ep_table_free(&tbl);
+
+  if (rc != nr_expect || strcmp(names, expect)) {
+    fprintf(stderr, "'%s' selected %d: '%s', expected %d: '%s'\n", sel, rc,
+            names, nr_expect, expect);
+    return -1;
+  }
+  return 0;
+}
+
+static int test_ep_select(void) {
+  const char *argv[] = {"mem3", "mem[0-3]", "mem0", "mem*"};
+  struct ep_table tbl;
+
+  CHECK(test_select("all", 3, "mem0 mem1 mem3") == 0);
+  CHECK(test_select("mem[1-3]", 2, "mem1 mem3") == 0);
+  CHECK(test_select("mem[2-2]", 0, "") == 0);
+  CHECK(test_select("mem[3-1]", 0, "") == 0);
+  CHECK(test_select("mem[1-3", 0, "") == 0);
+  CHECK(test_select("mem?", 3, "mem0 mem1 mem3") == 0);
+  CHECK(test_select("cxl0", 0, "") == 0);
+  /* a plain name is taken as it is, present or not */
+  CHECK(test_select("mem7", 1, "mem7") == 0);
+
+  /* in the order given, each endpoint once */
+  CHECK(ep_select(&tbl, ARRAY_SIZE(argv), argv) == 3);
+  CHECK(strcmp(tbl.ents[0].name, "mem3") == 0);
+  CHECK(strcmp(tbl.ents[1].name, "mem0") == 0);
+  CHECK(strcmp(tbl.ents[2].name, "mem1") == 0);
+  ep_table_free(&tbl);
+  CHECK(tbl.nr == 0 && !tbl.ents);
+
+  return 0;
+}
+
+static int test_fw_checkpoint(void) {
+  struct fw_checkpoint ck, got, other;
+  char path[PATH_MAX];
+  int fd, rc;
+
+  snprintf(path, sizeof(path), "%s/fw", test_dir);
+  setenv("CXL_FW_CKPT_DIR", path, 1);
+
+  CHECK(fw_checkpoint_load(test_ep, &got) == -ENOENT);
+
+  CHECK(fw_checkpoint_init(&ck, test_ep, 0x0201, 2, 65536, 0x12345678) == 0);
+  ck.block_size = 128;
+  ck.nr_blocks = 512;
+  ck.next_block = 100;
+
+  fd = fw_checkpoint_open(test_ep);
+  CHECK(fd >= 0);
+  rc = fw_checkpoint_write(fd, &ck);
+  ck.next_block = 101;
+  if (!rc)
+    rc = fw_checkpoint_write(fd, &ck);
+  close(fd);
+  CHECK(rc == 0);
+
+  /* the later write replaced the earlier one */
+  CHECK(fw_checkpoint_load(test_ep, &got) == 0);
+  CHECK(memcmp(&got, &ck, sizeof(ck)) == 0);
+  CHECK(fw_checkpoint_match(&got, &ck));
+
+  /* progress does not matter, what is being sent where does */
+  other = ck;
+  other.block_size = 64;
+  other.next_block = 7;
+  CHECK(fw_checkpoint_match(&got, &other));
+  other = ck;
+  other.slot = 3;
+  CHECK(!fw_checkpoint_match(&got, &other));
+  other = ck;
+  other.image_hash ^= 1;
+  CHECK(!fw_checkpoint_match(&got, &other));
+  other = ck;
+  other.image_size += 128;
+  CHECK(!fw_checkpoint_match(&got, &other));
+  other = ck;
+  other.serial ^= 1;
+  CHECK(!fw_checkpoint_match(&got, &other));
+
+  /* nothing left to resume */
+  fd = fw_checkpoint_open(test_ep);
+  CHECK(fd >= 0);
+  ck.next_block = ck.nr_blocks;
+  rc = fw_checkpoint_write(fd, &ck);
+  close(fd);
+  CHECK(rc == 0);
+  CHECK(fw_checkpoint_load(test_ep, &got) == -ENOENT);
+
+  fw_checkpoint_remove(test_ep);
+  CHECK(fw_checkpoint_load(test_ep, &got) == -ENOENT);
+  CHECK(rmdir(path) == 0);
+
+  return 0;
+}
+
+/* Bit at a time, independent of both the table and the instructions */
+static uint32_t test_crc32c_ref(uint32_t crc, const unsigned char *p,
+                                size_t len) {
+  int i;
+
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    for (i = 0; i < 8; i++)
+      crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+  }
+  return ~crc;
+}
+
+/* Run once as is and once with CXL_CRC32C=sw, see vendor_crc.h */
+static int test_crc32c(void) {
+  static unsigned char buf[4096 + 16];
+  uint32_t crc;
+  size_t off, len, split;
+
+  CHECK(cxlmi_crc32c(0, "", 0) == 0);
+  CHECK(cxlmi_crc32c(0, "123456789", 9) == 0xe3069283);
+  memset(buf, 0, 32);
+  CHECK(cxlmi_crc32c(0, buf, 32) == 0x8a9136aa);
+  memset(buf, 0xff, 32);
+  CHECK(cxlmi_crc32c(0, buf, 32) == 0x62a8ab43);
+
+  for (off = 0; off < sizeof(buf); off++)
+    buf[off] = off * 131 + (off >> 7);
+
+  /* every alignment, around the 8 byte steps of both implementations */
+  for (off = 0; off < 16; off++) {
+    for (len = 0; len <= 80; len++)
+      CHECK(cxlmi_crc32c(0, buf + off, len) ==
+            test_crc32c_ref(0, buf + off, len));
+    CHECK(cxlmi_crc32c(0, buf + off, 4096) ==
+          test_crc32c_ref(0, buf + off, 4096));
+  }
+
+  /* chained over any split is the same as in one go */
+  for (split = 0; split <= 64; split++) {
+    crc = cxlmi_crc32c(0, buf + 3, split);
+    crc = cxlmi_crc32c(crc, buf + 3 + split, 1000 - split);
+    CHECK(crc == cxlmi_crc32c(0, buf + 3, 1000));
+  }
+
+  return 0;
+}
+
+static int test_handles(const char *list, const char *from, int nr_expect,
+                        const struct cxl_event_handle *expect) {
+  _cleanup_free_ struct cxl_event_handle *handles = NULL;
+  int i, rc;
+
+  rc = cxl_parse_event_handles(test_ep, 1, list, from, &handles);
+  for (i = 0; i < rc && i < nr_expect; i++) {
+    if (handles[i].handle != expect[i].handle ||
+        handles[i].timestamp != expect[i].timestamp)
+      break;
+  }
+  if (rc != nr_expect || i < rc) {
+    fprintf(stderr, "'%s' gave %d handle(s), expected %d\n", list, rc,
+            nr_expect);
+    return -1;
+  }
+  return 0;
+}
+
+/* A line as get-event-records --output writes it, see event_page_persist() */
+static void test_event_line(FILE *fp, const char *dev, int log,
+                            uint16_t handle, uint64_t timestamp) {
+  struct cxlmi_event_record r;
+  size_t i;
+
+  memset(&r, 0, sizeof(r));
+  r.length = sizeof(r);
+  r.handle = cpu_to_le16(handle);
+  r.timestamp = cpu_to_le64(timestamp);
+  fprintf(fp, "%s %d 0x%04x ", dev, log, handle);
+  for (i = 0; i < sizeof(r); i++)
+    fprintf(fp, "%02x", ((const uint8_t *)&r)[i]);
+  fprintf(fp, "\n");
+}
+
+static int test_event_handles(void) {
+  static const struct cxl_event_handle list[] = {
+      {0x10, 0}, {0x12, 0}, {0x13, 0}, {0x14, 0}};
+  static const struct cxl_event_handle merged[] = {
+      {0x5, 100}, {0x10, 0}, {0x10, 300}, {0x13, 0}, {0x2a, 200}};
+  char path[PATH_MAX];
+  FILE *fp;
+  int rc;
+
+  CHECK(test_handles("10,0x12-0x14,12", NULL, 4, list) == 0);
+  CHECK(test_handles("0x14,0X13,12-12,0x10,0x13", NULL, 4, list) == 0);
+  CHECK(test_handles("ffff", NULL, 1,
+                     (const struct cxl_event_handle[]){{0xffff, 0}}) == 0);
+  CHECK(test_handles("", NULL, 0, NULL) == 0);
+
+  CHECK(test_handles("zz", NULL, -EINVAL, NULL) == 0);
+  CHECK(test_handles(",0x10", NULL, -EINVAL, NULL) == 0);
+  CHECK(test_handles("0x10;0x11", NULL, -EINVAL, NULL) == 0);
+  CHECK(test_handles("-5", NULL, -EINVAL, NULL) == 0);
+  CHECK(test_handles("0x14-0x12", NULL, -ERANGE, NULL) == 0);
+  CHECK(test_handles("0x10000", NULL, -ERANGE, NULL) == 0);
+
+  /* records of this device and log only, each with its timestamp */
+  snprintf(path, sizeof(path), "%s/events", test_dir);
+  fp = fopen(path, "w");
+  CHECK(fp);
+  test_event_line(fp, TEST_DEV, 1, 0x5, 100);
+  test_event_line(fp, TEST_DEV, 1, 0x2a, 200);
+  test_event_line(fp, TEST_DEV, 1, 0x2a, 200);
+  test_event_line(fp, TEST_DEV, 2, 0x7, 100);
+  test_event_line(fp, "mem1", 1, 0x8, 100);
+  test_event_line(fp, TEST_DEV, 1, 0x10, 300);
+  /* a handle without its record cannot be told from a reused one */
+  fprintf(fp, "%s 1 0x0011 0000\n", TEST_DEV);
+  fprintf(fp, "garbage\n");
+  fclose(fp);
+
+  rc = test_handles("0x10,0x13", path, 5, merged);
+  unlink(path);
+  CHECK(rc == 0);
+  CHECK(test_handles(NULL, path, -ENOENT, NULL) == 0);
+
+  return 0;
+}
+
+static const struct cxl_event_field *
+test_event_field(const struct cxl_event_decoder *dec, const char *name) {
+  int i;
+
+  for (i = 0; i < dec->nr_fields; i++) {
+    if (strcmp(dec->fields[i].name, name) == 0)
+      return &dec->fields[i];
+  }
+  return NULL;
+}
+
+#define EVENT_FIELD(dec, name)                                                 \
+  ({                                                                           \
+    const struct cxl_event_field *__f = test_event_field(dec, name);           \
+    CHECK(__f);                                                                \
+    __f;                                                                       \
+  })
+
+static int test_event_decode(void) {
+  /* 601dcbb3-9c06-4eab-b8af-4e9bfb5c9624 */
+  static const uint8_t dram[0x10] = {0x60, 0x1d, 0xcb, 0xb3, 0x9c, 0x06,
+                                     0x4e, 0xab, 0xb8, 0xaf, 0x4e, 0x9b,
+                                     0xfb, 0x5c, 0x96, 0x24};
+  /* fe927475-dd59-4339-a586-79bab113b774 */
+  static const uint8_t module[0x10] = {0xfe, 0x92, 0x74, 0x75, 0xdd, 0x59,
+                                       0x43, 0x39, 0xa5, 0x86, 0x79, 0xba,
+                                       0xb1, 0x13, 0xb7, 0x74};
+  const struct cxl_event_decoder *dec;
+  struct cxlmi_event_record r;
+
+  memset(&r, 0, sizeof(r));
+  CHECK(!cxl_event_decoder_find(&r));
+
+  memcpy(r.uuid, dram, sizeof(r.uuid));
+  r.length = sizeof(r);
+  /* dpa 0x123456789abcdec0 with flags 0x2a */
+  memcpy(r.data, "\xea\xde\xbc\x9a\x78\x56\x34\x12", 8);
+  r.data[0x0b] = 0x6b; /* channel, rank, bank_group, row, column */
+  r.data[0x0c] = 0;
+  r.data[0x0d] = 5;
+  r.data[0x0e] = 1;
+  memcpy(r.data + 0x0f, "\x01\x02\x03", 3);
+  r.data[0x12] = 2;
+  r.data[0x13] = 9;
+  memcpy(r.data + 0x14, "\x56\x34\x12", 3);
+  memcpy(r.data + 0x17, "\x34\x12", 2);
+
+  dec = cxl_event_decoder_find(&r);
+  CHECK(dec && strcmp(dec->type, "dram") == 0);
+  CHECK(cxl_event_field_get(&r, EVENT_FIELD(dec, "dpa")) ==
+        0x123456789abcdec0ULL);
+  CHECK(cxl_event_field_get(&r, EVENT_FIELD(dec, "dpa_flags")) == 0x2a);
+  CHECK(cxl_event_field_get(&r, EVENT_FIELD(dec, "channel")) == 5);
+  CHECK(cxl_event_field_get(&r, EVENT_FIELD(dec, "nibble_mask")) == 0x030201);
+  CHECK(cxl_event_field_get(&r, EVENT_FIELD(dec, "row")) == 0x123456);
+  CHECK(cxl_event_field_get(&r, EVENT_FIELD(dec, "column")) == 0x1234);
+
+  CHECK(cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "dpa")));
+  CHECK(cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "channel")));
+  CHECK(cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "rank")));
+  CHECK(!cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "nibble_mask")));
+  CHECK(cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "bank_group")));
+  CHECK(!cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "bank")));
+  CHECK(cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "row")));
+  CHECK(cxl_event_field_valid(dec, &r, EVENT_FIELD(dec, "column")));
+
+  memset(r.data, 0, sizeof(r.data));
+  memcpy(r.uuid, module, sizeof(r.uuid));
+  memcpy(r.data + 0x05, "\xf6\xff", 2); /* -10 C */
+  memcpy(r.data + 0x07, "\x04\x03\x02\x01", 4);
+
+  dec = cxl_event_decoder_find(&r);
+  CHECK(dec && strcmp(dec->type, "memory_module") == 0);
+  CHECK((int64_t)cxl_event_field_get(
+            &r, EVENT_FIELD(dec, "device_temperature")) == -10);
+  CHECK(cxl_event_field_get(&r, EVENT_FIELD(dec, "dirty_shutdown_count")) ==
+        0x01020304);
+  CHECK(cxl_event_field_valid(dec, &r,
+                              EVENT_FIELD(dec, "device_temperature")));
+
+  return 0;
+}
+
+static int test_stats_col(const uint8_t *map, const ddr_stats_data_t *raw,
+                          const char *name, uint8_t type, size_t src) {
+  const struct ddr_stats_col_hdr *hdr = (const void *)map;
+  const struct ddr_stats_col_desc *desc =
+      (const void *)(map + le32_to_cpu(hdr->hdr_size));
+  const struct ddr_stats_col_desc *d = NULL;
+  uint32_t i, width = type == DDR_STATS_COL_U64 ? 8 : 4;
+
+  for (i = 0; i < le32_to_cpu(hdr->nr_cols) && !d; i++) {
+    if (strncmp(desc[i].name, name, sizeof(desc[i].name)) == 0)
+      d = &desc[i];
+  }
+  CHECK(d);
+  CHECK(d->type == type && d->width == width);
+  CHECK(le64_to_cpu(d->offset) % DDR_STATS_COL_ALIGN == 0);
+
+  for (i = 0; i < TEST_STATS_LOOPS; i++)
+    CHECK(memcmp(map + le64_to_cpu(d->offset) + (size_t)i * width,
+                 (const uint8_t *)&raw[i] + src, width) == 0);
+  return 0;
+}
+
+/* What the device returned, for the export to be checked against */
+static int test_stats_raw(ddr_stats_data_t *raw) {
+  struct cxlmi_cmd_ddr_stats_get_req req;
+  uint32_t off, n, total = TEST_STATS_LOOPS * sizeof(*raw);
+  unsigned char *buf;
+  int rc;
+
+  for (off = 0; off < total; off += n) {
+    n = total - off < TEST_STATS_CHUNK ? total - off : TEST_STATS_CHUNK;
+    req.offset = off;
+    req.transfer_sz = n;
+    buf = (unsigned char *)raw + off;
+    rc = cxlmi_cmd_ddr_stats_get(test_ep, NULL, &req, &buf);
+    if (rc)
+      return rc;
+  }
+  return 0;
+}
+
+static int test_ddr_stats_export(void) {
+  struct cxlmi_cmd_ddr_stats_run run = {.loop_count = TEST_STATS_LOOPS};
+  _cleanup_free_ ddr_stats_data_t *raw = NULL;
+  const struct ddr_stats_col_hdr *hdr;
+  const struct ddr_stats_col_desc *desc;
+  char path[PATH_MAX];
+  struct stat st;
+  uint8_t *map;
+  uint32_t i;
+  int fd, rc;
+
+  raw = calloc(TEST_STATS_LOOPS, sizeof(*raw));
+  CHECK(raw);
+
+  CHECK(cxlmi_cmd_ddr_stats_run(test_ep, NULL, &run) == 0);
+  CHECK(cxl_cmd_ddr_stats_get(test_ep, test_dir) == 0);
+  CHECK(test_stats_raw(raw) == 0);
+
+  snprintf(path, sizeof(path), "%s/%s-ddr-stats.col", test_dir, TEST_DEV);
+  fd = open(path, O_RDONLY);
+  CHECK(fd >= 0);
+  unlink(path);
+  rc = fstat(fd, &st);
+  map = rc ? MAP_FAILED : mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  CHECK(map != MAP_FAILED);
+
+  hdr = (const void *)map;
+  desc = (const void *)(map + le32_to_cpu(hdr->hdr_size));
+  rc = -1;
+  if (memcmp(hdr->magic, DDR_STATS_COL_MAGIC, sizeof(hdr->magic)) ||
+      le32_to_cpu(hdr->version) != DDR_STATS_COL_VERSION ||
+      le32_to_cpu(hdr->hdr_size) != sizeof(*hdr) ||
+      le32_to_cpu(hdr->desc_size) != sizeof(*desc) ||
+      le64_to_cpu(hdr->file_size) != (uint64_t)st.st_size ||
+      strcmp(hdr->devname, TEST_DEV)) {
+    fprintf(stderr, "%s: bad header\n", path);
+    goto out;
+  }
+  if (le32_to_cpu(hdr->nr_cols) != TEST_STATS_NR_COLS ||
+      le64_to_cpu(hdr->nr_rows) != TEST_STATS_LOOPS) {
+    fprintf(stderr, "%s: %u columns of %llu rows\n", path,
+            le32_to_cpu(hdr->nr_cols),
+            (unsigned long long)le64_to_cpu(hdr->nr_rows));
+    goto out;
+  }
+
+  /* every column in the file, none overlapping the next */
+  for (i = 0; i < TEST_STATS_NR_COLS; i++) {
+    if (le64_to_cpu(desc[i].offset) +
+            (uint64_t)TEST_STATS_LOOPS * desc[i].width >
+        (i + 1 < TEST_STATS_NR_COLS ? le64_to_cpu(desc[i + 1].offset)
+                                    : (uint64_t)st.st_size)) {
+      fprintf(stderr, "%s: column %.48s out of place\n", path, desc[i].name);
+      goto out;
+    }
+  }
+
+  if (test_stats_col(map, raw, "pmon.fr_cnt", DDR_STATS_COL_U64,
+                     offsetof(struct ddr_data, pmon.fr_cnt)) ||
+      test_stats_col(map, raw, "cs_pm.act_cnt.cs2", DDR_STATS_COL_U32,
+                     offsetof(struct ddr_data, cs_pm[2].act_cnt)) ||
+      test_stats_col(
+          map, raw, "cs_bank_pm.bank_rd_cnt.cs3.bank15", DDR_STATS_COL_U32,
+          offsetof(struct ddr_data, cs_bank_pm[3][15].bank_rd_cnt)) ||
+      test_stats_col(map, raw, "mc_pm.same_addr_rr_collision",
+                     DDR_STATS_COL_U32,
+                     offsetof(struct ddr_data, mc_pm.same_addr_rr_collision)))
+    goto out;
+  rc = 0;
+
+out:
+  munmap(map, st.st_size);
+  return rc;
+}
+
+static const struct test_case {
+  const char *name;
+  int (*run)(void);
+} test_cases[] = {
+    {"ep-select", test_ep_select},
+    {"fw-checkpoint", test_fw_checkpoint},
+    {"crc32c", test_crc32c},
+    {"event-handles", test_event_handles},
+    {"event-decode", test_event_decode},
+    {"ddr-stats-export", test_ddr_stats_export},
+};
+
+static struct _test_params {
+  bool list;
+} test_params;
+
+static const struct option test_options[] = {
+    OPT_BOOLEAN('l', "list", &test_params.list, "list the cases and exit"),
+    OPT_END(),
+};
+
+int main(int argc, const char **argv) {
+  const char *const u[] = {"test_cxl [<case>..] [<options>]", NULL};
+  int i, j, rc = 0, ran = 0;
+
+  argc = parse_options(argc, argv, test_options, u, 0);
+
+  if (test_params.list) {
+    for (i = 0; i < (int)ARRAY_SIZE(test_cases); i++)
+      printf("%s\n", test_cases[i].name);
+    return 0;
+  }
+
+  /* ep-select expects exactly these, whatever the caller configured */
+  setenv("CXL_EMU", TEST_DEVS, 1);
+  setenv("CXL_EMU_BG", "0", 0);
+  if (cxlmi_emu_init() || !cxlmi_emu_enabled())
+    return EXIT_FAILURE;
+
+  if (!mkdtemp(test_dir)) {
+    fprintf(stderr, "cannot create %s: %s\n", test_dir, strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  test_ctx = cxlmi_new_ctx(stdout, DEFAULT_LOGLEVEL);
+  if (!test_ctx) {
+    rc = EXIT_FAILURE;
+    goto out;
+  }
+  cmd_keep_endpoints_open(true);
+  test_ep = cmd_open_ep(test_ctx, TEST_DEV);
+  if (!test_ep) {
+    fprintf(stderr, "cannot open emulated '%s'\n", TEST_DEV);
+    rc = EXIT_FAILURE;
+    goto out;
+  }
+
+  for (i = 0; i < (int)ARRAY_SIZE(test_cases); i++) {
+    const struct test_case *c = &test_cases[i];
+    bool wanted = argc == 0;
+
+    for (j = 0; j < argc && !wanted; j++)
+      wanted = strcmp(argv[j], c->name) == 0;
+    if (!wanted)
+      continue;
+
+    ran++;
+    if (c->run()) {
+      fprintf(stderr, "%s: FAIL\n", c->name);
+      rc = EXIT_FAILURE;
+    } else {
+      fprintf(stderr, "%s: ok\n", c->name);
+    }
+  }
+  if (!ran) {
+    fprintf(stderr, "no such case, see --list\n");
+    rc = EXIT_FAILURE;
+  }
+
+  cmd_close_ep(test_ep);
+out:
+  cxlmi_free_ctx(test_ctx);
+  if (rmdir(test_dir))
+    fprintf(stderr, "%s: %s\n", test_dir, strerror(errno));
+
+  return rc;
+}
@@ -16,12 +16,40 @@ extern "C" {
 /* vendor includes */
 #include <util_main.h>
 
+/* Event logs, in Get Event Records log type order */
+#define CXL_EVENT_LOG_NR 4
+#define CXL_EVENT_FLAG_OVERFLOW 0x01
+#define CXL_EVENT_FLAG_MORE_RECORDS 0x02
+/* When payload_max cannot be read: the largest mailbox payload there is */
+#define CXL_EVENT_PAGE_MAX (1 << 20)
+
+extern const char *const cxl_event_log_names[CXL_EVENT_LOG_NR];
+
 /* Helper structures */
 struct _update_fw_params {
   const char *filepath;
   uint32_t slot;
   bool hbo;
   bool mock;
+  /* continue a transfer left open by a timeout, see fw_checkpoint.h */
+  bool resume;
+  /* optional, hex crc32c the image must have before anything is sent */
+  const char *crc32c;
+  /* print a throughput and latency summary, see fw_telemetry.h */
+  bool telemetry;
+  /* the same as JSON lines, plus one line per block as it completes */
+  bool telemetry_json;
+  /* optional, called as blocks go out: 0..100 percent of the image sent */
+  void (*progress)(struct cxlmi_endpoint *ep, int percent);
+};
+
+/*
+ * An event record to clear: its handle and the timestamp it had when it was
+ * listed, or 0 for a handle given by hand, which matches any record.
+ */
+struct cxl_event_handle {
+  uint16_t handle;
+  uint64_t timestamp;
 };
 
 /* shell command handlers  */
@@ -34,6 +62,8 @@ int cmd_set_alert_config(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_get_health_info(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_get_fw_info(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_update_fw(int argc, const char **argv, struct cxlmi_ctx *ctx);
+int cmd_activate_fw(int argc, const char **argv, struct cxlmi_ctx *ctx);
+int cmd_rollout(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_get_timestamp(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_set_timestamp(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_get_event_records(int argc, const char **argv, struct cxlmi_ctx *ctx);
@@ -80,6 +110,7 @@ int cmd_ddr_init_status(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_get_membridge_stats(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_ddr_err_inj_en(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_trigger_coredump(int argc, const char **argv, struct cxlmi_ctx *ctx);
+int cmd_collect_coredump(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_ddr_stats_run(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_ddr_stats_get(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_ddr_param_set(int argc, const char **argv, struct cxlmi_ctx *ctx);
@@ -113,12 +144,16 @@ int cmd_cxl_err_cntr_get(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_ddr_freq_get(int argc, const char **argv, struct cxlmi_ctx *ctx);
 int cmd_ddr_init_err_info_get(int argc, const char **argv,
                               struct cxlmi_ctx *ctx);
+int cmd_serve(int argc, const char **argv, struct cxlmi_ctx *ctx);
+int cmd_batch(int argc, const char **argv, struct cxlmi_ctx *ctx);
+int cmd_timing_stats(int argc, const char **argv, struct cxlmi_ctx *ctx);
+int cmd_watch_events(int argc, const char **argv, struct cxlmi_ctx *ctx);
 
 /* CXL command handlers */
 int cxl_cmd_identify(struct cxlmi_endpoint *ep);
 int cxl_cmd_get_supported_logs(struct cxlmi_endpoint *ep);
 int cxl_cmd_get_log(struct cxlmi_endpoint *ep, const char *log_uuid,
-                    uint32_t log_size);
+                    uint32_t log_size, const char *output);
 int cxl_cmd_get_alert_config(struct cxlmi_endpoint *ep);
 int cxl_cmd_set_alert_config(struct cxlmi_endpoint *ep,
                              uint32_t alert_prog_threshold,
@@ -130,11 +165,21 @@ int cxl_cmd_get_fw_info(struct cxlmi_endpoint *ep);
 int cxl_cmd_get_os_fw_info(struct cxlmi_endpoint *ep);
 int cxl_cmd_update_device_fw(struct cxlmi_endpoint *ep, bool is_os,
                              struct _update_fw_params *fw_params);
+int cxl_cmd_activate_fw(struct cxlmi_endpoint *ep, bool is_vendor,
+                        uint8_t action, uint8_t slot);
 int cxl_cmd_get_timestamp(struct cxlmi_endpoint *ep);
 int cxl_cmd_set_timestamp(struct cxlmi_endpoint *ep, uint64_t timestamp);
 int cxl_cmd_get_event_records(struct cxlmi_endpoint *ep, uint8_t type);
+int cxl_cmd_drain_event_records(struct cxlmi_endpoint *ep, bool clear,
+                                const char *output);
 int cxl_cmd_clear_event_records(struct cxlmi_endpoint *ep, uint8_t type,
-                                uint8_t flags, uint16_t handles);
+                                uint8_t flags,
+                                const struct cxl_event_handle *handles, int nr);
+int cxl_event_clear_handles(struct cxlmi_endpoint *ep, uint8_t type,
+                            const uint16_t *handles, int nr);
+int cxl_parse_event_handles(struct cxlmi_endpoint *ep, uint8_t type,
+                            const char *list, const char *from,
+                            struct cxl_event_handle **handles);
 int cxl_cmd_get_event_interrupt_policy(struct cxlmi_endpoint *ep);
 int cxl_cmd_set_event_interrupt_policy(struct cxlmi_endpoint *ep,
                                        uint32_t interrupt_policy);
@@ -179,9 +224,12 @@ int cxl_cmd_get_membridge_stats(struct cxlmi_endpoint *ep);
 int cxl_cmd_ddr_err_inj_en(struct cxlmi_endpoint *ep, uint32_t ddr_id,
                            uint32_t err_type, uint64_t ecc_fwc_mask);
 int cxl_cmd_trigger_coredump(struct cxlmi_endpoint *ep);
+int cxl_cmd_collect_coredump(struct cxlmi_endpoint *ep, const char *output,
+                             uint32_t timeout_s, bool no_trigger);
 int cxl_cmd_ddr_stats_run(struct cxlmi_endpoint *ep, uint8_t ddr_id,
                           uint32_t monitor_time, uint32_t loop_count);
-int cxl_cmd_ddr_stats_get(struct cxlmi_endpoint *ep);
+/* Text to stdout, or a columnar file (ddr_stats_export.h) with output */
+int cxl_cmd_ddr_stats_get(struct cxlmi_endpoint *ep, const char *output);
 int cxl_cmd_ddr_param_set(struct cxlmi_endpoint *ep, uint32_t ddr_interleave_sz,
                           uint32_t ddr_interleave_ctrl_choice);
 int cxl_cmd_ddr_param_get(struct cxlmi_endpoint *ep);
@@ -219,6 +267,15 @@ int cxl_cmd_ddr_init_err_info_get(struct cxlmi_endpoint *ep);
 
 /* helper functions */
 const char *get_devname(struct cxlmi_endpoint *ep);
+void cmd_keep_endpoints_open(bool keep);
+struct cxlmi_endpoint *cmd_open_ep(struct cxlmi_ctx *ctx, const char *name);
+struct cxlmi_endpoint *cmd_find_open_ep(struct cxlmi_ctx *ctx,
+                                        const char *name);
+void cmd_close_ep(struct cxlmi_endpoint *ep);
+void cxl_handle_internal_command(int argc, const char **argv,
+                                 struct cxlmi_ctx *ctx);
+int cxl_run_internal_command(int argc, const char **argv,
+                             struct cxlmi_ctx *ctx);
 
 #ifdef __cplusplus
 }
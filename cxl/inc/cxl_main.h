@@ -9,6 +9,8 @@ extern "C" {
 #include <stdint.h>
 #include <string.h>
 
+#include <util_main.h>
+
 #define STR_HELP "help"
 
 /* standard commands */
@@ -20,6 +22,7 @@ extern "C" {
 #define STR_GET_HEALTH_INFO "get-health-info"
 #define STR_GET_FW_INFO "get-fw-info"
 #define STR_UPDATE_FW "update-fw"
+#define STR_ACTIVATE_FW "activate-fw"
 #define STR_GET_TIMESTAMP "get-timestamp"
 #define STR_SET_TIMESTAMP "set-timestamp"
 #define STR_GET_EVENT_RECORDS "get-event-records"
@@ -60,6 +63,7 @@ extern "C" {
 #define STR_GET_MEMBRIDGE_STATS "get-cxl-membridge-stats"
 #define STR_DDR_ERR_INJ_EN "ddr-err-inj-en"
 #define STR_TRIGGER_COREDUMP "trigger-coredump"
+#define STR_COLLECT_COREDUMP "collect-coredump"
 #define STR_DDR_STATS_RUN "ddr-stats-run"
 #define STR_DDR_STATS_GET "ddr-stats-get"
 #define STR_DDR_PARAM_SET "ddr-param-set"
@@ -86,6 +90,21 @@ extern "C" {
 #define STR_DDR_FREQ_GET "ddr-freq-get"
 #define STR_DDR_INIT_ERR_INFO_GET "ddr-err-bist-info-get"
 
+/* daemon and batch modes */
+#define STR_SERVE "serve"
+#define STR_SERVE_SOCKET_DEFAULT "/run/cxl.sock"
+#define STR_BATCH "batch"
+#define STR_TIMING_STATS "timing-stats"
+#define STR_WATCH_EVENTS "watch-events"
+
+/* fleet operations */
+#define STR_ROLLOUT "rollout"
+
+/* Every command of the cxl tool, cxl_commands.c */
+extern struct cmd_struct cxl_commands[];
+extern const int cxl_nr_commands;
+extern const char cxl_usage_string[];
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+#ifndef __DDR_STATS_EXPORT_H__
+#define __DDR_STATS_EXPORT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* std includes */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* vendor includes */
+#include <ddr.h>
+
+/*
+ * Columnar export of a DDR stats run, ddr-stats-get -o. ddr_stats_data_t
+ * is transposed into one column per counter, rows being the iterations of
+ * the run, so a tool can mmap() the file and read any counter as a plain
+ * array without parsing text. All integers are little endian.
+ *
+ *   struct ddr_stats_col_hdr                   at 0
+ *   struct ddr_stats_col_desc[nr_cols]         at hdr_size
+ *   column data, nr_rows * width bytes each    at desc->offset, aligned to
+ *                                              DDR_STATS_COL_ALIGN
+ *
+ * Columns are in ddr_stats_data_t order and named after the counter, e.g.
+ * "pmon.fr_cnt", "cs_pm.act_cnt.cs1", "cs_bank_pm.bank_rd_cnt.cs0.bank7",
+ * "mc_pm.read".
+ */
+#define DDR_STATS_COL_MAGIC "CXLDDRST"
+#define DDR_STATS_COL_VERSION 1
+#define DDR_STATS_COL_ALIGN 64
+#define DDR_STATS_COL_NAME_LEN 48
+
+enum ddr_stats_col_type {
+  DDR_STATS_COL_U32 = 1,
+  DDR_STATS_COL_U64 = 2,
+};
+
+struct ddr_stats_col_hdr {
+  char magic[8];
+  uint32_t version;
+  uint32_t hdr_size; /* offset of the first column descriptor */
+  uint64_t nr_rows;
+  uint32_t nr_cols;
+  uint32_t desc_size; /* sizeof(struct ddr_stats_col_desc) */
+  uint64_t file_size;
+  char devname[24];
+} __attribute__((packed));
+
+struct ddr_stats_col_desc {
+  char name[DDR_STATS_COL_NAME_LEN];
+  uint8_t type; /* enum ddr_stats_col_type */
+  uint8_t width; /* bytes per row */
+  uint8_t rsvd[6];
+  uint64_t offset; /* of the column data, from the start of the file */
+} __attribute__((packed));
+
+struct ddr_stats_export;
+
+/*
+ * Create path sized for nr_rows iterations; it is written as path.part
+ * and only renamed to path by a committing ddr_stats_export_close().
+ * Returns 0 or a negative errno.
+ */
+int ddr_stats_export_open(struct ddr_stats_export **exp, const char *path,
+                          const char *devname, uint32_t nr_rows);
+
+/* Scatter iteration 'row' of the run into the columns */
+void ddr_stats_export_row(struct ddr_stats_export *exp,
+                          const ddr_stats_data_t *s, uint32_t row);
+
+/* Sync and rename when commit is set, else drop the partial file */
+int ddr_stats_export_close(struct ddr_stats_export *exp, bool commit);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __DDR_STATS_EXPORT_H__ */
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+#ifndef __EP_POOL_H__
+#define __EP_POOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+/* Upper bound for --jobs, keeps the number of forked workers sane */
+#define EP_POOL_MAX_JOBS 64
+
+/*
+ * Run action() on every endpoint in eps[], with up to 'jobs' endpoints
+ * in flight at once. Each endpoint runs in a forked worker whose stdout
+ * is captured and flushed in eps[] order, so the output is identical to
+ * a serial run. results[i] receives the return code of action(eps[i]).
+ *
+ * jobs <= 1 (or a single endpoint) runs everything inline.
+ *
+ * Returns 0, or -ECHILD when a worker died before action() returned; its
+ * results[] entry is then -ECHILD as well.
+ */
+int ep_pool_run(struct cxlmi_endpoint **eps, int nr_eps, int jobs,
+                int (*action)(struct cxlmi_endpoint *ep), int *results);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __EP_POOL_H__ */
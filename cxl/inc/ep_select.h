@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+#ifndef __EP_SELECT_H__
+#define __EP_SELECT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Where the kernel publishes CXL memdevs */
+#define EP_SYSFS_DEVICES "/sys/bus/cxl/devices"
+#define EP_NAME_MAX 32
+
+struct ep_entry {
+  unsigned int id;
+  char name[EP_NAME_MAX];
+};
+
+/* Endpoint table, sorted by memdev id for discovered entries */
+struct ep_table {
+  struct ep_entry *ents;
+  int nr;
+};
+
+/*
+ * Scan EP_SYSFS_DEVICES once and fill tbl with every memN device, ordered
+ * by id. A missing sysfs directory yields an empty table, not an error.
+ * With CXL_EMU set, the emulated memN devices are listed instead.
+ */
+int ep_discover(struct ep_table *tbl);
+
+/*
+ * Resolve endpoint selectors into sel, without duplicates. Accepted forms:
+ *   memN        a single device (kept even if sysfs does not list it)
+ *   mem[A-B]    every discovered device with A <= id <= B
+ *   mem*, ...   shell glob against discovered device names
+ *   all         every discovered device
+ * Returns the number of selected endpoints or a negative errno.
+ */
+int ep_select(struct ep_table *sel, int argc, const char **argv);
+
+void ep_table_free(struct ep_table *tbl);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __EP_SELECT_H__ */
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+#ifndef __EVENT_DECODE_H__
+#define __EVENT_DECODE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* std includes */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+enum cxl_event_field_fmt {
+  CXL_EVF_HEX,
+  CXL_EVF_DEC,
+  CXL_EVF_S16,       /* signed, e.g. a temperature */
+  CXL_EVF_DPA,       /* physical address: bits 63:6 */
+  CXL_EVF_DPA_FLAGS, /* physical address: bits 5:0 */
+};
+
+/*
+ * One field of an event record payload: width bytes, little endian, at off
+ * in record->data. valid_bit is the bit of the record's validity flags that
+ * says the field is set, or -1 for a field that always is.
+ */
+struct cxl_event_field {
+  const char *name;
+  uint8_t off;
+  uint8_t width;
+  int8_t valid_bit;
+  uint8_t fmt;
+};
+
+struct cxl_event_decoder {
+  uint8_t uuid[0x10];
+  const char *name; /* for text output */
+  const char *type; /* for JSON output */
+  /* offset and width in record->data of the validity flags, width 0: none */
+  uint8_t valid_off;
+  uint8_t valid_width;
+  const struct cxl_event_field *fields;
+  int nr_fields;
+};
+
+/* The decoder for the record's UUID, NULL if there is none */
+const struct cxl_event_decoder *
+cxl_event_decoder_find(const struct cxlmi_event_record *r);
+
+uint64_t cxl_event_field_get(const struct cxlmi_event_record *r,
+                             const struct cxl_event_field *f);
+bool cxl_event_field_valid(const struct cxl_event_decoder *dec,
+                           const struct cxlmi_event_record *r,
+                           const struct cxl_event_field *f);
+
+/* One "name: value" line per valid field */
+void cxl_event_decode_print(const struct cxl_event_decoder *dec,
+                            const struct cxlmi_event_record *r, int indent);
+/* ", "type": ..., "name": value..." to append to a JSON object */
+void cxl_event_decode_json(const struct cxl_event_decoder *dec,
+                           const struct cxlmi_event_record *r);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __EVENT_DECODE_H__ */
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+#ifndef __FW_CHECKPOINT_H__
+#define __FW_CHECKPOINT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* std includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+/*
+ * Progress of a firmware transfer left open on a device, so that a later
+ * update-fw --resume continues with CONTINUE_TRANSFER instead of sending
+ * the image again from block 0. One file per endpoint, rewritten in place
+ * after every acknowledged block:
+ *
+ *   CXL_FW_CKPT_DIR=<path>   checkpoint directory, default
+ *                            FW_CKPT_DIR_DEFAULT (tmpfs, like the transfer
+ *                            state of the device it gets lost on a reboot)
+ */
+#define FW_CKPT_DIR_DEFAULT "/run/cxl/fw"
+
+#define FW_SLOT_REV_LEN 0x10
+
+struct fw_checkpoint {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t opcode;
+  uint64_t serial;
+  uint64_t image_size;
+  uint64_t image_hash; /* crc32c of the image */
+  uint32_t slot;
+  uint32_t block_size;
+  /* first block the device has not acknowledged yet */
+  uint32_t next_block;
+  uint32_t nr_blocks;
+};
+
+/* Fill in the identity fields: device serial, image, opcode and slot */
+int fw_checkpoint_init(struct fw_checkpoint *ck, struct cxlmi_endpoint *ep,
+                       uint16_t opcode, uint32_t slot, size_t image_size,
+                       uint32_t image_crc);
+
+/* Same device, image, opcode and slot; block_size and progress may differ */
+int fw_checkpoint_match(const struct fw_checkpoint *a,
+                        const struct fw_checkpoint *b);
+
+/* 0 and ck filled in, -ENOENT when there is no valid checkpoint for ep */
+int fw_checkpoint_load(struct cxlmi_endpoint *ep, struct fw_checkpoint *ck);
+
+/* Returns an fd for fw_checkpoint_write(), or a negative errno */
+int fw_checkpoint_open(struct cxlmi_endpoint *ep);
+int fw_checkpoint_write(int fd, const struct fw_checkpoint *ck);
+
+void fw_checkpoint_remove(struct cxlmi_endpoint *ep);
+
+/*
+ * The image last written to a slot, recorded next to the checkpoints once
+ * its transfer completed, with the revision the device reported for the
+ * slot afterwards. The device reports no digest of its own; as long as the
+ * slot still reports that revision, get-fw-info can tell which image it
+ * holds.
+ */
+struct fw_slot_record {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t is_os;
+  uint64_t serial;
+  uint64_t image_size;
+  uint32_t image_crc;
+  uint32_t slot;
+  char rev[FW_SLOT_REV_LEN];
+  int64_t stamp;
+};
+
+/* 0 and rec filled in, -ENOENT when no image was recorded for the slot */
+int fw_slot_record_load(struct cxlmi_endpoint *ep, bool is_os, uint32_t slot,
+                        struct fw_slot_record *rec);
+int fw_slot_record_store(struct cxlmi_endpoint *ep,
+                         const struct fw_slot_record *rec);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __FW_CHECKPOINT_H__ */
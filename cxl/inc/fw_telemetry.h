@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+#ifndef __FW_TELEMETRY_H__
+#define __FW_TELEMETRY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* std includes */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+/*
+ * Where the time of a firmware transfer goes: in the transfer commands
+ * (the mailbox), in backoff between retries of busy blocks, or waiting on
+ * hbo_status for each block to be written (the flash). Reported at the end
+ * of update-fw, and with json also as one line per block while it runs.
+ */
+struct fw_telemetry {
+  struct cxlmi_endpoint *ep;
+  bool enabled;
+  bool json;
+  uint64_t start_ns;
+  uint64_t xfer_ns;
+  uint64_t backoff_ns;
+  uint64_t hbo_ns;
+  uint64_t bytes;
+  uint32_t block_size;
+  uint32_t hbo_polls;
+  uint32_t retries;
+  /* per acknowledged block */
+  uint32_t nr;
+  uint32_t cap;
+  uint64_t *xfer_block_ns;
+  uint64_t *hbo_block_ns;
+};
+
+void fw_telemetry_init(struct fw_telemetry *t, struct cxlmi_endpoint *ep,
+                       bool enabled, bool json);
+
+/*
+ * An acknowledged block. The time totals, failed blocks included, are
+ * added to t by the caller as the time is spent.
+ */
+void fw_telemetry_block(struct fw_telemetry *t, int block, int nr_blocks,
+                        uint32_t offset, int bytes, uint64_t xfer_ns,
+                        uint64_t hbo_ns, uint32_t hbo_polls,
+                        uint32_t retries);
+
+/* Print the summary (if enabled) and free the samples */
+void fw_telemetry_report(struct fw_telemetry *t, int rc);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __FW_TELEMETRY_H__ */
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/* std includes */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "cxl_main.h"
+#include <parse_option.h>
+
+#define BATCH_ARGS_MAX 64
+
+static struct _batch_params {
+  bool exit_on_error;
+} batch_params;
+
+#define BATCH_OPTIONS()                                                        \
+  OPT_BOOLEAN('e', "exit-on-error", &batch_params.exit_on_error,               \
+              "stop at the first command that fails")
+
+static const struct option cmd_batch_options[] = {
+    BATCH_OPTIONS(),
+    OPT_END(),
+};
+
+/*
+ * Split one script line into argv[]. Blank lines and lines starting with
+ * '#' yield 0.
+ */
+static int batch_split(char *line, const char **argv) {
+  char *tok, *save = NULL;
+  int argc = 0;
+
+  for (tok = strtok_r(line, " \t\r\n", &save); tok;
+       tok = strtok_r(NULL, " \t\r\n", &save)) {
+    if (argc == 0 && tok[0] == '#')
+      return 0;
+    if (argc == BATCH_ARGS_MAX)
+      return -E2BIG;
+    argv[argc++] = tok;
+  }
+  argv[argc] = NULL;
+
+  return argc;
+}
+
+int cmd_batch(int argc, const char **argv, struct cxlmi_ctx *ctx) {
+  const char *const u[] = {"cxl " STR_BATCH " <file | -> [<options>]", NULL};
+  const char *cmd_argv[BATCH_ARGS_MAX + 1];
+  char *line = NULL;
+  size_t len = 0;
+  int lineno = 0, cmd_argc, rc, failed = 0;
+  FILE *fp;
+
+  argc = parse_options(argc, argv, cmd_batch_options, u, 0);
+  if (argc != 1)
+    usage_with_options(u, cmd_batch_options);
+
+  if (strcmp(argv[0], "-") == 0) {
+    fp = stdin;
+  } else {
+    fp = fopen(argv[0], "r");
+    if (!fp) {
+      fprintf(stderr, "cannot open %s: %s\n", argv[0], strerror(errno));
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* endpoints opened by one command are reused by the following ones */
+  cmd_keep_endpoints_open(true);
+
+  while (getline(&line, &len, fp) > 0) {
+    lineno++;
+
+    cmd_argc = batch_split(line, cmd_argv);
+    if (cmd_argc == 0)
+      continue;
+    if (cmd_argc < 0) {
+      fprintf(stderr, "%s:%d: too many arguments\n", argv[0], lineno);
+      rc = EXIT_FAILURE;
+    } else if (strcmp(cmd_argv[0], STR_BATCH) == 0 ||
+               strcmp(cmd_argv[0], STR_SERVE) == 0) {
+      fprintf(stderr, "%s:%d: '%s' cannot be nested\n", argv[0], lineno,
+              cmd_argv[0]);
+      rc = EXIT_FAILURE;
+    } else {
+      rc = cxl_run_internal_command(cmd_argc, cmd_argv, ctx);
+      if (rc)
+        fprintf(stderr, "%s:%d: '%s' failed (%d)\n", argv[0], lineno,
+                cmd_argv[0], rc);
+    }
+
+    if (rc) {
+      failed++;
+      if (batch_params.exit_on_error)
+        break;
+    }
+  }
+
+  free(line);
+  if (fp != stdin)
+    fclose(fp);
+
+  return failed ? EXIT_FAILURE : 0;
+}
@@ -3,6 +3,8 @@
 /* std includes */
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 
 /* libcxlmi includes */
 #include <cxlmi/private.h>
@@ -11,13 +13,20 @@
 /* vendor includes */
 #include "cxl_cmd.h"
 #include "cxl_main.h"
+#include "ep_pool.h"
+#include "ep_select.h"
 #include <parse_option.h>
 #include <util_main.h>
+#include <vendor_cache.h>
+#include <vendor_caps.h>
 #include <vendor_commands.h>
+#include <vendor_emu.h>
+#include <vendor_timing.h>
 #include <vendor_types.h>
 
 #define STR_CXL_CMDS_HELP_PREFIX "cxl "
-#define STR_CXL_CMDS_HELP_SUFFIX " <mem0> [<mem1>..<memN>] [<options>]"
+#define STR_CXL_CMDS_HELP_SUFFIX                                               \
+  " <mem0> [<mem1>..<memN> | mem[A-B] | mem* | all] [<options>]"
 
 #define STR_CXL_CMDS_HELP(STR_CMD)                                             \
   STR_CXL_CMDS_HELP_PREFIX STR_CMD STR_CXL_CMDS_HELP_SUFFIX
@@ -29,87 +38,215 @@ const char *get_devname(struct cxlmi_endpoint *ep) {
     return NULL;
 }
 
-struct cxlmi_endpoint *cxlmi_ep_filter(struct cxlmi_endpoint *ep,
-                                       const char *ident) {
-  int ep_id;
+/*
+ * When set, endpoints stay open after a command so the next command run in
+ * this process (serve, batch) picks them up instead of reopening them.
+ */
+static bool cmd_keep_endpoints;
 
-  if (!ident || strcmp(ident, "all") == 0)
-    return ep;
+void cmd_keep_endpoints_open(bool keep) { cmd_keep_endpoints = keep; }
 
-  if (strcmp(ident, ep->devname) == 0)
-    return ep;
+/* Endpoints the running cmd_action() goes through */
+static int cmd_nr_eps;
 
-  if ((sscanf(ident, "%d", &ep_id) == 1 || sscanf(ident, "mem%d", &ep_id) == 1)
-      /*&& cxl_memdev_get_id(ep) == ep_id*/)
-    return ep;
+/*
+ * An -o file, rather than a directory, can only take one device: with more
+ * selected, their workers would all write to it at once.
+ */
+static int cmd_check_output(struct cxlmi_endpoint *ep, const char *output) {
+  struct stat st;
 
+  if (!output || cmd_nr_eps <= 1 ||
+      (!stat(output, &st) && S_ISDIR(st.st_mode)))
+    return 0;
+
+  printf("%s: %s is not a directory, it cannot take %d devices\n",
+         get_devname(ep), output, cmd_nr_eps);
+  return -EINVAL;
+}
+
+struct cxlmi_endpoint *cmd_find_open_ep(struct cxlmi_ctx *ctx,
+                                        const char *name) {
+  struct cxlmi_endpoint *ep;
+
+  if (cxlmi_emu_enabled())
+    return cxlmi_emu_find(name);
+
+  cxlmi_for_each_endpoint(ctx, ep) {
+    if (ep->devname && strcmp(ep->devname, name) == 0)
+      return ep;
+  }
   return NULL;
 }
 
+/* Emulated endpoints stand in for real ones when CXL_EMU is set */
+struct cxlmi_endpoint *cmd_open_ep(struct cxlmi_ctx *ctx, const char *name) {
+  if (cxlmi_emu_enabled())
+    return cxlmi_emu_open(ctx, name);
+  return cxlmi_open(ctx, name);
+}
+
+void cmd_close_ep(struct cxlmi_endpoint *ep) {
+  /* a later endpoint may get the same address */
+  cxlmi_caps_forget(ep);
+  if (cxlmi_emu_is_emulated(ep))
+    cxlmi_emu_close(ep);
+  else
+    cxlmi_close(ep);
+}
+
+static struct _cmd_common_params {
+  int jobs;
+  bool timing;
+  int cache_ttl;
+} cmd_common_params;
+
+#define CMD_COMMON_OPTIONS()                                                   \
+  OPT_INTEGER('j', "jobs", &cmd_common_params.jobs,                            \
+              "number of endpoints to run in parallel (default 1)"),           \
+      OPT_BOOLEAN(0, "timing", &cmd_common_params.timing,                      \
+                  "print latency histograms to stderr at exit"),               \
+      OPT_INTEGER(0, "cache-ttl", &cmd_common_params.cache_ttl,                \
+                  "reuse cached identity responses up to <n> seconds old, "    \
+                  "0 disables (default $CXL_CACHE_TTL)")
+
+static const struct option cmd_common_options[] = {
+    CMD_COMMON_OPTIONS(),
+};
+
+static void cmd_timing_dump(void) { cxlmi_timing_dump(stderr); }
+
+/* Action being timed, and the command it belongs to (inherited by workers) */
+static int (*cmd_timed_fn)(struct cxlmi_endpoint *ep);
+static const char *cmd_timed_name;
+
+/* Host side of an action: decode and print, i.e. all but the mailbox */
+static int cmd_timed_action(struct cxlmi_endpoint *ep) {
+  uint64_t start = cxlmi_timing_now(), mbox = cxlmi_timing_mbox_ns();
+  int rc = cmd_timed_fn(ep);
+  uint64_t host = cxlmi_timing_now() - start - (cxlmi_timing_mbox_ns() - mbox);
+
+  cxlmi_timing_record(CXLMI_TIMING_HOST, 0, cmd_timed_name, host);
+  return rc;
+}
+
+/*
+ * Append the options shared by every endpoint command to the command's own
+ * option table. The caller frees the returned array.
+ */
+static struct option *cmd_merge_options(const struct option *options) {
+  struct option *merged;
+  size_t n = 0, nr_common = ARRAY_SIZE(cmd_common_options);
+
+  while (options[n].type != OPTION_END)
+    n++;
+
+  merged = calloc(n + nr_common + 1, sizeof(*merged));
+  if (!merged)
+    return NULL;
+
+  memcpy(merged, options, n * sizeof(*merged));
+  memcpy(merged + n, cmd_common_options, sizeof(cmd_common_options));
+  merged[n + nr_common].type = OPTION_END;
+
+  return merged;
+}
+
 static int cmd_action(int argc, const char **argv, struct cxlmi_ctx *ctx,
                       int (*action)(struct cxlmi_endpoint *ep),
-                      const struct option *options, const char *usage) {
+                      const struct option *cmd_options, const char *usage) {
+  _cleanup_free_ struct option *options = NULL;
+  _cleanup_free_ struct cxlmi_endpoint **eps = NULL;
+  _cleanup_free_ int *results = NULL;
   struct cxlmi_endpoint *ep = NULL;
-  int i, rc = 0, count = 0, err = 0;
+  struct ep_table sel;
+  int i, rc = 0, count = 0, err = 0, nr_eps = 0;
   const char *const u[] = {usage, NULL};
-  unsigned long id;
-
+  const char *argv0 = argv[0];
+  static bool timing_registered;
+  uint64_t start;
+
+  options = cmd_merge_options(cmd_options);
+  if (!options)
+    return -ENOMEM;
+
+  /* options left over from a previous command in this process */
+  reset_options(options);
+  cmd_common_params.jobs = 1;
+  cmd_common_params.cache_ttl = -1;
   argc = parse_options(argc, argv, options, u, 0);
   if (argc == 0)
     usage_with_options(u, options);
-  for (i = 0; i < argc; i++) {
-    if (strcmp(argv[i], "all") == 0) {
-      argv[0] = "all";
-      argc = 1;
-      break;
-    }
-    if (sscanf(argv[i], "mem%lu", &id) != 1) {
-      fprintf(stderr, "'%s' is not a valid ep name\n", argv[i]);
-      err++;
-    }
+  if (cmd_common_params.jobs < 1 ||
+      cmd_common_params.jobs > EP_POOL_MAX_JOBS) {
+    fprintf(stderr, "--jobs must be between 1 and %d\n", EP_POOL_MAX_JOBS);
+    return -CXLMI_RET_INPUT;
   }
-  if (err == argc) {
+  cxlmi_cache_set_ttl(cmd_common_params.cache_ttl);
+  if (cmd_common_params.timing && !timing_registered) {
+    atexit(cmd_timing_dump);
+    timing_registered = true;
+  }
+
+  rc = ep_select(&sel, argc, argv);
+  if (rc < 0)
+    return rc;
+  if (rc == 0) {
     usage_with_options(u, options);
     return -CXLMI_RET_INPUT; // EINVAL;
   }
 
-  rc = 0;
-  err = 0;
-  count = 0;
-  if ((argc == 1) && (strcmp(argv[0], "all") == 0)) {
-    // HACK: Open all the end points
-    argv[0] = "mem0";
-    argv[1] = "mem1";
-    argc = 2;
+  eps = calloc(sel.nr, sizeof(*eps));
+  if (!eps) {
+    ep_table_free(&sel);
+    return -ENOMEM;
   }
 
-  for (i = 0; i < argc; i++) {
-    if (sscanf(argv[i], "mem%lu", &id) != 1 && strcmp(argv[i], "all") != 0)
+  /* open each selected endpoint exactly once */
+  for (i = 0; i < sel.nr; i++) {
+    ep = cmd_find_open_ep(ctx, sel.ents[i].name);
+    if (ep) {
+      eps[nr_eps++] = ep;
       continue;
+    }
 
-    // printf("open '%s' endpoint\n", argv[i]);
-    ep = cxlmi_open(ctx, argv[i]);
+    // printf("open '%s' endpoint\n", sel.ents[i].name);
+    start = cxlmi_timing_now();
+    ep = cmd_open_ep(ctx, sel.ents[i].name);
+    cxlmi_timing_record(CXLMI_TIMING_OPEN, 0, argv0,
+                        cxlmi_timing_now() - start);
     if (!ep) {
-      fprintf(stderr, "cannot open '%s' endpoint\n", argv[i]);
+      fprintf(stderr, "cannot open '%s' endpoint\n", sel.ents[i].name);
       continue;
     }
+    eps[nr_eps++] = ep;
+  }
+  ep_table_free(&sel);
 
-    cxlmi_for_each_endpoint(ctx, ep) {
-      if (!cxlmi_ep_filter(ep, argv[i]))
-        continue;
-
-      rc = action(ep);
-      if (rc == 0)
-        count++;
-      else if (rc && !err)
-        err = rc;
-
-      if (ep) {
-        // printf("close '%s' endpoint\n", get_devname(ep));
-        cxlmi_close(ep);
-        ep = NULL;
-      }
-    }
+  rc = 0;
+  results = calloc(nr_eps ? nr_eps : 1, sizeof(*results));
+  if (!results) {
+    rc = -ENOMEM;
+    goto close;
+  }
+
+  cmd_timed_fn = action;
+  cmd_timed_name = argv0;
+  cmd_nr_eps = nr_eps;
+  ep_pool_run(eps, nr_eps, cmd_common_params.jobs, cmd_timed_action, results);
+
+  for (i = 0; i < nr_eps; i++) {
+    rc = results[i];
+    if (rc == 0)
+      count++;
+    else if (rc && !err)
+      err = rc;
+  }
+
+close:
+  for (i = 0; i < nr_eps && !cmd_keep_endpoints; i++) {
+    // printf("close '%s' endpoint\n", get_devname(eps[i]));
+    cmd_close_ep(eps[i]);
   }
 
   /*
@@ -169,14 +306,27 @@ static struct _log_size {
 #define LOG_SIZE_OPTIONS()                                                     \
   OPT_UINTEGER('s', "log_size", &log_size.size, "log-size")
 
+static struct _log_output {
+  const char *path;
+} log_output;
+
+#define LOG_OUTPUT_OPTIONS()                                                   \
+  OPT_FILENAME('o', "output", &log_output.path, "file",                        \
+               "write the log to a file as it is read, chunk by chunk")
+
 static const struct option cmd_get_log_options[] = {
     LOG_UUID_OPTIONS(),
     LOG_SIZE_OPTIONS(),
+    LOG_OUTPUT_OPTIONS(),
     OPT_END(),
 };
 
 static int action_cmd_get_log(struct cxlmi_endpoint *ep) {
-  return cxl_cmd_get_log(ep, log_uuid.uuid, log_size.size);
+  int rc = cmd_check_output(ep, log_output.path);
+
+  if (rc)
+    return rc;
+  return cxl_cmd_get_log(ep, log_uuid.uuid, log_size.size, log_output.path);
 }
 
 int cmd_get_log(int argc, const char **argv, struct cxlmi_ctx *ctx) {
@@ -304,7 +454,15 @@ struct _update_fw_params update_fw_params;
                   "runs as hidden background option"),                         \
       OPT_BOOLEAN('m', "mock", &update_fw_params.mock,                         \
                   "For testing purposes. Mock transfer with only 1 continue "  \
-                  "then abort")
+                  "then abort"),                                               \
+      OPT_BOOLEAN('r', "resume", &update_fw_params.resume,                     \
+                  "continue a transfer left open by a timeout"),               \
+      OPT_STRING('c', "crc32c", &update_fw_params.crc32c, "hex",               \
+                 "refuse the image unless its crc32c matches"),               \
+      OPT_BOOLEAN('t', "telemetry", &update_fw_params.telemetry,               \
+                  "print throughput and per-block latency at the end"),        \
+      OPT_BOOLEAN(0, "telemetry-json", &update_fw_params.telemetry_json,       \
+                  "telemetry as JSON lines, one per block and a summary")
 
 #define FW_IMG_OPTIONS()                                                       \
   OPT_BOOLEAN('z', "osimage", &fw_img_params.is_os,                            \
@@ -327,6 +485,41 @@ int cmd_update_fw(int argc, const char **argv, struct cxlmi_ctx *ctx) {
   return rc >= 0 ? 0 : EXIT_FAILURE;
 }
 
+/* ACTIVATE_FW */
+static struct _activate_fw_params {
+  uint32_t slot;
+  bool hbo;
+  bool on_reset;
+} activate_fw_params;
+
+#define ACTIVATE_FW_OPTIONS()                                                  \
+  OPT_UINTEGER('s', "slot", &activate_fw_params.slot, "slot to activate"),     \
+      OPT_BOOLEAN('b', "background", &activate_fw_params.hbo,                  \
+                  "image was sent with update-fw -b"),                         \
+      OPT_BOOLEAN('r', "on-reset", &activate_fw_params.on_reset,               \
+                  "activate on the next reset instead of online")
+
+static const struct option cmd_activate_fw_options[] = {
+    ACTIVATE_FW_OPTIONS(),
+    FW_IMG_OPTIONS(),
+    OPT_END(),
+};
+
+static int action_cmd_activate_fw(struct cxlmi_endpoint *ep) {
+  return cxl_cmd_activate_fw(
+      ep, activate_fw_params.hbo || fw_img_params.is_os,
+      activate_fw_params.on_reset ? ACTIVATE_ON_RESET : ACTIVATE_ONLINE,
+      activate_fw_params.slot);
+}
+
+int cmd_activate_fw(int argc, const char **argv, struct cxlmi_ctx *ctx) {
+  int rc =
+      cmd_action(argc, argv, ctx, action_cmd_activate_fw,
+                 cmd_activate_fw_options, STR_CXL_CMDS_HELP(STR_ACTIVATE_FW));
+
+  return rc >= 0 ? 0 : EXIT_FAILURE;
+}
+
 /* GET_TIMESTAMP */
 static const struct option cmd_get_timestamp_options[] = {
     OPT_END(),
@@ -374,12 +567,21 @@ int cmd_set_timestamp(int argc, const char **argv, struct cxlmi_ctx *ctx) {
 static struct _get_event_records_params {
   int event_log_type; /* 00 - information, 01 - warning, 02 - failure, 03 -
                          fatal */
+  bool drain;
+  bool clear;
+  const char *output;
 } get_event_records_params;
 
 #define GET_EVENT_RECORDS_OPTIONS()                                            \
   OPT_INTEGER('t', "log_type", &get_event_records_params.event_log_type,       \
               "Event log type (00 - information (default), 01 - warning, 02 "  \
-              "- failure, 03 - fatal)")
+              "- failure, 03 - fatal)"),                                       \
+      OPT_BOOLEAN('d', "drain", &get_event_records_params.drain,               \
+                  "read all four logs, following More Event Records"),         \
+      OPT_BOOLEAN('c', "clear", &get_event_records_params.clear,               \
+                  "with --drain, clear each page once written to --output"),   \
+      OPT_FILENAME('o', "output", &get_event_records_params.output, "file",    \
+                   "with --drain, append every record to <file>")
 
 static const struct option cmd_get_event_records_options[] = {
     GET_EVENT_RECORDS_OPTIONS(),
@@ -387,6 +589,9 @@ static const struct option cmd_get_event_records_options[] = {
 };
 
 static int action_cmd_get_event_records(struct cxlmi_endpoint *ep) {
+  if (get_event_records_params.drain)
+    return cxl_cmd_drain_event_records(ep, get_event_records_params.clear,
+                                       get_event_records_params.output);
   return cxl_cmd_get_event_records(ep, get_event_records_params.event_log_type);
 }
 
@@ -403,7 +608,8 @@ static struct _clear_event_records_params {
   int event_log_type;    /* 00 - information, 01 - warning, 02 - failure, 03 -
                             fatal */
   int clear_event_flags; /* bit 0 - when set, clears all events */
-  unsigned int event_record_handle; /* only one is supported */
+  const char *event_record_handles;
+  const char *from;
 } clear_event_records_params;
 
 #define CLEAR_EVENT_RECORDS_OPTIONS()                                          \
@@ -413,10 +619,13 @@ static struct _clear_event_records_params {
       OPT_INTEGER('f', "event_flag",                                           \
                   &clear_event_records_params.clear_event_flags,               \
                   "Clear Event Flags: 1 - clear all events, 0 (default) - "    \
-                  "clear specific event record"),                              \
-      OPT_UINTEGER('i', "event_record_handle",                                 \
-                   &clear_event_records_params.event_record_handle,            \
-                   "Clear Specific Event specific by Event Record Handle")
+                  "clear specific event records"),                             \
+      OPT_STRING('i', "event_record_handle",                                   \
+                 &clear_event_records_params.event_record_handles, "handles",  \
+                 "Event Record Handles to clear, in hex, e.g. 10,12-0x20"),    \
+      OPT_FILENAME(0, "from", &clear_event_records_params.from, "file",        \
+                   "clear the records of this device and log listed in a "     \
+                   "get-event-records --output file")
 
 static const struct option cmd_clear_event_records_options[] = {
     CLEAR_EVENT_RECORDS_OPTIONS(),
@@ -424,10 +633,23 @@ static const struct option cmd_clear_event_records_options[] = {
 };
 
 static int action_cmd_clear_event_records(struct cxlmi_endpoint *ep) {
-  return cxl_cmd_clear_event_records(
-      ep, clear_event_records_params.event_log_type,
-      clear_event_records_params.clear_event_flags,
-      clear_event_records_params.event_record_handle);
+  struct _clear_event_records_params *p = &clear_event_records_params;
+  _cleanup_free_ struct cxl_event_handle *handles = NULL;
+  int nr = 0;
+
+  if (!p->clear_event_flags) {
+    nr = cxl_parse_event_handles(ep, p->event_log_type,
+                                 p->event_record_handles, p->from, &handles);
+    if (nr < 0)
+      return nr;
+    if (!nr) {
+      printf("%s: no event record handle to clear\n", get_devname(ep));
+      return p->from ? 0 : -EINVAL;
+    }
+  }
+
+  return cxl_cmd_clear_event_records(ep, p->event_log_type,
+                                     p->clear_event_flags, handles, nr);
 }
 
 int cmd_clear_event_records(int argc, const char **argv,
@@ -1154,6 +1376,44 @@ int cmd_trigger_coredump(int argc, const char **argv, struct cxlmi_ctx *ctx) {
   return rc >= 0 ? 0 : EXIT_FAILURE;
 }
 
+/* COLLECT_COREDUMP */
+static struct _collect_coredump_params {
+  const char *output;
+  uint32_t timeout;
+  bool no_trigger;
+} collect_coredump_params;
+
+#define COLLECT_COREDUMP_OPTIONS()                                             \
+  OPT_FILENAME('o', "output", &collect_coredump_params.output, "path",         \
+               "file or directory for the dump (default: current directory)"), \
+      OPT_UINTEGER('t', "timeout", &collect_coredump_params.timeout,           \
+                   "seconds to wait for the dump (default 60)"),               \
+      OPT_BOOLEAN('n', "no-trigger", &collect_coredump_params.no_trigger,      \
+                  "fetch the debug log as it is, without a new dump")
+
+static const struct option cmd_collect_coredump_options[] = {
+    COLLECT_COREDUMP_OPTIONS(),
+    OPT_END(),
+};
+
+static int action_cmd_collect_coredump(struct cxlmi_endpoint *ep) {
+  int rc = cmd_check_output(ep, collect_coredump_params.output);
+
+  if (rc)
+    return rc;
+  return cxl_cmd_collect_coredump(ep, collect_coredump_params.output,
+                                  collect_coredump_params.timeout,
+                                  collect_coredump_params.no_trigger);
+}
+
+int cmd_collect_coredump(int argc, const char **argv, struct cxlmi_ctx *ctx) {
+  int rc = cmd_action(argc, argv, ctx, action_cmd_collect_coredump,
+                      cmd_collect_coredump_options,
+                      STR_CXL_CMDS_HELP(STR_COLLECT_COREDUMP));
+
+  return rc >= 0 ? 0 : EXIT_FAILURE;
+}
+
 /* DDR_STATS_RUN */
 static struct _ddr_stats_run_params {
   u32 ddr_id;
@@ -1188,12 +1448,25 @@ int cmd_ddr_stats_run(int argc, const char **argv, struct cxlmi_ctx *ctx) {
 }
 
 /* DDR_STATS_GET */
+static struct _ddr_stats_get_params {
+  const char *output;
+} ddr_stats_get_params;
+
+#define DDR_STATS_GET_OPTIONS()                                                \
+  OPT_FILENAME('o', "output", &ddr_stats_get_params.output, "path",            \
+               "columnar binary file or directory instead of text")
+
 static const struct option cmd_ddr_stats_get_options[] = {
+    DDR_STATS_GET_OPTIONS(),
     OPT_END(),
 };
 
 static int action_cmd_ddr_stats_get(struct cxlmi_endpoint *ep) {
-  return cxl_cmd_ddr_stats_get(ep);
+  int rc = cmd_check_output(ep, ddr_stats_get_params.output);
+
+  if (rc)
+    return rc;
+  return cxl_cmd_ddr_stats_get(ep, ddr_stats_get_params.output);
 }
 
 int cmd_ddr_stats_get(int argc, const char **argv, struct cxlmi_ctx *ctx) {
@@ -1809,3 +2082,30 @@ int cmd_ddr_init_err_info_get(int argc, const char **argv,
 
   return rc >= 0 ? 0 : EXIT_FAILURE;
 }
+
+/* TIMING_STATS */
+static struct _timing_stats_params {
+  bool reset;
+} timing_stats_params;
+
+#define TIMING_STATS_OPTIONS()                                                 \
+  OPT_BOOLEAN('r', "reset", &timing_stats_params.reset,                        \
+              "clear the counters after printing them")
+
+static const struct option cmd_timing_stats_options[] = {
+    TIMING_STATS_OPTIONS(),
+    OPT_END(),
+};
+
+int cmd_timing_stats(int argc, const char **argv, struct cxlmi_ctx *ctx) {
+  const char *const u[] = {"cxl " STR_TIMING_STATS " [<options>]", NULL};
+
+  reset_options(cmd_timing_stats_options);
+  parse_options(argc, argv, cmd_timing_stats_options, u, 0);
+
+  cxlmi_timing_dump(stdout);
+  if (timing_stats_params.reset)
+    cxlmi_timing_reset();
+
+  return 0;
+}
@@ -1,9 +1,19 @@
 // SPDX-License-Identifier: LGPL-2.1-or-later
 
 /* std includes */
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef CONFIG_ZLIB
+#include <zlib.h>
+#endif
 
 /* libcxlmi includes */
 #include <ccan/endian/endian.h>
@@ -12,9 +22,19 @@
 
 /* vendor includes */
 #include "cxl_cmd.h"
+#include "ddr_stats_export.h"
+#include "event_decode.h"
+#include "fw_checkpoint.h"
+#include "fw_telemetry.h"
 #include <parse_option.h>
+#include <strbuf.h>
 #include <util_main.h>
+#include <vendor_async.h>
+#include <vendor_cache.h>
 #include <vendor_commands.h>
+#include <vendor_crc.h>
+#include <vendor_poll.h>
+#include <vendor_timing.h>
 #include <vendor_types.h>
 
 /* Length of UUID in bytes */
@@ -22,8 +42,6 @@
 
 #define member_size(type, member) (sizeof(((type *)0)->member))
 #define CXL_MAX_RECORDS_TO_DUMP 20
-#define CXL_DRAM_EVENT_GUID "601dcbb3-9c06-4eab-b8af-4e9bfb5c9624"
-#define CXL_MEM_MODULE_EVENT_GUID "fe927475-dd59-4339-a586-79bab113b774"
 
 static const uint8_t cel_uuid[LOG_UUID_LEN] = {
     0x0d, 0xa9, 0xc0, 0xb5, 0xbf, 0x41, 0x4b, 0x78,
@@ -35,11 +53,73 @@ static const uint8_t ven_dbg[LOG_UUID_LEN] = {
 
 #define FW_VERSION_LEN 0x10
 
+/* Cache keys of the read only commands, see vendor_cache.h */
+#define CACHE_OPCODE(set, cmd) ((set) << 8 | (cmd))
+#define CACHE_IDENTIFY CACHE_OPCODE(IDENTIFY, 0x00)
+#define CACHE_FW_INFO CACHE_OPCODE(FIRMWARE_UPDATE, GET_INFO)
+#define CACHE_OS_FW_INFO CACHE_OPCODE(VENDOR_CMD_OEM_MGMT, GET_OS_INFO)
+#define CACHE_SPD_READ CACHE_OPCODE(VENDOR_CMD_DDR_DIMM_MGMT, DIMM_SPD_READ)
+#define CACHE_SLOT_INFO CACHE_OPCODE(VENDOR_CMD_DDR_DIMM_MGMT, DIMM_SLOT_INFO)
+#define CACHE_DEVICE_INFO CACHE_OPCODE(VENDOR_CMD_OTHERS, DEVICE_INFO)
+
+typedef int (*cxl_cached_fn)(struct cxlmi_endpoint *ep, const void *in,
+                             void *out);
+
+/*
+ * Serve a read only command from the cache, sending it and caching the
+ * response on a miss. The request, if any, is part of the key.
+ */
+static int cxl_cached_cmd(struct cxlmi_endpoint *ep, uint16_t key,
+                          const void *in, size_t in_sz, void *out,
+                          size_t out_sz, cxl_cached_fn fn) {
+  int rc;
+
+  rc = cxlmi_cache_load(ep, key, in, in_sz, out, out_sz);
+  if (rc) {
+    rc = fn(ep, in, out);
+    if (!rc)
+      cxlmi_cache_store(ep, key, in, in_sz, out, out_sz);
+  }
+  return rc;
+}
+
+static int cached_identify(struct cxlmi_endpoint *ep, const void *in,
+                           void *out) {
+  return cxlmi_cmd_memdev_identify(ep, NULL, out);
+}
+
+static int cached_fw_info(struct cxlmi_endpoint *ep, const void *in,
+                          void *out) {
+  return cxlmi_cmd_get_fw_info(ep, NULL, out);
+}
+
+static int cached_os_fw_info(struct cxlmi_endpoint *ep, const void *in,
+                             void *out) {
+  return cxlmi_cmd_get_os_fw_info(ep, NULL, out);
+}
+
+static int cached_spd_read(struct cxlmi_endpoint *ep, const void *in,
+                           void *out) {
+  return cxlmi_cmd_dimm_spd_read(
+      ep, NULL, (struct cxlmi_cmd_dimm_spd_read_req *)in, out);
+}
+
+static int cached_slot_info(struct cxlmi_endpoint *ep, const void *in,
+                            void *out) {
+  return cxlmi_cmd_dimm_slot_info(ep, NULL, out);
+}
+
+static int cached_device_info(struct cxlmi_endpoint *ep, const void *in,
+                              void *out) {
+  return cxlmi_cmd_get_device_info(ep, NULL, out);
+}
+
 int cxl_cmd_identify(struct cxlmi_endpoint *ep) {
   int rc;
   struct cxlmi_cmd_memdev_identify identify;
 
-  rc = cxlmi_cmd_memdev_identify(ep, NULL, &identify);
+  rc = cxl_cached_cmd(ep, CACHE_IDENTIFY, NULL, 0, &identify, sizeof(identify),
+                      cached_identify);
   if (!rc) {
     printf("Identify payload info: %s\n", get_devname(ep));
     printf("    out size: 0x%lx\n", sizeof(identify));
@@ -111,11 +191,13 @@ int cxl_cmd_get_supported_logs(struct cxlmi_endpoint *ep) {
 }
 
 int cxl_cmd_get_log(struct cxlmi_endpoint *ep, const char *log_uuid,
-                    uint32_t log_size) {
+                    uint32_t log_size, const char *output) {
   uint32_t max_payload = log_size;
   struct cxlmi_cmd_get_log_req in;
   struct cxlmi_cmd_get_log_cel_rsp *ret;
-  int i, rc;
+  char path[PATH_MAX];
+  struct stat st;
+  int i, fd, rc;
 
   if (!log_uuid) {
     printf("%s: Please specify log uuid argument\n", get_devname(ep));
@@ -152,17 +234,49 @@ int cxl_cmd_get_log(struct cxlmi_endpoint *ep, const char *log_uuid,
     free(gsl);
   }
 
-  in.offset = 0;
+  if (!max_payload) {
+    printf("%s: size of log %s unknown, give -s\n", get_devname(ep),
+           log_uuid);
+    return -EINVAL;
+  }
   in.length = max_payload;
-  ret = calloc(1, sizeof(*ret) + max_payload);
-  if (!ret) {
+
+  /* straight to the file, one chunk in memory at a time */
+  if (output) {
+    /* a directory gets one <devname>.log per device */
+    if (!stat(output, &st) && S_ISDIR(st.st_mode))
+      snprintf(path, sizeof(path), "%s/%s.log", output, get_devname(ep));
+    else
+      snprintf(path, sizeof(path), "%s", output);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      printf("Cannot open %s: %s\n", path, strerror(errno));
+      return -errno;
+    }
+    rc = cxlmi_get_log_paged(ep, NULL, in.uuid, max_payload, NULL, fd);
+    if (close(fd) && !rc)
+      rc = -errno;
+    if (rc)
+      printf("%s: get log to %s failed: %d\n", get_devname(ep), path, rc);
+    else
+      printf("%s: %u byte(s) of log %s written to %s\n", get_devname(ep),
+             max_payload, log_uuid, path);
+    return rc;
+  }
+
+  /* zeroed, and one byte over so that a text log is NUL terminated */
+  ret = mmap(NULL, max_payload + 1, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ret == MAP_FAILED) {
     printf("Failed to allocate memory\r\n");
     return -ENOMEM;
   }
 
-  rc = cxlmi_cmd_get_log_cel(ep, NULL, &in, ret);
-  if (rc)
+  rc = cxlmi_get_log_paged(ep, NULL, in.uuid, max_payload, ret, -1);
+  if (rc) {
+    printf("%s: get log failed: %d\n", get_devname(ep), rc);
     goto done;
+  }
   printf("Log payload info: %s\n", get_devname(ep));
   printf("    out size: 0x%x\n", in.length);
 
@@ -196,7 +310,7 @@ int cxl_cmd_get_log(struct cxlmi_endpoint *ep, const char *log_uuid,
   printf("Invalid log UUID:%s\n", log_uuid);
 
 done:
-  free(ret);
+  munmap(ret, max_payload + 1);
 
   return rc;
 }
@@ -324,12 +438,47 @@ int cxl_cmd_get_dev_fw_info(struct cxlmi_endpoint *ep, bool is_os) {
 }
 
 #define SLOT_MASK 0x07
+#define FW_SLOTS 4
+
+static const char *fw_slot_rev(struct cxlmi_cmd_get_fw_info *fw_info,
+                               uint32_t slot) {
+  switch (slot) {
+  case 1:
+    return fw_info->fw_rev1;
+  case 2:
+    return fw_info->fw_rev2;
+  case 3:
+    return fw_info->fw_rev3;
+  case 4:
+    return fw_info->fw_rev4;
+  default:
+    return NULL;
+  }
+}
+
+/* The crc32c of the image each slot holds, when update-fw recorded it */
+static void fw_print_slot_images(struct cxlmi_endpoint *ep, bool is_os,
+                                 struct cxlmi_cmd_get_fw_info *fw_info) {
+  struct fw_slot_record rec;
+  const char *rev;
+
+  for (uint32_t slot = 1; slot <= FW_SLOTS; slot++) {
+    rev = fw_slot_rev(fw_info, slot);
+    if (fw_slot_record_load(ep, is_os, slot, &rec) ||
+        strncmp(rec.rev, rev, FW_SLOT_REV_LEN))
+      continue;
+    printf("Slot %u %s Image crc32c: 0x%08x\n", slot, is_os ? "OS" : "FW",
+           rec.image_crc);
+  }
+}
+
 int cxl_cmd_get_fw_info(struct cxlmi_endpoint *ep) {
   int rc;
   struct cxlmi_cmd_get_fw_info fw_info;
   uint8_t slotmask = SLOT_MASK;
 
-  rc = cxlmi_cmd_get_fw_info(ep, NULL, &fw_info);
+  rc = cxl_cached_cmd(ep, CACHE_FW_INFO, NULL, 0, &fw_info, sizeof(fw_info),
+                      cached_fw_info);
   if (!rc) {
     printf("================================= %s : get fw info "
            "==================================\r\n",
@@ -343,6 +492,7 @@ int cxl_cmd_get_fw_info(struct cxlmi_endpoint *ep) {
     printf("Slot 2 FW Revision: %s\n", fw_info.fw_rev2);
     printf("Slot 3 FW Revision: %s\n", fw_info.fw_rev3);
     printf("Slot 4 FW Revision: %s\n", fw_info.fw_rev4);
+    fw_print_slot_images(ep, false, &fw_info);
   }
 
   return rc;
@@ -353,7 +503,8 @@ int cxl_cmd_get_os_fw_info(struct cxlmi_endpoint *ep) {
   struct cxlmi_cmd_get_fw_info fw_info;
   uint8_t slotmask = SLOT_MASK;
 
-  rc = cxlmi_cmd_get_os_fw_info(ep, NULL, &fw_info);
+  rc = cxl_cached_cmd(ep, CACHE_OS_FW_INFO, NULL, 0, &fw_info,
+                      sizeof(fw_info), cached_os_fw_info);
   if (!rc) {
     printf("================================= %s : get fw info "
            "==================================\r\n",
@@ -367,6 +518,7 @@ int cxl_cmd_get_os_fw_info(struct cxlmi_endpoint *ep) {
     printf("Slot 2 OS Revision: %s\n", fw_info.fw_rev2);
     printf("Slot 3 OS Revision: %s\n", fw_info.fw_rev3);
     printf("Slot 4 OS Revision: %s\n", fw_info.fw_rev4);
+    fw_print_slot_images(ep, true, &fw_info);
   }
 
   return rc;
@@ -374,10 +526,6 @@ int cxl_cmd_get_os_fw_info(struct cxlmi_endpoint *ep) {
 
 #define FW_BYTE_ALIGN 128
 #define FW_BLOCK_SIZE 128
-#define INITIATE_TRANSFER 1
-#define CONTINUE_TRANSFER 2
-#define END_TRANSFER 3
-#define ABORT_TRANSFER 4
 
 const char *TRANSFER_FW_ERRORS[15] = {"Success",
                                       "Background Command Started",
@@ -395,7 +543,184 @@ const char *TRANSFER_FW_ERRORS[15] = {"Success",
                                       "Invalid Security State",
                                       "Invalid Payload Length"};
 
-typedef unsigned char fwblock[FW_BLOCK_SIZE];
+/*
+ * Busy blocks are retried, and block completion polled, with a backoff
+ * starting at a few ms. The timeouts match the former 10 x 10s retries.
+ */
+#define FW_RETRY_MIN_MS 10
+#define FW_RETRY_MAX_MS 1000
+#define FW_RETRY_TIMEOUT_MS 100000
+#define FW_HBO_TIMEOUT_MS 100000
+#define FW_ABORT_WAIT_MS 2000
+
+#define FW_ALIGN_UP(n)                                                         \
+  (((n) + FW_BYTE_ALIGN - 1) / FW_BYTE_ALIGN * FW_BYTE_ALIGN)
+
+/* Image read per pass when computing its crc32c */
+#define FW_CRC_CHUNK (64 * 1024)
+
+/*
+ * Largest block the mailbox takes in one transfer, a multiple of
+ * FW_BYTE_ALIGN. The spec transfer in libcxlmi always sends FW_BLOCK_SIZE,
+ * as does any device whose payload_max cannot be read.
+ */
+static int fw_block_size(struct cxlmi_endpoint *ep, bool is_std,
+                         int filesize) {
+  int payload_max, block_size;
+
+  if (is_std)
+    return FW_BLOCK_SIZE;
+
+  payload_max = get_cxl_maxpayload(ep);
+  block_size = payload_max - (int)sizeof(struct cxlmi_cmd_transfer_fw);
+  block_size -= block_size % FW_BYTE_ALIGN;
+  /*
+   * No point in a buffer larger than the image, and a transfer needs both
+   * an initiate and an end block: a single block would never be ended.
+   */
+  if (block_size > FW_ALIGN_UP((filesize + 1) / 2))
+    block_size = FW_ALIGN_UP((filesize + 1) / 2);
+
+  return block_size > FW_BLOCK_SIZE ? block_size : FW_BLOCK_SIZE;
+}
+
+/* Read size bytes of the image at off, straight into the request payload */
+static int fw_read_image(int fd, void *buf, size_t size, off_t off) {
+  uint8_t *p = buf;
+  ssize_t n;
+
+  while (size) {
+    n = pread(fd, p, size, off);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -errno;
+    }
+    if (n == 0)
+      return -EIO; /* the file shrank under us */
+    p += n;
+    size -= n;
+    off += n;
+  }
+
+  return 0;
+}
+
+static int fw_image_crc(int fd, int filesize, uint32_t *crc) {
+  uint8_t *buf;
+  int off, n, rc = 0;
+
+  buf = malloc(FW_CRC_CHUNK);
+  if (!buf)
+    return -ENOMEM;
+
+  *crc = 0;
+  for (off = 0; off < filesize; off += n) {
+    n = filesize - off < FW_CRC_CHUNK ? filesize - off : FW_CRC_CHUNK;
+    rc = fw_read_image(fd, buf, n, off);
+    if (rc)
+      break;
+    *crc = cxlmi_crc32c(*crc, buf, n);
+  }
+
+  free(buf);
+  return rc;
+}
+
+/*
+ * Send the block held in req. The vendor opcodes send req as it is; the
+ * spec transfer in libcxlmi copies the payload into a message of its own.
+ */
+static int fw_transfer_block(struct cxlmi_endpoint *ep, uint32_t opcode,
+                             struct cxlmi_cci_msg *req, uint32_t offset,
+                             int block_size) {
+  struct cxlmi_cmd_transfer_fw *in = (void *)req->payload;
+
+  if (opcode == ((FIRMWARE_UPDATE << 8) | TRANSFER)) {
+    in->offset = offset;
+    return cxlmi_cmd_transfer_fw(ep, NULL, in);
+  }
+  return cxlmi_cmd_vendor_transfer_fw_msg(ep, NULL, req, offset, block_size,
+                                          opcode);
+}
+
+/* fw_transfer_block(), its mailbox time added to the telemetry and *ns */
+static int fw_transfer_block_timed(struct cxlmi_endpoint *ep, uint32_t opcode,
+                                   struct cxlmi_cci_msg *req, uint32_t offset,
+                                   int block_size, struct fw_telemetry *t,
+                                   uint64_t *ns) {
+  uint64_t start = cxlmi_timing_now(), d;
+  int rc;
+
+  rc = fw_transfer_block(ep, opcode, req, offset, block_size);
+  d = cxlmi_timing_now() - start;
+  t->xfer_ns += d;
+  *ns += d;
+
+  return rc;
+}
+
+static int fw_abort_transfer(struct cxlmi_endpoint *ep, uint32_t opcode,
+                             struct cxlmi_cci_msg *req) {
+  struct cxlmi_cmd_transfer_fw *in = (void *)req->payload;
+
+  /* let the block in flight, if any, finish before aborting */
+  cxlmi_hbo_wait(ep, NULL, FW_ABORT_WAIT_MS, NULL);
+
+  in->action = ABORT_TRANSFER;
+  return fw_transfer_block(ep, opcode, req, FW_BLOCK_SIZE, FW_BLOCK_SIZE);
+}
+
+/*
+ * Read the slot back once its transfer completed and record the image it
+ * now holds. The device reports no digest, so what is checked is that the
+ * slot has a revision, and not still the one of a different earlier image.
+ */
+static int fw_verify_slot(struct cxlmi_endpoint *ep, bool is_os,
+                          uint32_t slot, uint32_t image_crc,
+                          size_t image_size) {
+  struct cxlmi_cmd_get_fw_info fw_info;
+  struct fw_slot_record rec = {
+      .is_os = is_os,
+      .image_size = image_size,
+      .image_crc = image_crc,
+      .slot = slot,
+  };
+  struct fw_slot_record prev;
+  const char *rev;
+  int rc;
+
+  /* straight to the device, never from the response cache */
+  if (is_os)
+    rc = cxlmi_cmd_get_os_fw_info(ep, NULL, &fw_info);
+  else
+    rc = cxlmi_cmd_get_fw_info(ep, NULL, &fw_info);
+  if (rc) {
+    printf("Cannot read back slot %u (%d), image not verified\n", slot, rc);
+    return 0;
+  }
+
+  rev = fw_slot_rev(&fw_info, slot);
+  if (!rev || !rev[0]) {
+    printf("Slot %u reports no revision after the transfer\n", slot);
+    return -EIO;
+  }
+  if (fw_slot_record_load(ep, is_os, slot, &prev) == 0 &&
+      prev.image_crc != image_crc && !strncmp(prev.rev, rev, FW_SLOT_REV_LEN))
+    printf("Warning: slot %u still reports %.16s, as for the image with "
+           "crc32c 0x%08x written before\n",
+           slot, rev, prev.image_crc);
+
+  printf("Slot %u: revision %.16s, image crc32c 0x%08x\n", slot, rev,
+         image_crc);
+  if (get_cxl_serial(ep, &rec.serial) == 0) {
+    memcpy(rec.rev, rev, FW_SLOT_REV_LEN);
+    rec.stamp = time(NULL);
+    fw_slot_record_store(ep, &rec);
+  }
+
+  return 0;
+}
 
 int cxl_cmd_update_device_fw(struct cxlmi_endpoint *ep, bool is_os,
                              struct _update_fw_params *fw_params) {
@@ -403,58 +728,72 @@ int cxl_cmd_update_device_fw(struct cxlmi_endpoint *ep, bool is_os,
   int filesize;
   int fd;
   int num_blocks;
-  int num_read;
+  int block_size;
   int size;
-  const int max_retries = 10;
-  int retry_count;
+  int xfer_size;
   uint32_t offset;
-  fwblock *rom_buffer;
   uint32_t opcode;
-  int sleep_time = 1;
   int percent_to_print = 0;
   uint16_t std_opcode = ((FIRMWARE_UPDATE << 8) | TRANSFER);
+  struct cxlmi_cmd_transfer_fw *transfer_fw_input;
+  struct cxlmi_cci_msg *req = NULL;
+  struct fw_checkpoint ck, saved;
+  bool stale = false, keep_ckpt = false;
+  uint32_t image_crc, expected_crc;
+  char *end;
+  int first_block = 0;
+  int ck_fd = -1;
+  struct fw_telemetry tel = {};
+  uint64_t blk_xfer_ns, blk_hbo_ns, start;
+  uint32_t blk_polls, blk_retries;
 
   int rc;
-  FILE *rom;
 
   /* check file passed and get fw size */
-  rom = fopen(fw_params->filepath, "rb");
-  if (rom == NULL) {
+  fd = open(fw_params->filepath, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
     printf("Error: File open returned %s\nCould not open file %s\n",
            strerror(errno), fw_params->filepath);
     return -ENOENT;
   }
 
   printf("Rom filepath: %s\n", fw_params->filepath);
-  fd = fileno(rom);
   rc = fstat(fd, &fileStat);
   if (rc != 0) {
-    fclose(rom);
+    close(fd);
     return -ENOENT;
   }
 
   filesize = fileStat.st_size;
 
-  num_blocks = filesize / FW_BLOCK_SIZE;
-  if (filesize % FW_BLOCK_SIZE != 0) {
-    num_blocks++;
-  }
-
-  /* Allocate mem for FW filesize */
-  rom_buffer = (fwblock *)malloc(filesize);
-  if (!rom_buffer) {
-    printf("Failed to allocate memory\r\n");
-    fclose(rom);
-    return -ENOMEM;
-  }
-
-  num_read = fread(rom_buffer, 1, filesize, rom);
-  if (filesize != num_read) {
-    printf("Number of bytes read: %d\nNumber of bytes expected: %d\n", num_read,
-           num_blocks);
-    free(rom_buffer);
-    fclose(rom);
-    return -ENOENT;
+  /*
+   * The image is never held in memory: OS images run to several MB, so each
+   * block is read from the file straight into the request that sends it.
+   */
+  posix_fadvise(fd, 0, filesize, POSIX_FADV_SEQUENTIAL);
+
+  /* a corrupt or truncated file is caught here, not after the transfer */
+  rc = fw_image_crc(fd, filesize, &image_crc);
+  if (rc) {
+    printf("Failed to read %s: %s\n", fw_params->filepath, strerror(-rc));
+    goto out;
+  }
+  printf("Image crc32c: 0x%08x\n", image_crc);
+  if (fw_params->crc32c) {
+    errno = 0;
+    expected_crc = strtoul(fw_params->crc32c, &end, 16);
+    if (errno || *end || end == fw_params->crc32c) {
+      printf("Invalid crc32c %s\n", fw_params->crc32c);
+      rc = -EINVAL;
+      goto out;
+    }
+    if (expected_crc != image_crc) {
+      printf("Image crc32c 0x%08x does not match the expected 0x%08x, not "
+             "transferring\n",
+             image_crc, expected_crc);
+      rc = -EBADMSG;
+      goto out;
+    }
   }
 
   offset = 0;
@@ -473,28 +812,76 @@ int cxl_cmd_update_device_fw(struct cxlmi_endpoint *ep, bool is_os,
     }
   }
 
-  struct cxlmi_cmd_transfer_fw *transfer_fw_input = NULL;
   struct cxlmi_cmd_hbo_status_fields hbo_status;
+  struct cxlmi_backoff backoff;
+
+  block_size = fw_block_size(ep, opcode == std_opcode, filesize);
+
+  /*
+   * Progress is checkpointed per device, so that a transfer left open by a
+   * timeout can be continued with --resume where it stopped. Any other
+   * transfer left open is aborted first, or INITIATE_TRANSFER is refused.
+   */
+  if (fw_checkpoint_init(&ck, ep, opcode, fw_params->slot, filesize,
+                         image_crc) == 0 &&
+      fw_checkpoint_load(ep, &saved) == 0) {
+    if (fw_params->resume && fw_checkpoint_match(&saved, &ck) &&
+        saved.nr_blocks == (filesize + saved.block_size - 1) /
+                               saved.block_size) {
+      ck = saved;
+      block_size = saved.block_size;
+      first_block = saved.next_block;
+      percent_to_print = first_block * 100 / saved.nr_blocks / 10 * 10;
+      printf("Resuming at block %d of %d\n", first_block, saved.nr_blocks);
+    } else {
+      stale = true;
+    }
+  } else if (fw_params->resume) {
+    printf("No checkpoint for this image, starting from block 0\n");
+  }
+
+  /* One message, sized for a full block, reused for every block */
+  req = calloc(1, sizeof(*req) + sizeof(*transfer_fw_input) + block_size);
+  if (!req) {
+    printf("Failed to allocate memory\r\n");
+    rc = -ENOMEM;
+    goto out;
+  }
+  transfer_fw_input = (struct cxlmi_cmd_transfer_fw *)req->payload;
+
+  if (stale) {
+    printf("Aborting the transfer left open at block %d of %d\n",
+           saved.next_block, saved.nr_blocks);
+    fw_abort_transfer(ep, saved.opcode, req);
+    fw_checkpoint_remove(ep);
+  }
+  if (ck.serial)
+    ck_fd = fw_checkpoint_open(ep);
+
+  fw_telemetry_init(&tel, ep, fw_params->telemetry, fw_params->telemetry_json);
+
+restart:
+  num_blocks = filesize / block_size;
+  if (filesize % block_size != 0) {
+    num_blocks++;
+  }
+  printf("Transferring %d bytes in blocks of %d bytes\n", filesize,
+         block_size);
 
   /* Trasfer chunks of FW in blocks */
-  for (int i = 0; i < num_blocks; i++) {
-    offset = i * (FW_BLOCK_SIZE / FW_BYTE_ALIGN);
+  for (int i = first_block; i < num_blocks; i++) {
+    offset = i * (block_size / FW_BYTE_ALIGN);
 
     if ((i * 100) / num_blocks >= percent_to_print) {
       printf("%d percent complete. Transfering block %d of %d at offset 0x%x\n",
              percent_to_print, i, num_blocks, offset);
+      if (fw_params->progress)
+        fw_params->progress(ep, percent_to_print);
       percent_to_print = percent_to_print + 10;
     }
-    size = FW_BLOCK_SIZE;
-    if (i == num_blocks - 1 && filesize % FW_BLOCK_SIZE != 0) {
-      size = filesize % FW_BLOCK_SIZE;
-    }
-
-    transfer_fw_input = calloc(1, sizeof(*transfer_fw_input) + size);
-    if (!transfer_fw_input) {
-      printf("Failed to allocate memory\r\n");
-      rc = -ENOMEM;
-      goto out;
+    size = block_size;
+    if (i == num_blocks - 1 && filesize % block_size != 0) {
+      size = filesize % block_size;
     }
 
     if (i == 0)
@@ -505,87 +892,176 @@ int cxl_cmd_update_device_fw(struct cxlmi_endpoint *ep, bool is_os,
       transfer_fw_input->action = CONTINUE_TRANSFER;
     transfer_fw_input->slot = fw_params->slot;
 
-    transfer_fw_input->offset = offset;
-    memcpy(transfer_fw_input->data, &rom_buffer[i], size);
-
-    if (opcode == std_opcode) {
-      rc = cxlmi_cmd_transfer_fw(ep, NULL, transfer_fw_input);
-    } else {
-      rc = cxlmi_cmd_vendor_transfer_fw(ep, NULL, transfer_fw_input, opcode);
+    rc = fw_read_image(fd, transfer_fw_input->data, size,
+                       (off_t)i * block_size);
+    if (rc) {
+      printf("Failed to read block %d of %s: %s\n", i, fw_params->filepath,
+             strerror(-rc));
+      goto abort;
     }
-    retry_count = 0;
-    sleep_time = 10;
-    while (rc != 0) {
-      if (retry_count > max_retries) {
-        printf("Maximum %d retries exceeded while transferring block %d\n",
-               max_retries, i);
-        goto abort;
+    /*
+     * The last block may be short: pad it to FW_BYTE_ALIGN (FW_BLOCK_SIZE
+     * for the spec transfer), without resending the previous block's tail.
+     */
+    xfer_size = opcode == std_opcode ? FW_BLOCK_SIZE : FW_ALIGN_UP(size);
+    if (size < xfer_size)
+      memset(transfer_fw_input->data + size, 0, xfer_size - size);
+
+    blk_xfer_ns = 0;
+    blk_retries = 0;
+    rc = fw_transfer_block_timed(ep, opcode, req, offset, xfer_size,
+                                 &tel, &blk_xfer_ns);
+    if (rc && !cxlmi_ret_transient(rc) && i == 0 &&
+        block_size > FW_BLOCK_SIZE) {
+      /* nothing started yet, the device may not take blocks this large */
+      printf("%d byte blocks rejected (%d), falling back to %d\n", block_size,
+             rc, FW_BLOCK_SIZE);
+      block_size = FW_BLOCK_SIZE;
+      percent_to_print = 0;
+      goto restart;
+    }
+    if (rc && !cxlmi_ret_transient(rc) && i == first_block && i > 0) {
+      /* e.g. the device was reset and has no transfer open any more */
+      printf("Device refused to resume at block %d (%d), restarting\n", i,
+             rc);
+      fw_abort_transfer(ep, opcode, req);
+      first_block = 0;
+      ck.next_block = 0;
+      percent_to_print = 0;
+      goto restart;
+    }
+    cxlmi_backoff_init(&backoff, FW_RETRY_MIN_MS, FW_RETRY_MAX_MS,
+                       FW_RETRY_TIMEOUT_MS);
+    while (cxlmi_ret_transient(rc)) {
+      start = cxlmi_timing_now();
+      if (cxlmi_backoff_wait(&backoff)) {
+        printf("Timed out after %ds retrying block %d\n",
+               FW_RETRY_TIMEOUT_MS / 1000, i);
+        goto timeout;
       }
+      tel.backoff_ns += cxlmi_timing_now() - start;
+      tel.retries++;
+      blk_retries++;
 
-      sleep(sleep_time);
-
-      if (opcode == std_opcode) {
-        rc = cxlmi_cmd_transfer_fw(ep, NULL, transfer_fw_input);
-      } else {
-        rc = cxlmi_cmd_vendor_transfer_fw(ep, NULL, transfer_fw_input, opcode);
-      }
-      retry_count++;
+      rc = fw_transfer_block_timed(ep, opcode, req, offset, xfer_size,
+                                   &tel, &blk_xfer_ns);
     }
+    /* the hbo opcodes may report the block as started in the background */
+    if (rc == CXLMI_RET_BACKGROUND)
+      rc = 0;
 
     if (rc != 0) {
-      printf("transfer_fw failed on %d of %d\n", i, num_blocks);
+      printf("transfer_fw failed on %d of %d: %s\n", i, num_blocks,
+             rc > 0 && rc < (int)ARRAY_SIZE(TRANSFER_FW_ERRORS)
+                 ? TRANSFER_FW_ERRORS[rc]
+                 : "Unknown");
       goto abort;
     }
 
-    rc = cxlmi_cmd_get_hbo_status(ep, NULL, &hbo_status);
-    retry_count = 0;
-    sleep_time = 10;
-    while (rc != 0) {
-      if (retry_count > max_retries) {
-        printf("Maximum %d retries exceeded for hbo_status of block %d\n",
-               max_retries, i);
-        goto abort;
-      }
-
-      sleep(sleep_time);
-
-      rc = cxlmi_cmd_get_hbo_status(ep, NULL, &hbo_status);
-      retry_count++;
-    }
-
+    blk_polls = 0;
+    start = cxlmi_timing_now();
+    rc = cxlmi_hbo_wait_count(ep, NULL, FW_HBO_TIMEOUT_MS, &hbo_status,
+                              &blk_polls);
+    blk_hbo_ns = cxlmi_timing_now() - start;
+    tel.hbo_ns += blk_hbo_ns;
+    tel.hbo_polls += blk_polls;
     if (rc != 0) {
+      if (rc == -ETIMEDOUT)
+        printf("Timed out after %ds waiting for hbo_status of block %d\n",
+               FW_HBO_TIMEOUT_MS / 1000, i);
       printf("transfer_fw failed on %d of %d\n", i, num_blocks);
+      if (rc == -ETIMEDOUT)
+        goto timeout;
       goto abort;
     }
 
+    tel.block_size = block_size;
+    fw_telemetry_block(&tel, i, num_blocks, offset, size, blk_xfer_ns,
+                       blk_hbo_ns, blk_polls, blk_retries);
+
+    ck.block_size = block_size;
+    ck.nr_blocks = num_blocks;
+    ck.next_block = i + 1;
+    if (ck_fd >= 0)
+      fw_checkpoint_write(ck_fd, &ck);
+
     if (fw_params->mock) {
       goto abort;
     }
-    if (transfer_fw_input) {
-      free(transfer_fw_input);
-      transfer_fw_input = NULL;
-    }
   }
 
+  if (fw_params->progress)
+    fw_params->progress(ep, 100);
+  rc = fw_verify_slot(ep, is_os, fw_params->slot, image_crc, filesize);
   goto out;
+timeout:
+  /* the link, not the image: leave the transfer open to be resumed */
+  if (ck_fd >= 0 && ck.next_block > 0) {
+    printf("Transfer left open at block %d of %d, rerun with --resume to "
+           "continue it\n",
+           ck.next_block, num_blocks);
+    keep_ckpt = true;
+    rc = -ETIMEDOUT;
+    goto out;
+  }
 abort:
-  sleep(2.0);
+  {
+    int abort_rc = fw_abort_transfer(ep, opcode, req);
 
-  transfer_fw_input->action = ABORT_TRANSFER;
-  transfer_fw_input->offset = FW_BLOCK_SIZE;
-  if (opcode == std_opcode) {
-    rc = cxlmi_cmd_transfer_fw(ep, NULL, transfer_fw_input);
-  } else {
-    rc = cxlmi_cmd_vendor_transfer_fw(ep, NULL, transfer_fw_input, opcode);
+    /* a mock transfer reports the abort, a failed one its own error */
+    if (!rc)
+      rc = abort_rc;
   }
 
 out:
-  if (transfer_fw_input) {
-    free(transfer_fw_input);
-    transfer_fw_input = NULL;
-  }
-  free(rom_buffer);
-  fclose(rom);
+  if (tel.start_ns)
+    fw_telemetry_report(&tel, rc);
+  if (ck_fd >= 0) {
+    close(ck_fd);
+    if (!keep_ckpt)
+      fw_checkpoint_remove(ep);
+  }
+  /* staged slot and revisions changed, or may have on a partial transfer */
+  cxlmi_cache_invalidate(ep);
+  free(req);
+  close(fd);
+
+  return rc;
+}
+
+/*
+ * Activate the image in slot: online, or on the next reset. Images sent
+ * with the hbo/OS vendor opcodes are activated through ACTIVATE_FW.
+ */
+int cxl_cmd_activate_fw(struct cxlmi_endpoint *ep, bool is_vendor,
+                        uint8_t action, uint8_t slot) {
+  struct cxlmi_cmd_activate_fw activate_fw = {
+      .action = action,
+      .slot = slot,
+  };
+  struct cxlmi_backoff backoff;
+  int rc;
+
+  cxlmi_backoff_init(&backoff, FW_RETRY_MIN_MS, FW_RETRY_MAX_MS,
+                     FW_RETRY_TIMEOUT_MS);
+  do {
+    if (is_vendor)
+      rc = cxlmi_cmd_vendor_activate_fw(ep, NULL, &activate_fw);
+    else
+      rc = cxlmi_cmd_activate_fw(ep, NULL, &activate_fw);
+  } while (cxlmi_ret_transient(rc) && !cxlmi_backoff_wait(&backoff));
+
+  if (rc == CXLMI_RET_BACKGROUND)
+    rc = cxlmi_hbo_wait(ep, NULL, FW_HBO_TIMEOUT_MS, NULL);
+
+  /* the active or staged slot changed */
+  cxlmi_cache_invalidate(ep);
+
+  if (rc)
+    printf("%s: activate fw slot %d failed: %d\n", get_devname(ep), slot, rc);
+  else
+    printf("%s: fw slot %d activated %s\n", get_devname(ep), slot,
+           action == ACTIVATE_ONLINE ? "online" : "for the next reset");
 
   return rc;
 }
@@ -610,6 +1086,7 @@ int cxl_cmd_set_timestamp(struct cxlmi_endpoint *ep, uint64_t timestamp) {
 
   ts.timestamp = cpu_to_le64(timestamp);
   printf("setting timestamp to: 0x%lx\n", le64_to_cpu(ts.timestamp));
+  cxlmi_cache_invalidate(ep);
   rc = cxlmi_cmd_set_timestamp(ep, NULL, &ts);
   if (rc)
     return rc;
@@ -619,6 +1096,32 @@ int cxl_cmd_set_timestamp(struct cxlmi_endpoint *ep, uint64_t timestamp) {
   return rc;
 }
 
+static void print_event_record(struct cxlmi_event_record *record, int rec,
+                               int indent) {
+  const struct cxl_event_decoder *dec = cxl_event_decoder_find(record);
+  char uuid[40];
+
+  uuid_unparse(record->uuid, uuid);
+  if (dec)
+    printf("%*sEvent Record: %d (%s guid: %s)\n", indent, "", rec, dec->name,
+           uuid);
+  else
+    printf("%*sEvent Record: %d (uuid: %s)\n", indent, "", rec, uuid);
+
+  printf("%*sevent_record_length: 0x%x\n", indent + 2, "", record->length);
+  printf("%*sevent_record_flags: 0x%02x%02x%02x\n", indent + 2, "",
+         record->flags[0], record->flags[1], record->flags[2]);
+  printf("%*sevent_record_handle: 0x%x\n", indent + 2, "",
+         le16_to_cpu(record->handle));
+  printf("%*srelated_event_record_handle: 0x%x\n", indent + 2, "",
+         le16_to_cpu(record->related_handle));
+  printf("%*sevent_record_ts: 0x%lx\n", indent + 2, "",
+         le64_to_cpu(record->timestamp));
+
+  if (dec)
+    cxl_event_decode_print(dec, record, indent + 2);
+}
+
 int cxl_cmd_get_event_records(struct cxlmi_endpoint *ep, uint8_t type) {
   int rc;
   struct cxlmi_cmd_get_event_records_rsp *event_records;
@@ -656,30 +1159,8 @@ int cxl_cmd_get_event_records(struct cxlmi_endpoint *ep, uint8_t type) {
     printf("%*sevent_record_count: 0x%x\n", indent, "",
            (event_records->record_count));
 
-    for (int rec = 0; rec < event_records->record_count; rec++) {
-      char uuid[40];
-      struct cxlmi_event_record *record = &event_records->records[rec];
-      uuid_unparse(record->uuid, uuid);
-      if (strcmp(uuid, CXL_DRAM_EVENT_GUID) == 0)
-        printf("%*sEvent Record: %d (DRAM guid: %s)\n", indent, "", rec, uuid);
-      else if (strcmp(uuid, CXL_MEM_MODULE_EVENT_GUID) == 0)
-        printf("%*sEvent Record: %d (Memory Module Event guid: %s)\n", indent,
-               "", rec, uuid);
-      else
-        printf("%*sEvent Record: %d (uuid: %s)\n", indent, "", rec, uuid);
-
-      printf("%*sevent_record_length: 0x%x\n", indent + 2, "", record->length);
-      printf("%*sevent_record_flags: 0x%02x%02x%02x\n", indent + 2, "",
-             record->flags[0], record->flags[1], record->flags[2]);
-      printf("%*sevent_record_handle: 0x%x\n", indent + 2, "",
-             le16_to_cpu(record->handle));
-      printf("%*srelated_event_record_handle: 0x%x\n", indent + 2, "",
-             le16_to_cpu(record->related_handle));
-      printf("%*sevent_record_ts: 0x%lx\n", indent + 2, "",
-             le64_to_cpu(record->timestamp));
-
-      /* TODO: Add a loop to print dram event_record data */
-    }
+    for (int rec = 0; rec < event_records->record_count; rec++)
+      print_event_record(&event_records->records[rec], rec, indent);
   }
 
   free(event_records);
@@ -687,35 +1168,458 @@ int cxl_cmd_get_event_records(struct cxlmi_endpoint *ep, uint8_t type) {
   return rc;
 }
 
-int cxl_cmd_clear_event_records(struct cxlmi_endpoint *ep, uint8_t type,
-                                uint8_t flags, uint16_t handles) {
+/* Clear Event Records takes a u8 count of handles */
+#define CXL_CLEAR_EVENT_MAX_HANDLES 255
+
+const char *const cxl_event_log_names[CXL_EVENT_LOG_NR] = {
+    "information", "warning", "failure", "fatal"};
+
+/* One line per record: device, log, handle, the whole record in hex */
+static int event_page_persist(int fd, struct cxlmi_endpoint *ep, uint8_t log,
+                              struct cxlmi_cmd_get_event_records_rsp *page) {
+  struct strbuf sb = STRBUF_INIT;
+  const uint8_t *p;
   int rc;
+
+  for (int rec = 0; rec < page->record_count; rec++) {
+    strbuf_addf(&sb, "%s %u 0x%04x ", get_devname(ep), log,
+                le16_to_cpu(page->records[rec].handle));
+    p = (const uint8_t *)&page->records[rec];
+    for (size_t i = 0; i < sizeof(page->records[rec]); i++)
+      strbuf_addf(&sb, "%02x", p[i]);
+    strbuf_addch(&sb, '\n');
+  }
+
+  /* the page is only cleared once it is on disk */
+  rc = cxlmi_write_full(fd, sb.buf, sb.len);
+  if (!rc && fdatasync(fd))
+    rc = -errno;
+  strbuf_release(&sb);
+  return rc;
+}
+
+/*
+ * Clear handles[] from log type, packing as many handles into each Clear
+ * Event Records as payload_max and its u8 count allow.
+ */
+int cxl_event_clear_handles(struct cxlmi_endpoint *ep, uint8_t type,
+                            const uint16_t *handles, int nr) {
+  _cleanup_free_ struct cxlmi_cmd_clear_event_records *clear = NULL;
+  int payload_max, max, n, rc;
+
+  payload_max = get_cxl_maxpayload(ep);
+  max = (payload_max - (int)sizeof(*clear)) / (int)sizeof(uint16_t);
+  if (payload_max <= 0 || max > CXL_CLEAR_EVENT_MAX_HANDLES)
+    max = CXL_CLEAR_EVENT_MAX_HANDLES;
+  if (max < 1)
+    max = 1;
+
+  clear = calloc(1, sizeof(*clear) + max * sizeof(uint16_t));
+  if (!clear)
+    return -ENOMEM;
+
+  for (int i = 0; i < nr; i += n) {
+    n = nr - i < max ? nr - i : max;
+
+    clear->event_log = type;
+    clear->clear_flags = 0;
+    clear->nr_recs = n;
+    for (int j = 0; j < n; j++)
+      clear->handles[j] = cpu_to_le16(handles[i + j]);
+    rc = cxlmi_cmd_clear_event_records(ep, NULL, clear);
+    if (rc)
+      return rc;
+  }
+
+  return 0;
+}
+
+static int event_page_clear(struct cxlmi_endpoint *ep, uint8_t log,
+                            struct cxlmi_cmd_get_event_records_rsp *page) {
+  _cleanup_free_ uint16_t *handles = NULL;
+
+  handles = calloc(page->record_count, sizeof(*handles));
+  if (!handles)
+    return -ENOMEM;
+  for (int rec = 0; rec < page->record_count; rec++)
+    handles[rec] = le16_to_cpu(page->records[rec].handle);
+
+  return cxl_event_clear_handles(ep, log, handles, page->record_count);
+}
+
+/*
+ * Read every record of the four event logs, following More Event Records.
+ * The device keeps returning its oldest records until they are cleared, so
+ * only with clear does the drain get past the first page of a log; each
+ * page is then cleared once it has been appended to output.
+ */
+int cxl_cmd_drain_event_records(struct cxlmi_endpoint *ep, bool clear,
+                                const char *output) {
+  struct strbuf arena[CXL_EVENT_LOG_NR];
+  struct cxlmi_cmd_get_event_records_rsp *page;
+  struct cxlmi_cmd_get_event_records_req req;
+  uint16_t overflow[CXL_EVENT_LOG_NR] = {};
+  bool more[CXL_EVENT_LOG_NR] = {};
+  int payload_max, fd = -1, rc = 0;
+  int indent = 2;
+  size_t nr;
+
+  if (clear && !output) {
+    printf("--clear needs --output, so that no record is lost\n");
+    return -EINVAL;
+  }
+
+  payload_max = get_cxl_maxpayload(ep);
+  if (payload_max <= (int)sizeof(*page))
+    payload_max = CXL_EVENT_PAGE_MAX;
+  page = calloc(1, payload_max);
+  if (!page) {
+    printf("Failed to allocate memory\r\n");
+    return -ENOMEM;
+  }
+
+  if (output) {
+    fd = open(output, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      printf("Cannot open %s: %s\n", output, strerror(errno));
+      free(page);
+      return -errno;
+    }
+  }
+
+  for (int log = 0; log < CXL_EVENT_LOG_NR; log++)
+    strbuf_init(&arena[log], 0);
+
+  for (int log = 0; log < CXL_EVENT_LOG_NR; log++) {
+    for (;;) {
+      req.event_log = log;
+      rc = cxlmi_cmd_get_event_records(ep, NULL, &req, page);
+      if (rc) {
+        printf("%s: get %s event records failed: %d\n", get_devname(ep),
+               cxl_event_log_names[log], rc);
+        goto out;
+      }
+      if (page->flags & CXL_EVENT_FLAG_OVERFLOW)
+        overflow[log] = page->overflow_err_count;
+      if (!page->record_count)
+        break;
+
+      strbuf_add(&arena[log], page->records,
+                 page->record_count * sizeof(page->records[0]));
+      if (fd >= 0) {
+        rc = event_page_persist(fd, ep, log, page);
+        if (rc) {
+          printf("Cannot write %s: %s\n", output, strerror(-rc));
+          goto out;
+        }
+      }
+      if (clear) {
+        rc = event_page_clear(ep, log, page);
+        if (rc) {
+          printf("%s: clear %s event records failed: %d\n", get_devname(ep),
+                 cxl_event_log_names[log], rc);
+          goto out;
+        }
+      }
+
+      if (!(page->flags & CXL_EVENT_FLAG_MORE_RECORDS))
+        break;
+      if (!clear) {
+        more[log] = true;
+        break;
+      }
+    }
+  }
+
+out:
+  printf("========= Drain Event Records : %s =========\n", get_devname(ep));
+  for (int log = 0; log < CXL_EVENT_LOG_NR; log++) {
+    struct cxlmi_event_record *records = (void *)arena[log].buf;
+
+    nr = arena[log].len / sizeof(*records);
+    printf("%*s%s log: %zu record(s)%s\n", indent, "",
+           cxl_event_log_names[log], nr,
+           more[log] ? ", more pending (drain with --clear)" : "");
+    if (overflow[log])
+      printf("%*soverflow_err_cnt: 0x%x\n", indent + 2, "", overflow[log]);
+    for (size_t rec = 0; rec < nr; rec++)
+      print_event_record(&records[rec], rec, indent + 2);
+    strbuf_release(&arena[log]);
+  }
+
+  if (fd >= 0)
+    close(fd);
+  free(page);
+
+  return rc;
+}
+
+/* By handle, then by timestamp */
+static int event_handle_cmp(const void *a, const void *b) {
+  const struct cxl_event_handle *x = a, *y = b;
+
+  if (x->handle != y->handle)
+    return (int)x->handle - (int)y->handle;
+  return (x->timestamp > y->timestamp) - (x->timestamp < y->timestamp);
+}
+
+/* First of the sorted handles[] that is not below handle */
+static int event_handle_find(const struct cxl_event_handle *handles, int nr,
+                             uint16_t handle) {
+  int lo = 0, hi = nr, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (handles[mid].handle < handle)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+enum { EVENT_HANDLE_PENDING, EVENT_HANDLE_CLEARED, EVENT_HANDLE_STALE };
+
+/*
+ * Of the records in page, those that the sorted handles[] name with a
+ * matching timestamp go to clear[]; the others holding a handle that was
+ * asked for are newer records that reused it. Returns the number of
+ * handles put in clear[].
+ */
+static int event_page_match(const struct cxlmi_cmd_get_event_records_rsp *page,
+                            const struct cxl_event_handle *handles, int nr,
+                            uint8_t *state, uint16_t *clear) {
+  const struct cxlmi_event_record *r;
+  int i, first, n = 0;
+  uint64_t ts;
+  uint16_t h;
+  bool match;
+
+  for (int rec = 0; rec < page->record_count; rec++) {
+    r = &page->records[rec];
+    h = le16_to_cpu(r->handle);
+    ts = le64_to_cpu(r->timestamp);
+    first = event_handle_find(handles, nr, h);
+    if (first == nr || handles[first].handle != h ||
+        state[first] != EVENT_HANDLE_PENDING)
+      continue;
+
+    match = false;
+    for (i = first; i < nr && handles[i].handle == h; i++)
+      match |= !handles[i].timestamp || handles[i].timestamp == ts;
+    for (i = first; i < nr && handles[i].handle == h; i++)
+      state[i] = match ? EVENT_HANDLE_CLEARED : EVENT_HANDLE_STALE;
+    if (match)
+      clear[n++] = h;
+  }
+
+  return n;
+}
+
+/*
+ * Clear the records of log type that the sorted handles[] name. The device
+ * returns its oldest records first, so those past the first page only show
+ * up once the ones before them are cleared: read a page, clear what it
+ * holds of handles[], and read again until a page holds none of them. A
+ * handle is only sent while its record still has the timestamp it was
+ * listed with; it may since have been cleared and reused by a newer record
+ * that was never saved.
+ */
+int cxl_cmd_clear_event_records(struct cxlmi_endpoint *ep, uint8_t type,
+                                uint8_t flags,
+                                const struct cxl_event_handle *handles,
+                                int nr) {
+  _cleanup_free_ struct cxlmi_cmd_get_event_records_rsp *page = NULL;
+  _cleanup_free_ uint16_t *clear = NULL;
+  _cleanup_free_ uint8_t *state = NULL;
+  struct cxlmi_cmd_get_event_records_req req = {.event_log = type};
   struct cxlmi_cmd_clear_event_records *event_records;
-  /* TODO: Currently only 1 event_handle can be passed */
+  int payload_max, n, cleared = 0, stale = 0, pending = 0, rc = 0;
+
   if (flags) {
     event_records = calloc(1, sizeof(*event_records));
     if (!event_records) {
       printf("Failed to allocate memory\r\n");
       return -ENOMEM;
     }
+    event_records->event_log = type;
+    event_records->clear_flags = flags;
     event_records->nr_recs = 0;
-  } else {
-    event_records = calloc(1, sizeof(*event_records) + sizeof(uint16_t));
-    if (!event_records) {
-      printf("Failed to allocate memory\r\n");
-      return -ENOMEM;
-    }
-    event_records->nr_recs = 1;
-    event_records->handles[0] = cpu_to_le16(handles);
+    rc = cxlmi_cmd_clear_event_records(ep, NULL, event_records);
+    free(event_records);
+    if (!rc)
+      printf("Clear Event Records command completed successfully\n");
+    return rc;
   }
-  event_records->event_log = type;
-  rc = cxlmi_cmd_clear_event_records(ep, NULL, event_records);
-  if (!rc) {
+
+  payload_max = get_cxl_maxpayload(ep);
+  if (payload_max <= (int)sizeof(*page))
+    payload_max = CXL_EVENT_PAGE_MAX;
+  page = calloc(1, payload_max);
+  clear = calloc(nr, sizeof(*clear));
+  state = calloc(nr, sizeof(*state));
+  if (!page || !clear || !state) {
+    printf("Failed to allocate memory\r\n");
+    return -ENOMEM;
+  }
+
+  /* each pass clears at least one of handles[], or is the last */
+  while (cleared < nr) {
+    rc = cxlmi_cmd_get_event_records(ep, NULL, &req, page);
+    if (rc) {
+      printf("%s: get event records failed: %d\n", get_devname(ep), rc);
+      return rc;
+    }
+    n = event_page_match(page, handles, nr, state, clear);
+    if (!n)
+      break;
+    rc = cxl_event_clear_handles(ep, type, clear, n);
+    if (rc)
+      return rc;
+    cleared += n;
+  }
+
+  for (int i = 0; i < nr; i++) {
+    stale += state[i] == EVENT_HANDLE_STALE;
+    pending += state[i] == EVENT_HANDLE_PENDING;
+  }
+  if (stale)
+    printf("%s: %d handle(s) now hold a newer record, left alone\n",
+           get_devname(ep), stale);
+  if (pending)
+    printf("%s: %d handle(s) not in the log, or behind records that were "
+           "not asked for, left alone\n",
+           get_devname(ep), pending);
+  if (cleared)
     printf("Clear Event Records command completed successfully\n");
+
+  return 0;
+}
+
+/* Hex, with or without 0x, as get-event-records prints handles */
+static unsigned long event_handle_parse(const char *p, char **end) {
+  if (!isxdigit((unsigned char)*p)) {
+    *end = (char *)p;
+    return 0;
   }
+  return strtoul(p, end, 16);
+}
 
-  free(event_records);
+static int event_handles_add(struct cxl_event_handle **handles, int *nr,
+                             int *alloc, unsigned long first,
+                             unsigned long last, uint64_t timestamp) {
+  struct cxl_event_handle *h;
+
+  if (first > last || last > UINT16_MAX)
+    return -ERANGE;
+
+  for (unsigned long v = first; v <= last; v++) {
+    if (*nr == *alloc) {
+      *alloc = *alloc ? *alloc * 2 : 64;
+      h = realloc(*handles, *alloc * sizeof(*h));
+      if (!h)
+        return -ENOMEM;
+      *handles = h;
+    }
+    (*handles)[*nr].handle = v;
+    (*handles)[*nr].timestamp = timestamp;
+    (*nr)++;
+  }
+
+  return 0;
+}
+
+/* The timestamp of a record as event_page_persist() wrote it out in hex */
+static int event_record_timestamp(const char *hex, uint64_t *timestamp) {
+  size_t off = offsetof(struct cxlmi_event_record, timestamp);
+  unsigned char b[sizeof(*timestamp)];
+  char byte[3] = {0};
+
+  if (strspn(hex, "0123456789abcdefABCDEF") <
+      2 * sizeof(struct cxlmi_event_record))
+    return -EINVAL;
+
+  for (size_t i = 0; i < sizeof(b); i++) {
+    memcpy(byte, hex + 2 * (off + i), 2);
+    b[i] = strtoul(byte, NULL, 16);
+  }
+  memcpy(timestamp, b, sizeof(b));
+  *timestamp = le64_to_cpu(*timestamp);
+
+  return 0;
+}
+
+/*
+ * Records to clear from log type of ep: a list of handles such as
+ * "0x10,0x12-0x20", and/or the records of ep and type in a
+ * get-event-records --output file, with their timestamps. Returns the
+ * number of distinct entries, sorted in a new *handles.
+ */
+int cxl_parse_event_handles(struct cxlmi_endpoint *ep, uint8_t type,
+                            const char *list, const char *from,
+                            struct cxl_event_handle **handles) {
+  unsigned long first, last;
+  unsigned int log, handle;
+  int nr = 0, n = 0, alloc = 0, pos, rc = 0;
+  char line[512], dev[64];
+  const char *p = list;
+  uint64_t timestamp;
+  char *end;
+  FILE *fp;
+
+  *handles = NULL;
+  while (p && *p) {
+    errno = 0;
+    first = last = event_handle_parse(p, &end);
+    if (end != p && *end == '-') {
+      p = end + 1;
+      last = event_handle_parse(p, &end);
+    }
+    if (errno || end == p || (*end && *end != ',')) {
+      printf("Invalid event record handle list: %s\n", list);
+      rc = -EINVAL;
+      goto err;
+    }
+    rc = event_handles_add(handles, &nr, &alloc, first, last, 0);
+    if (rc) {
+      printf("Invalid event record handle range in: %s\n", list);
+      goto err;
+    }
+    p = *end ? end + 1 : end;
+  }
 
+  if (from) {
+    fp = fopen(from, "r");
+    if (!fp) {
+      rc = -errno;
+      printf("Cannot open %s: %s\n", from, strerror(-rc));
+      goto err;
+    }
+    /* device, log, handle, then the record in hex, see event_page_persist() */
+    while (fgets(line, sizeof(line), fp)) {
+      if (sscanf(line, "%63s %u %x %n", dev, &log, &handle, &pos) != 3 ||
+          log != type || strcmp(dev, get_devname(ep)) ||
+          event_record_timestamp(line + pos, &timestamp))
+        continue;
+      rc = event_handles_add(handles, &nr, &alloc, handle, handle, timestamp);
+      if (rc)
+        break;
+    }
+    fclose(fp);
+    if (rc)
+      goto err;
+  }
+
+  qsort(*handles, nr, sizeof(**handles), event_handle_cmp);
+  for (int i = 0; i < nr; i++) {
+    if (!n || event_handle_cmp(&(*handles)[n - 1], &(*handles)[i]))
+      (*handles)[n++] = (*handles)[i];
+  }
+
+  return n;
+err:
+  free(*handles);
+  *handles = NULL;
   return rc;
 }
 
@@ -794,7 +1698,11 @@ int cxl_cmd_dimm_spd_read(struct cxlmi_endpoint *ep, uint32_t spd_id,
     }
   }
 
-  rc = cxlmi_cmd_dimm_spd_read(ep, NULL, &spd_read_req, spd_data);
+  /* keyed by the request, so each spd/offset/length is its own entry */
+  rc = cxl_cached_cmd(ep, CACHE_SPD_READ, &spd_read_req, sizeof(spd_read_req),
+                      spd_data,
+                      spd_data ? sizeof(spd_data->dimm_spd_data) : 0,
+                      cached_spd_read);
   if (!rc) {
     ram_type = decode_ram_type(spd_data->dimm_spd_data);
 
@@ -850,7 +1758,8 @@ int cxl_cmd_dimm_slot_info(struct cxlmi_endpoint *ep) {
   char silk_screen_char;
   u8 *dimm_slots;
 
-  rc = cxlmi_cmd_dimm_slot_info(ep, NULL, &dimm_slot_info);
+  rc = cxl_cached_cmd(ep, CACHE_SLOT_INFO, NULL, 0, &dimm_slot_info,
+                      sizeof(dimm_slot_info), cached_slot_info);
   if (!rc) {
     dimm_slots = (uint8_t *)&dimm_slot_info;
     printf("=========================== DIMM SLOT INFO : %s  "
@@ -1194,7 +2103,8 @@ int cxl_cmd_get_device_info(struct cxlmi_endpoint *ep) {
   int rc;
   struct cxlmi_cmd_get_device_info device_info;
 
-  rc = cxlmi_cmd_get_device_info(ep, NULL, &device_info);
+  rc = cxl_cached_cmd(ep, CACHE_DEVICE_INFO, NULL, 0, &device_info,
+                      sizeof(device_info), cached_device_info);
   if (!rc) {
     printf("Device Info: %s\n", get_devname(ep));
     printf("Device id: 0x%x\n", device_info.device_id);
@@ -1290,6 +2200,7 @@ int cxl_cmd_reboot_mode_set(struct cxlmi_endpoint *ep, uint8_t reboot_mode) {
 
   reboot_mode_set.reboot_mode = reboot_mode;
 
+  cxlmi_cache_invalidate(ep);
   rc = cxlmi_cmd_reboot_mode_set(ep, NULL, &reboot_mode_set);
   if (!rc) {
     printf("REBOOT MODE SET : %s\n", get_devname(ep));
@@ -1531,6 +2442,160 @@ int cxl_cmd_trigger_coredump(struct cxlmi_endpoint *ep) {
   return rc;
 }
 
+#define COREDUMP_TIMEOUT_S 60
+#define COREDUMP_POLL_MIN_MS 100
+#define COREDUMP_POLL_MAX_MS 2000
+#ifdef CONFIG_ZLIB
+#define COREDUMP_SUFFIX ".bin.gz"
+#else
+#define COREDUMP_SUFFIX ".bin"
+#endif
+
+struct coredump_out {
+  int fd;
+#ifdef CONFIG_ZLIB
+  gzFile gz;
+#endif
+};
+
+static int coredump_write(const void *chunk, uint32_t len, void *priv) {
+  struct coredump_out *out = priv;
+
+#ifdef CONFIG_ZLIB
+  return gzwrite(out->gz, chunk, len) == (int)len ? 0 : -EIO;
+#else
+  return cxlmi_write_full(out->fd, chunk, len);
+#endif
+}
+
+/* Flush and close out; the data is on disk once this returns 0 */
+static int coredump_close(struct coredump_out *out, int rc) {
+#ifdef CONFIG_ZLIB
+  if (!rc && gzflush(out->gz, Z_FINISH) != Z_OK)
+    rc = -EIO;
+  if (!rc && fdatasync(out->fd))
+    rc = -errno;
+  /* closes fd too */
+  if (gzclose(out->gz) != Z_OK && !rc)
+    rc = -EIO;
+#else
+  if (!rc && fdatasync(out->fd))
+    rc = -errno;
+  if (close(out->fd) && !rc)
+    rc = -errno;
+#endif
+  return rc;
+}
+
+static int coredump_open(struct coredump_out *out, const char *path) {
+  out->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (out->fd < 0)
+    return -errno;
+#ifdef CONFIG_ZLIB
+  out->gz = gzdopen(out->fd, "wb");
+  if (!out->gz) {
+    close(out->fd);
+    return -ENOMEM;
+  }
+#endif
+  return 0;
+}
+
+/* A directory, the default ".", gets <dev>-coredump-<time> in it */
+static void coredump_path(struct cxlmi_endpoint *ep, const char *output,
+                          char *path, size_t len) {
+  char stamp[32];
+  struct stat st;
+  time_t now;
+
+  if (!output)
+    output = ".";
+  if (stat(output, &st) || !S_ISDIR(st.st_mode)) {
+    snprintf(path, len, "%s", output);
+    return;
+  }
+
+  now = time(NULL);
+  strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+  snprintf(path, len, "%s/%s-coredump-%s" COREDUMP_SUFFIX, output,
+           get_devname(ep), stamp);
+}
+
+/*
+ * Trigger a coredump, wait for the vendor debug log to grow, then stream
+ * the log one payload_max chunk at a time into a (gzip, when built with
+ * zlib) file. The file is written as <path>.part and renamed once synced,
+ * so a path that exists always holds a whole dump.
+ */
+int cxl_cmd_collect_coredump(struct cxlmi_endpoint *ep, const char *output,
+                             uint32_t timeout_s, bool no_trigger) {
+  char path[PATH_MAX], part[PATH_MAX + 8];
+  struct coredump_out out;
+  struct cxlmi_backoff b;
+  uint32_t before, size;
+  int rc;
+
+  rc = cxlmi_get_log_size(ep, NULL, ven_dbg, &before);
+  if (rc) {
+    printf("%s: get supported logs failed: %d\n", get_devname(ep), rc);
+    return rc;
+  }
+  size = before;
+
+  if (!no_trigger) {
+    rc = cxlmi_cmd_trigger_coredump(ep, NULL);
+    if (rc) {
+      printf("%s: trigger coredump failed: %d\n", get_devname(ep), rc);
+      return rc;
+    }
+
+    /* the dump is in once the debug log has grown */
+    cxlmi_backoff_init(&b, COREDUMP_POLL_MIN_MS, COREDUMP_POLL_MAX_MS,
+                       (timeout_s ? timeout_s : COREDUMP_TIMEOUT_S) * 1000);
+    for (;;) {
+      rc = cxlmi_get_log_size(ep, NULL, ven_dbg, &size);
+      if (!rc && size > before)
+        break;
+      if (rc && !cxlmi_ret_transient(rc)) {
+        printf("%s: get supported logs failed: %d\n", get_devname(ep), rc);
+        return rc;
+      }
+      if (cxlmi_backoff_wait(&b)) {
+        printf("%s: debug log still at %u byte(s), no coredump\n",
+               get_devname(ep), size);
+        return -ETIMEDOUT;
+      }
+    }
+  }
+  if (!size) {
+    printf("%s: no vendor debug log\n", get_devname(ep));
+    return -ENOENT;
+  }
+
+  coredump_path(ep, output, path, sizeof(path));
+  snprintf(part, sizeof(part), "%s.part", path);
+  rc = coredump_open(&out, part);
+  if (rc) {
+    printf("Cannot open %s: %s\n", part, strerror(-rc));
+    return rc;
+  }
+
+  rc = cxlmi_get_log_stream(ep, NULL, ven_dbg, size, NULL, coredump_write,
+                            &out);
+  rc = coredump_close(&out, rc);
+  if (!rc && rename(part, path))
+    rc = -errno;
+  if (rc) {
+    unlink(part);
+    printf("%s: collecting the coredump failed: %d\n", get_devname(ep), rc);
+    return rc;
+  }
+
+  printf("%s: coredump of %u byte(s) written to %s\n", get_devname(ep), size,
+         path);
+  return 0;
+}
+
 int cxl_cmd_ddr_stats_run(struct cxlmi_endpoint *ep, uint8_t ddr_id,
                           uint32_t monitor_time, uint32_t loop_count) {
   int rc;
@@ -1547,72 +2612,262 @@ int cxl_cmd_ddr_stats_run(struct cxlmi_endpoint *ep, uint8_t ddr_id,
   return rc;
 }
 
-#define MAX_CXL_TRANSFER_SZ (16 * 1024)
+/* Get chunk when payload_max cannot be read */
+#define DDR_STATS_CHUNK_DEF (16 * 1024)
+/* one chunk being formatted while the next one is on the mailbox */
+#define DDR_STATS_NR_BUFS 2
+
+static const struct {
+  void (*hdr)(FILE *f);
+  void (*row)(FILE *f, const ddr_stats_data_t *disp_stats, uint32_t loop);
+} ddr_stats_sections[] = {
+    {print_pmon_stats_hdr, print_pmon_stats_row},
+    {print_cs_pm_stats_hdr, print_cs_pm_stats_row},
+    {print_cs_bank_pm_stats_hdr, print_cs_bank_pm_stats_row},
+    {print_mc_pm_stats_hdr, print_mc_pm_stats_row},
+};
+
+#define DDR_STATS_NR_SECTIONS                                                  \
+  (sizeof(ddr_stats_sections) / sizeof(ddr_stats_sections[0]))
+
+/*
+ * Iterations are printed as they are read back, one section per read of
+ * the run: the device keeps the run until the next one is started, so the
+ * usual section order costs a Get pass per section rather than holding
+ * the run, or any of it, in host memory. With exp set, iterations go to a
+ * columnar file in a single pass instead (ddr_stats_export.h).
+ */
+struct ddr_stats_stream {
+  int section;
+  struct ddr_stats_export *exp;
+  ddr_stats_data_t partial; /* iteration split across two chunks */
+  uint32_t fill;
+  uint32_t loop;
+};
+
+struct ddr_stats_fetch {
+  struct cxlmi_cmd_ddr_stats_get_req req;
+  unsigned char *buf;
+  bool done;
+  int rc;
+};
+
+static void ddr_stats_stream_init(struct ddr_stats_stream *st,
+                                  struct ddr_stats_export *exp, int section) {
+  memset(st, 0, sizeof(*st));
+  st->exp = exp;
+  st->section = section;
+}
+
+static void ddr_stats_emit(struct ddr_stats_stream *st,
+                           const ddr_stats_data_t *s) {
+  if (st->exp)
+    ddr_stats_export_row(st->exp, s, st->loop);
+  else
+    ddr_stats_sections[st->section].row(stdout, s, st->loop);
+  st->loop++;
+}
 
-extern void display_pmon_stats(ddr_stats_data_t *disp_stats,
-                               uint32_t loop_count);
-extern void display_cs_pm_stats(ddr_stats_data_t *disp_stats,
-                                uint32_t loop_count);
-extern void display_cs_bank_pm_stats(ddr_stats_data_t *disp_stats,
-                                     uint32_t loop_count);
-extern void display_mc_pm_stats(ddr_stats_data_t *disp_stats,
-                                uint32_t loop_count);
+static void ddr_stats_consume(struct ddr_stats_stream *st,
+                              const unsigned char *p, uint32_t n) {
+  uint32_t take;
 
-int cxl_cmd_ddr_stats_get(struct cxlmi_endpoint *ep) {
-  int rc = 0;
-  int total_bytes = 0, bytes_to_cpy = 0, bytes_copied = 0;
-  ddr_stats_data_t *ddr_stats_start = NULL;
-  unsigned char *buf = NULL;
-  struct cxlmi_cmd_ddr_stats_status ddr_stats_status;
+  if (st->fill) {
+    take = sizeof(st->partial) - st->fill;
+    if (take > n)
+      take = n;
+    memcpy((unsigned char *)&st->partial + st->fill, p, take);
+    st->fill += take;
+    p += take;
+    n -= take;
+    if (st->fill < sizeof(st->partial))
+      return;
+    ddr_stats_emit(st, &st->partial);
+    st->fill = 0;
+  }
 
-  rc = cxlmi_cmd_ddr_stats_status(ep, NULL, &ddr_stats_status);
-  if (!rc) {
-    printf("DDR stats get : %s\n", get_devname(ep));
-    printf("%s\n", ddr_stats_status.run_status
-                       ? "DDR STATS IS BUSY"
-                       : "DDR STATS IS NOT RUNNING/FINISHED");
-
-    printf("Loop Count = %d\n", ddr_stats_status.loop_count);
-    if (ddr_stats_status.run_status) {
-      return -EBUSY;
-    }
+  /* the stats structures are packed, any offset in the chunk will do */
+  for (; n >= sizeof(ddr_stats_data_t); n -= sizeof(ddr_stats_data_t)) {
+    ddr_stats_emit(st, (const ddr_stats_data_t *)p);
+    p += sizeof(ddr_stats_data_t);
+  }
 
-    total_bytes = sizeof(ddr_stats_data_t) * ddr_stats_status.loop_count;
-    buf = (unsigned char *)malloc(total_bytes);
-    if (!buf) {
-      printf("Failed to allocate memory\r\n");
-      return -ENOMEM;
+  if (n) {
+    memcpy(&st->partial, p, n);
+    st->fill = n;
+  }
+}
+
+static int ddr_stats_fetch_fn(struct cxlmi_endpoint *ep, void *arg) {
+  struct ddr_stats_fetch *f = arg;
+  cxlmi_cmd_ddr_stats_get_rsp_t out = f->buf;
+
+  return cxlmi_cmd_ddr_stats_get(ep, NULL, &f->req, &out);
+}
+
+static void ddr_stats_fetch_done(int rc, void *out, size_t out_sz,
+                                 void *priv) {
+  struct ddr_stats_fetch *f = priv;
+
+  f->rc = rc;
+  f->done = true;
+}
+
+static int ddr_stats_fetch_submit(struct cxlmi_async_queue *q,
+                                  struct ddr_stats_fetch *f, uint32_t offset,
+                                  uint32_t len) {
+  f->req.offset = offset;
+  f->req.transfer_sz = len;
+  f->done = false;
+  return cxlmi_async_submit_fn(q, ddr_stats_fetch_fn, f, ddr_stats_fetch_done,
+                               f);
+}
+
+/*
+ * Read back total bytes of stats in payload_max chunks, printing each
+ * chunk while the async queue already fetches the next one.
+ */
+static int ddr_stats_read(struct cxlmi_endpoint *ep, uint32_t total,
+                          struct ddr_stats_stream *st) {
+  struct ddr_stats_fetch fetch[DDR_STATS_NR_BUFS] = {0};
+  struct cxlmi_async_queue *q;
+  uint32_t chunk, next = 0, done = 0, n;
+  struct ddr_stats_fetch *f;
+  int i, rc = 0;
+
+  chunk = get_cxl_maxpayload(ep);
+  if (!chunk)
+    chunk = DDR_STATS_CHUNK_DEF;
+  if (chunk > total)
+    chunk = total;
+
+  q = cxlmi_async_queue_new(ep);
+  if (!q)
+    return -ENOMEM;
+
+  for (i = 0; i < DDR_STATS_NR_BUFS; i++) {
+    fetch[i].buf = malloc(chunk);
+    if (!fetch[i].buf) {
+      rc = -ENOMEM;
+      goto out;
     }
+  }
+
+  for (i = 0; i < DDR_STATS_NR_BUFS && next < total; i++, next += n) {
+    n = total - next < chunk ? total - next : chunk;
+    rc = ddr_stats_fetch_submit(q, &fetch[i], next, n);
+    if (rc)
+      goto out;
+  }
 
-    ddr_stats_start = (ddr_stats_data_t *)buf;
-
-    while (bytes_copied < total_bytes) {
-      bytes_to_cpy = (total_bytes - bytes_copied) < MAX_CXL_TRANSFER_SZ
-                         ? (total_bytes - bytes_copied)
-                         : MAX_CXL_TRANSFER_SZ;
-      struct cxlmi_cmd_ddr_stats_get_req ddr_stats_get_in;
-      ddr_stats_get_in.offset = bytes_copied;
-      ddr_stats_get_in.transfer_sz = bytes_to_cpy;
-      cxlmi_cmd_ddr_stats_get_rsp_t ddr_stats_get_out = buf + bytes_copied;
-      rc = cxlmi_cmd_ddr_stats_get(ep, NULL, &ddr_stats_get_in,
-                                   &ddr_stats_get_out);
-      bytes_copied = bytes_copied + bytes_to_cpy;
+  /* completions come back in submission order, one buffer after the other */
+  for (i = 0; done < total; i = (i + 1) % DDR_STATS_NR_BUFS) {
+    f = &fetch[i];
+    while (!f->done) {
+      rc = cxlmi_async_poll(q, -1);
       if (rc < 0)
         goto out;
     }
+    rc = f->rc;
+    if (rc)
+      goto out;
+
+    ddr_stats_consume(st, f->buf, f->req.transfer_sz);
+    done += f->req.transfer_sz;
 
-    display_pmon_stats(ddr_stats_start, ddr_stats_status.loop_count);
-    display_cs_pm_stats(ddr_stats_start, ddr_stats_status.loop_count);
-    display_cs_bank_pm_stats(ddr_stats_start, ddr_stats_status.loop_count);
-    display_mc_pm_stats(ddr_stats_start, ddr_stats_status.loop_count);
+    if (next < total) {
+      n = total - next < chunk ? total - next : chunk;
+      rc = ddr_stats_fetch_submit(q, f, next, n);
+      if (rc)
+        goto out;
+      next += n;
+    }
   }
+
 out:
-  if (ddr_stats_start) {
-    free(ddr_stats_start);
-    ddr_stats_start = NULL;
+  /* waits for the fetch in flight before its buffer goes away */
+  cxlmi_async_queue_free(q);
+  for (i = 0; i < DDR_STATS_NR_BUFS; i++)
+    free(fetch[i].buf);
+  return rc;
+}
+
+/* A directory gets <dev>-ddr-stats.col in it */
+static void ddr_stats_export_path(struct cxlmi_endpoint *ep,
+                                  const char *output, char *path, size_t len) {
+  struct stat st;
+
+  if (!stat(output, &st) && S_ISDIR(st.st_mode))
+    snprintf(path, len, "%s/%s-ddr-stats.col", output, get_devname(ep));
+  else
+    snprintf(path, len, "%s", output);
+}
+
+int cxl_cmd_ddr_stats_get(struct cxlmi_endpoint *ep, const char *output) {
+  struct cxlmi_cmd_ddr_stats_status ddr_stats_status;
+  struct ddr_stats_export *exp = NULL;
+  struct ddr_stats_stream st;
+  char path[PATH_MAX];
+  int i, rc, close_rc;
+  uint64_t total;
+
+  rc = cxlmi_cmd_ddr_stats_status(ep, NULL, &ddr_stats_status);
+  if (rc)
+    return rc;
+
+  printf("DDR stats get : %s\n", get_devname(ep));
+  printf("%s\n", ddr_stats_status.run_status
+                     ? "DDR STATS IS BUSY"
+                     : "DDR STATS IS NOT RUNNING/FINISHED");
+
+  printf("Loop Count = %d\n", ddr_stats_status.loop_count);
+  if (ddr_stats_status.run_status) {
+    return -EBUSY;
   }
 
-  return rc;
+  /* Get offsets are 32 bits wide */
+  total = (uint64_t)sizeof(ddr_stats_data_t) * ddr_stats_status.loop_count;
+  if (total > UINT32_MAX)
+    return -EOVERFLOW;
+
+  if (output) {
+    ddr_stats_export_path(ep, output, path, sizeof(path));
+    rc = ddr_stats_export_open(&exp, path, get_devname(ep),
+                               ddr_stats_status.loop_count);
+    if (rc) {
+      printf("Cannot create %s: %s\n", path, strerror(-rc));
+      return rc;
+    }
+  }
+
+  if (exp) {
+    ddr_stats_stream_init(&st, exp, 0);
+    if (total)
+      rc = ddr_stats_read(ep, total, &st);
+    close_rc = ddr_stats_export_close(exp, !rc);
+    if (!rc)
+      rc = close_rc;
+    if (!rc)
+      printf("%s: %u iteration(s) written to %s\n", get_devname(ep),
+             ddr_stats_status.loop_count, path);
+    return rc;
+  }
+
+  for (i = 0; i < (int)DDR_STATS_NR_SECTIONS; i++) {
+    ddr_stats_stream_init(&st, NULL, i);
+    ddr_stats_sections[i].hdr(stdout);
+    if (total)
+      rc = ddr_stats_read(ep, total, &st);
+    if (rc) {
+      /* the rows so far are out already, say where the section stops */
+      printf("\n%s: DDR stats truncated after %u of %u iteration(s): %d\n",
+             get_devname(ep), st.loop, ddr_stats_status.loop_count, rc);
+      return rc;
+    }
+    printf("\n");
+  }
+
+  return 0;
 }
 
 int cxl_cmd_ddr_param_set(struct cxlmi_endpoint *ep, uint32_t ddr_interleave_sz,
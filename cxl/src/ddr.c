@@ -176,6 +176,146 @@ void display_ddr_init_status(
   return;
 }
 
+/*
+ * DDR stats sections, one header and one row printer each, so that a
+ * stats run can be printed an iteration at a time as it is read back.
+ */
+void print_pmon_stats_hdr(FILE *f) {
+  fprintf(f, "PMON STATS:\n");
+  fprintf(
+      f,
+      "iteration, fr_cnt, idle_cnt, rd_ot_cnt, wr_ot_cnt, wrd_ot_cnt, "
+      "rd_cmd_cnt, rd_cmd_busy_cnt, wr_cmd_cnt, wr_cmd_busy_cnt, rd_data_cnt, "
+      "rd_data_busy_cnt, wr_data_cnt, wr_data_busy_cnt, "
+      "rd_avg_lat, wr_avg_lat, rd_trans_smpl_cnt, wr_trans_smpl_cnt\n");
+}
+
+void print_pmon_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                          uint32_t loop) {
+  fprintf(f,
+          "[%d], %lu, %u, %u, %u, %u, "
+          "%u, %u, %u, %u, %u, "
+          "%u, %u, %u, "
+          "%lu, %lu, %u, %u\n",
+          loop, disp_stats->stats.pmon.fr_cnt, disp_stats->stats.pmon.idle_cnt,
+          disp_stats->stats.pmon.rd_ot_cnt, disp_stats->stats.pmon.wr_ot_cnt,
+          disp_stats->stats.pmon.wrd_ot_cnt, disp_stats->stats.pmon.rd_cmd_cnt,
+          disp_stats->stats.pmon.rd_cmd_busy_cnt,
+          disp_stats->stats.pmon.wr_cmd_cnt,
+          disp_stats->stats.pmon.wr_cmd_busy_cnt,
+          disp_stats->stats.pmon.rd_data_cnt,
+          disp_stats->stats.pmon.rd_data_busy_cnt,
+          disp_stats->stats.pmon.wr_data_cnt,
+          disp_stats->stats.pmon.wr_data_busy_cnt,
+          disp_stats->stats.pmon.rd_avg_lat, disp_stats->stats.pmon.wr_avg_lat,
+          disp_stats->stats.pmon.rd_trans_smpl_cnt,
+          disp_stats->stats.pmon.wr_trans_smpl_cnt);
+}
+
+void print_cs_pm_stats_hdr(FILE *f) {
+  fprintf(f, "CS PM STATS:\n");
+  fprintf(f, "iteration, rank, mrw_cnt, refresh_cnt, act_cnt, write_cnt, "
+             "read_cnt, pre_cnt, rr_cnt, ww_cnt, rw_cnt\n ");
+}
+
+void print_cs_pm_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                           uint32_t loop) {
+  uint32_t rank;
+
+  for (rank = 0; rank < NUM_CS; rank++) {
+    fprintf(f,
+            "[%d], %d, %u, %u, %u, %u, "
+            "%u, %u, %u, %u, %u\n",
+            loop, rank, disp_stats->stats.cs_pm[rank].mrw_cnt,
+            disp_stats->stats.cs_pm[rank].refresh_cnt,
+            disp_stats->stats.cs_pm[rank].act_cnt,
+            disp_stats->stats.cs_pm[rank].write_cnt,
+            disp_stats->stats.cs_pm[rank].read_cnt,
+            disp_stats->stats.cs_pm[rank].pre_cnt,
+            disp_stats->stats.cs_pm[rank].rr_cnt,
+            disp_stats->stats.cs_pm[rank].ww_cnt,
+            disp_stats->stats.cs_pm[rank].rw_cnt);
+  }
+}
+
+void print_cs_bank_pm_stats_hdr(FILE *f) {
+  fprintf(f, "CS BANK STATS:\n");
+  fprintf(f, "iteration, rank, bank, bank_act_cnt, bank_wr_cnt, bank_rd_cnt, "
+             "bank_pre_cnt\n");
+}
+
+void print_cs_bank_pm_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                                uint32_t loop) {
+  uint32_t rank, bank;
+
+  for (rank = 0; rank < NUM_CS; rank++) {
+    for (bank = 0; bank < NUM_BANK; bank++) {
+      fprintf(f, "[%d], %d, %d, %u, %u, %u, %u\n", loop, rank, bank,
+              disp_stats->stats.cs_bank_pm[rank][bank].bank_act_cnt,
+              disp_stats->stats.cs_bank_pm[rank][bank].bank_wr_cnt,
+              disp_stats->stats.cs_bank_pm[rank][bank].bank_rd_cnt,
+              disp_stats->stats.cs_bank_pm[rank][bank].bank_pre_cnt);
+    }
+  }
+}
+
+void print_mc_pm_stats_hdr(FILE *f) {
+  fprintf(f, "PM STATS:\n");
+  fprintf(f, "iteration, cmd_queue_full_events, info_fifo_full_events, "
+             "wrdata_hold_fifo_full_events, port_cmd_fifo0_full_events, "
+             "port_wrresp_fifo0_full_events, port_wr_fifo0_full_events, "
+             "port_rd_fifo0_full_events, port_cmd_fifo1_full_events, "
+             "port_wrresp_fifo1_full_events, port_wr_fifo1_full_events, "
+             "port_rd_fifo1_full_events, ecc_dataout_corrected, "
+             "ecc_dataout_uncorrected, pd_ex, pd_en, srex, sren, "
+             "write, read, rmw, bank_act, precharge, precharge_all, "
+             "mrw, auto_ref, rw_auto_pre, zq_cal_short, zq_cal_long, "
+             "same_addr_ww_collision, same_addr_wr_collision, "
+             "same_addr_rw_collision, same_addr_rr_collision\n");
+}
+
+void print_mc_pm_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                           uint32_t loop) {
+  fprintf(f,
+          "[%d], %u, %u, "
+          "%u, %u, "
+          "%u, %u, "
+          "%u, %u, "
+          "%u, %u, "
+          "%u, %u, "
+          "%u, %u, %u, %u, %u,"
+          "%u, %u, %u, %u, %u, %u,"
+          "%u, %u, %u, %u, %u,"
+          "%u, %u, "
+          "%u, %u\n",
+          loop, disp_stats->stats.mc_pm.cmd_queue_full_events,
+          disp_stats->stats.mc_pm.info_fifo_full_events,
+          disp_stats->stats.mc_pm.wrdata_hold_fifo_full_events,
+          disp_stats->stats.mc_pm.port_cmd_fifo0_full_events,
+          disp_stats->stats.mc_pm.port_wrresp_fifo0_full_events,
+          disp_stats->stats.mc_pm.port_wr_fifo0_full_events,
+          disp_stats->stats.mc_pm.port_rd_fifo0_full_events,
+          disp_stats->stats.mc_pm.port_cmd_fifo1_full_events,
+          disp_stats->stats.mc_pm.port_wrresp_fifo1_full_events,
+          disp_stats->stats.mc_pm.port_wr_fifo1_full_events,
+          disp_stats->stats.mc_pm.port_rd_fifo1_full_events,
+          disp_stats->stats.mc_pm.ecc_dataout_corrected,
+          disp_stats->stats.mc_pm.ecc_dataout_uncorrected,
+          disp_stats->stats.mc_pm.pd_ex, disp_stats->stats.mc_pm.pd_en,
+          disp_stats->stats.mc_pm.srex, disp_stats->stats.mc_pm.sren,
+          disp_stats->stats.mc_pm.write, disp_stats->stats.mc_pm.read,
+          disp_stats->stats.mc_pm.rmw, disp_stats->stats.mc_pm.bank_act,
+          disp_stats->stats.mc_pm.precharge,
+          disp_stats->stats.mc_pm.precharge_all, disp_stats->stats.mc_pm.mrw,
+          disp_stats->stats.mc_pm.auto_ref, disp_stats->stats.mc_pm.rw_auto_pre,
+          disp_stats->stats.mc_pm.zq_cal_short,
+          disp_stats->stats.mc_pm.zq_cal_long,
+          disp_stats->stats.mc_pm.same_addr_ww_collision,
+          disp_stats->stats.mc_pm.same_addr_wr_collision,
+          disp_stats->stats.mc_pm.same_addr_rw_collision,
+          disp_stats->stats.mc_pm.same_addr_rr_collision);
+}
+
 void display_pmon_stats(ddr_stats_data_t *disp_stats, uint32_t loop_count) {
   uint32_t loop;
 
@@ -184,85 +324,33 @@ void display_pmon_stats(ddr_stats_data_t *disp_stats, uint32_t loop_count) {
     return;
   }
 
-  printf("PMON STATS:\n");
-  printf(
-      "iteration, fr_cnt, idle_cnt, rd_ot_cnt, wr_ot_cnt, wrd_ot_cnt, "
-      "rd_cmd_cnt, rd_cmd_busy_cnt, wr_cmd_cnt, wr_cmd_busy_cnt, rd_data_cnt, "
-      "rd_data_busy_cnt, wr_data_cnt, wr_data_busy_cnt, "
-      "rd_avg_lat, wr_avg_lat, rd_trans_smpl_cnt, wr_trans_smpl_cnt\n");
-  for (loop = 0; loop < loop_count; loop++) {
-    printf("[%d], %lu, %u, %u, %u, %u, "
-           "%u, %u, %u, %u, %u, "
-           "%u, %u, %u, "
-           "%lu, %lu, %u, %u\n",
-           loop, disp_stats->stats.pmon.fr_cnt, disp_stats->stats.pmon.idle_cnt,
-           disp_stats->stats.pmon.rd_ot_cnt, disp_stats->stats.pmon.wr_ot_cnt,
-           disp_stats->stats.pmon.wrd_ot_cnt, disp_stats->stats.pmon.rd_cmd_cnt,
-           disp_stats->stats.pmon.rd_cmd_busy_cnt,
-           disp_stats->stats.pmon.wr_cmd_cnt,
-           disp_stats->stats.pmon.wr_cmd_busy_cnt,
-           disp_stats->stats.pmon.rd_data_cnt,
-           disp_stats->stats.pmon.rd_data_busy_cnt,
-           disp_stats->stats.pmon.wr_data_cnt,
-           disp_stats->stats.pmon.wr_data_busy_cnt,
-           disp_stats->stats.pmon.rd_avg_lat, disp_stats->stats.pmon.wr_avg_lat,
-           disp_stats->stats.pmon.rd_trans_smpl_cnt,
-           disp_stats->stats.pmon.wr_trans_smpl_cnt);
-    disp_stats++;
-  }
+  print_pmon_stats_hdr(stdout);
+  for (loop = 0; loop < loop_count; loop++)
+    print_pmon_stats_row(stdout, disp_stats++, loop);
   printf("\n");
 }
 
 void display_cs_pm_stats(ddr_stats_data_t *disp_stats, uint32_t loop_count) {
-  uint32_t rank, loop;
+  uint32_t loop;
 
   if (!disp_stats) {
     printf("Null pointer, cannot display structure\r\n");
     return;
   }
 
-  printf("CS PM STATS:\n");
-  printf("iteration, rank, mrw_cnt, refresh_cnt, act_cnt, write_cnt, "
-         "read_cnt, pre_cnt, rr_cnt, ww_cnt, rw_cnt\n ");
-
-  for (loop = 0; loop < loop_count; loop++) {
-    for (rank = 0; rank < NUM_CS; rank++) {
-      printf("[%d], %d, %u, %u, %u, %u, "
-             "%u, %u, %u, %u, %u\n",
-             loop, rank, disp_stats->stats.cs_pm[rank].mrw_cnt,
-             disp_stats->stats.cs_pm[rank].refresh_cnt,
-             disp_stats->stats.cs_pm[rank].act_cnt,
-             disp_stats->stats.cs_pm[rank].write_cnt,
-             disp_stats->stats.cs_pm[rank].read_cnt,
-             disp_stats->stats.cs_pm[rank].pre_cnt,
-             disp_stats->stats.cs_pm[rank].rr_cnt,
-             disp_stats->stats.cs_pm[rank].ww_cnt,
-             disp_stats->stats.cs_pm[rank].rw_cnt);
-    }
-    disp_stats++;
-  }
+  print_cs_pm_stats_hdr(stdout);
+  for (loop = 0; loop < loop_count; loop++)
+    print_cs_pm_stats_row(stdout, disp_stats++, loop);
   printf("\n");
 }
 
 void display_cs_bank_pm_stats(ddr_stats_data_t *disp_stats,
                               uint32_t loop_count) {
-  uint32_t rank, bank, loop;
-
-  printf("CS BANK STATS:\n");
-  printf("iteration, rank, bank, bank_act_cnt, bank_wr_cnt, bank_rd_cnt, "
-         "bank_pre_cnt\n");
-  for (loop = 0; loop < loop_count; loop++) {
-    for (rank = 0; rank < NUM_CS; rank++) {
-      for (bank = 0; bank < NUM_BANK; bank++) {
-        printf("[%d], %d, %d, %u, %u, %u, %u\n", loop, rank, bank,
-               disp_stats->stats.cs_bank_pm[rank][bank].bank_act_cnt,
-               disp_stats->stats.cs_bank_pm[rank][bank].bank_wr_cnt,
-               disp_stats->stats.cs_bank_pm[rank][bank].bank_rd_cnt,
-               disp_stats->stats.cs_bank_pm[rank][bank].bank_pre_cnt);
-      }
-    }
-    disp_stats++;
-  }
+  uint32_t loop;
+
+  print_cs_bank_pm_stats_hdr(stdout);
+  for (loop = 0; loop < loop_count; loop++)
+    print_cs_bank_pm_stats_row(stdout, disp_stats++, loop);
   printf("\n");
 }
 
@@ -274,60 +362,9 @@ void display_mc_pm_stats(ddr_stats_data_t *disp_stats, uint32_t loop_count) {
     return;
   }
 
-  printf("PM STATS:\n");
-  printf("iteration, cmd_queue_full_events, info_fifo_full_events, "
-         "wrdata_hold_fifo_full_events, port_cmd_fifo0_full_events, "
-         "port_wrresp_fifo0_full_events, port_wr_fifo0_full_events, "
-         "port_rd_fifo0_full_events, port_cmd_fifo1_full_events, "
-         "port_wrresp_fifo1_full_events, port_wr_fifo1_full_events, "
-         "port_rd_fifo1_full_events, ecc_dataout_corrected, "
-         "ecc_dataout_uncorrected, pd_ex, pd_en, srex, sren, "
-         "write, read, rmw, bank_act, precharge, precharge_all, "
-         "mrw, auto_ref, rw_auto_pre, zq_cal_short, zq_cal_long, "
-         "same_addr_ww_collision, same_addr_wr_collision, "
-         "same_addr_rw_collision, same_addr_rr_collision\n");
-
-  for (loop = 0; loop < loop_count; loop++) {
-    printf("[%d], %u, %u, "
-           "%u, %u, "
-           "%u, %u, "
-           "%u, %u, "
-           "%u, %u, "
-           "%u, %u, "
-           "%u, %u, %u, %u, %u,"
-           "%u, %u, %u, %u, %u, %u,"
-           "%u, %u, %u, %u, %u,"
-           "%u, %u, "
-           "%u, %u\n",
-           loop, disp_stats->stats.mc_pm.cmd_queue_full_events,
-           disp_stats->stats.mc_pm.info_fifo_full_events,
-           disp_stats->stats.mc_pm.wrdata_hold_fifo_full_events,
-           disp_stats->stats.mc_pm.port_cmd_fifo0_full_events,
-           disp_stats->stats.mc_pm.port_wrresp_fifo0_full_events,
-           disp_stats->stats.mc_pm.port_wr_fifo0_full_events,
-           disp_stats->stats.mc_pm.port_rd_fifo0_full_events,
-           disp_stats->stats.mc_pm.port_cmd_fifo1_full_events,
-           disp_stats->stats.mc_pm.port_wrresp_fifo1_full_events,
-           disp_stats->stats.mc_pm.port_wr_fifo1_full_events,
-           disp_stats->stats.mc_pm.port_rd_fifo1_full_events,
-           disp_stats->stats.mc_pm.ecc_dataout_corrected,
-           disp_stats->stats.mc_pm.ecc_dataout_uncorrected,
-           disp_stats->stats.mc_pm.pd_ex, disp_stats->stats.mc_pm.pd_en,
-           disp_stats->stats.mc_pm.srex, disp_stats->stats.mc_pm.sren,
-           disp_stats->stats.mc_pm.write, disp_stats->stats.mc_pm.read,
-           disp_stats->stats.mc_pm.rmw, disp_stats->stats.mc_pm.bank_act,
-           disp_stats->stats.mc_pm.precharge,
-           disp_stats->stats.mc_pm.precharge_all, disp_stats->stats.mc_pm.mrw,
-           disp_stats->stats.mc_pm.auto_ref,
-           disp_stats->stats.mc_pm.rw_auto_pre,
-           disp_stats->stats.mc_pm.zq_cal_short,
-           disp_stats->stats.mc_pm.zq_cal_long,
-           disp_stats->stats.mc_pm.same_addr_ww_collision,
-           disp_stats->stats.mc_pm.same_addr_wr_collision,
-           disp_stats->stats.mc_pm.same_addr_rw_collision,
-           disp_stats->stats.mc_pm.same_addr_rr_collision);
-    disp_stats++;
-  }
+  print_mc_pm_stats_hdr(stdout);
+  for (loop = 0; loop < loop_count; loop++)
+    print_mc_pm_stats_row(stdout, disp_stats++, loop);
   printf("\n");
 }
 
@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/*
+ * Columnar DDR stats files, see ddr_stats_export.h. The file is sized up
+ * front from the loop count and mapped, so each iteration is scattered
+ * straight into its row of every column as it is read back from the
+ * device; nothing but the mapping grows with the loop count.
+ */
+
+/* std includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <ccan/endian/endian.h>
+
+/* vendor includes */
+#include "ddr_stats_export.h"
+
+#define member_size(type, member) (sizeof(((type *)0)->member))
+
+struct ddr_stats_field {
+  const char *name;
+  uint16_t off;
+  uint8_t width;
+};
+
+#define FIELD(type, m)                                                         \
+  { #m, offsetof(struct type, m), member_size(struct type, m) }
+
+static const struct ddr_stats_field pmon_fields[] = {
+    FIELD(ddr_pmon_data, fr_cnt),
+    FIELD(ddr_pmon_data, idle_cnt),
+    FIELD(ddr_pmon_data, rd_ot_cnt),
+    FIELD(ddr_pmon_data, wr_ot_cnt),
+    FIELD(ddr_pmon_data, wrd_ot_cnt),
+    FIELD(ddr_pmon_data, rd_cmd_cnt),
+    FIELD(ddr_pmon_data, rd_cmd_busy_cnt),
+    FIELD(ddr_pmon_data, wr_cmd_cnt),
+    FIELD(ddr_pmon_data, wr_cmd_busy_cnt),
+    FIELD(ddr_pmon_data, rd_data_cnt),
+    FIELD(ddr_pmon_data, rd_data_busy_cnt),
+    FIELD(ddr_pmon_data, wr_data_cnt),
+    FIELD(ddr_pmon_data, wr_data_busy_cnt),
+    FIELD(ddr_pmon_data, rd_avg_lat),
+    FIELD(ddr_pmon_data, wr_avg_lat),
+    FIELD(ddr_pmon_data, rd_trans_smpl_cnt),
+    FIELD(ddr_pmon_data, wr_trans_smpl_cnt),
+};
+
+static const struct ddr_stats_field cs_pm_fields[] = {
+    FIELD(dfi_cs_pm, mrw_cnt),   FIELD(dfi_cs_pm, refresh_cnt),
+    FIELD(dfi_cs_pm, act_cnt),   FIELD(dfi_cs_pm, write_cnt),
+    FIELD(dfi_cs_pm, read_cnt),  FIELD(dfi_cs_pm, pre_cnt),
+    FIELD(dfi_cs_pm, rr_cnt),    FIELD(dfi_cs_pm, ww_cnt),
+    FIELD(dfi_cs_pm, rw_cnt),
+};
+
+static const struct ddr_stats_field cs_bank_pm_fields[] = {
+    FIELD(dfi_cs_bank_pm, bank_act_cnt),
+    FIELD(dfi_cs_bank_pm, bank_wr_cnt),
+    FIELD(dfi_cs_bank_pm, bank_rd_cnt),
+    FIELD(dfi_cs_bank_pm, bank_pre_cnt),
+};
+
+static const struct ddr_stats_field mc_pm_fields[] = {
+    FIELD(dfi_mc_pm, cmd_queue_full_events),
+    FIELD(dfi_mc_pm, info_fifo_full_events),
+    FIELD(dfi_mc_pm, wrdata_hold_fifo_full_events),
+    FIELD(dfi_mc_pm, port_cmd_fifo0_full_events),
+    FIELD(dfi_mc_pm, port_wrresp_fifo0_full_events),
+    FIELD(dfi_mc_pm, port_wr_fifo0_full_events),
+    FIELD(dfi_mc_pm, port_rd_fifo0_full_events),
+    FIELD(dfi_mc_pm, port_cmd_fifo1_full_events),
+    FIELD(dfi_mc_pm, port_wrresp_fifo1_full_events),
+    FIELD(dfi_mc_pm, port_wr_fifo1_full_events),
+    FIELD(dfi_mc_pm, port_rd_fifo1_full_events),
+    FIELD(dfi_mc_pm, ecc_dataout_corrected),
+    FIELD(dfi_mc_pm, ecc_dataout_uncorrected),
+    FIELD(dfi_mc_pm, pd_ex),
+    FIELD(dfi_mc_pm, pd_en),
+    FIELD(dfi_mc_pm, srex),
+    FIELD(dfi_mc_pm, sren),
+    FIELD(dfi_mc_pm, write),
+    FIELD(dfi_mc_pm, read),
+    FIELD(dfi_mc_pm, rmw),
+    FIELD(dfi_mc_pm, bank_act),
+    FIELD(dfi_mc_pm, precharge),
+    FIELD(dfi_mc_pm, precharge_all),
+    FIELD(dfi_mc_pm, mrw),
+    FIELD(dfi_mc_pm, auto_ref),
+    FIELD(dfi_mc_pm, rw_auto_pre),
+    FIELD(dfi_mc_pm, zq_cal_short),
+    FIELD(dfi_mc_pm, zq_cal_long),
+    FIELD(dfi_mc_pm, same_addr_ww_collision),
+    FIELD(dfi_mc_pm, same_addr_wr_collision),
+    FIELD(dfi_mc_pm, same_addr_rw_collision),
+    FIELD(dfi_mc_pm, same_addr_rr_collision),
+};
+
+#define NR_FIELDS(f) (sizeof(f) / sizeof((f)[0]))
+
+/* the schema offsets are into struct ddr_data, rows are ddr_stats_data_t */
+_Static_assert(offsetof(ddr_stats_data_t, stats) == 0,
+               "ddr_stats_data_t must start with its struct ddr_data");
+
+#define DDR_STATS_NR_COLS                                                      \
+  (NR_FIELDS(pmon_fields) + NUM_CS * NR_FIELDS(cs_pm_fields) +                 \
+   NUM_CS * NUM_BANK * NR_FIELDS(cs_bank_pm_fields) + NR_FIELDS(mc_pm_fields))
+
+/* Where a column comes from in ddr_stats_data_t and goes to in the file */
+struct ddr_stats_col {
+  uint32_t src;
+  uint32_t width;
+  uint8_t *dst;
+};
+
+struct ddr_stats_export {
+  char path[PATH_MAX];
+  char part[PATH_MAX];
+  int fd;
+  uint8_t *map;
+  size_t size;
+  struct ddr_stats_col cols[DDR_STATS_NR_COLS];
+};
+
+#define COL_ALIGN_UP(n)                                                        \
+  (((n) + DDR_STATS_COL_ALIGN - 1) / DDR_STATS_COL_ALIGN * DDR_STATS_COL_ALIGN)
+
+static void add_cols(struct ddr_stats_col_desc *desc, int *nr,
+                     const struct ddr_stats_field *f, size_t nr_fields,
+                     size_t base, const char *prefix, const char *suffix) {
+  size_t i;
+
+  for (i = 0; i < nr_fields; i++, (*nr)++) {
+    snprintf(desc[*nr].name, sizeof(desc[*nr].name), "%s.%s%s", prefix,
+             f[i].name, suffix);
+    desc[*nr].type = f[i].width == 8 ? DDR_STATS_COL_U64 : DDR_STATS_COL_U32;
+    desc[*nr].width = f[i].width;
+    /* source offset for now, the file offset is filled in later */
+    desc[*nr].offset = base + f[i].off;
+  }
+}
+
+/* Column descriptors in ddr_stats_data_t order */
+static int ddr_stats_schema(struct ddr_stats_col_desc *desc) {
+  char suffix[32];
+  int nr = 0, cs, bank;
+
+  add_cols(desc, &nr, pmon_fields, NR_FIELDS(pmon_fields),
+           offsetof(struct ddr_data, pmon), "pmon", "");
+  for (cs = 0; cs < NUM_CS; cs++) {
+    snprintf(suffix, sizeof(suffix), ".cs%d", cs);
+    add_cols(desc, &nr, cs_pm_fields, NR_FIELDS(cs_pm_fields),
+             offsetof(struct ddr_data, cs_pm[cs]), "cs_pm", suffix);
+  }
+  for (cs = 0; cs < NUM_CS; cs++) {
+    for (bank = 0; bank < NUM_BANK; bank++) {
+      snprintf(suffix, sizeof(suffix), ".cs%d.bank%d", cs, bank);
+      add_cols(desc, &nr, cs_bank_pm_fields, NR_FIELDS(cs_bank_pm_fields),
+               offsetof(struct ddr_data, cs_bank_pm[cs][bank]), "cs_bank_pm",
+               suffix);
+    }
+  }
+  add_cols(desc, &nr, mc_pm_fields, NR_FIELDS(mc_pm_fields),
+           offsetof(struct ddr_data, mc_pm), "mc_pm", "");
+
+  return nr;
+}
+
+int ddr_stats_export_open(struct ddr_stats_export **pexp, const char *path,
+                          const char *devname, uint32_t nr_rows) {
+  struct ddr_stats_col_desc desc[DDR_STATS_NR_COLS];
+  struct ddr_stats_col_hdr hdr = {0};
+  struct ddr_stats_export *exp;
+  size_t off;
+  int i, nr, rc;
+
+  memset(desc, 0, sizeof(desc));
+  nr = ddr_stats_schema(desc);
+
+  exp = calloc(1, sizeof(*exp));
+  if (!exp)
+    return -ENOMEM;
+
+  /* lay the columns out, remembering where each one comes from */
+  off = COL_ALIGN_UP(sizeof(hdr) + nr * sizeof(desc[0]));
+  for (i = 0; i < nr; i++) {
+    exp->cols[i].src = desc[i].offset;
+    exp->cols[i].width = desc[i].width;
+    desc[i].offset = cpu_to_le64(off);
+    off += COL_ALIGN_UP((size_t)nr_rows * desc[i].width);
+  }
+  exp->size = off;
+
+  memcpy(hdr.magic, DDR_STATS_COL_MAGIC, sizeof(hdr.magic));
+  hdr.version = cpu_to_le32(DDR_STATS_COL_VERSION);
+  hdr.hdr_size = cpu_to_le32(sizeof(hdr));
+  hdr.nr_rows = cpu_to_le64(nr_rows);
+  hdr.nr_cols = cpu_to_le32(nr);
+  hdr.desc_size = cpu_to_le32(sizeof(desc[0]));
+  hdr.file_size = cpu_to_le64(exp->size);
+  snprintf(hdr.devname, sizeof(hdr.devname), "%s", devname);
+
+  snprintf(exp->path, sizeof(exp->path), "%s", path);
+  snprintf(exp->part, sizeof(exp->part), "%s.part", path);
+  exp->fd = open(exp->part, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (exp->fd < 0) {
+    rc = -errno;
+    free(exp);
+    return rc;
+  }
+  if (ftruncate(exp->fd, exp->size)) {
+    rc = -errno;
+    goto err;
+  }
+  exp->map =
+      mmap(NULL, exp->size, PROT_READ | PROT_WRITE, MAP_SHARED, exp->fd, 0);
+  if (exp->map == MAP_FAILED) {
+    rc = -errno;
+    goto err;
+  }
+
+  memcpy(exp->map, &hdr, sizeof(hdr));
+  memcpy(exp->map + sizeof(hdr), desc, nr * sizeof(desc[0]));
+  for (i = 0; i < nr; i++)
+    exp->cols[i].dst = exp->map + le64_to_cpu(desc[i].offset);
+
+  *pexp = exp;
+  return 0;
+
+err:
+  close(exp->fd);
+  unlink(exp->part);
+  free(exp);
+  return rc;
+}
+
+void ddr_stats_export_row(struct ddr_stats_export *exp,
+                          const ddr_stats_data_t *s, uint32_t row) {
+  const uint8_t *src = (const uint8_t *)s;
+  const struct ddr_stats_col *c;
+  int i;
+
+  /* counters are little endian on the wire already, copied as they are */
+  for (i = 0; i < DDR_STATS_NR_COLS; i++) {
+    c = &exp->cols[i];
+    memcpy(c->dst + (size_t)row * c->width, src + c->src, c->width);
+  }
+}
+
+int ddr_stats_export_close(struct ddr_stats_export *exp, bool commit) {
+  int rc = 0;
+
+  munmap(exp->map, exp->size);
+  if (commit && fdatasync(exp->fd))
+    rc = -errno;
+  if (close(exp->fd) && !rc)
+    rc = -errno;
+  if (commit && !rc && rename(exp->part, exp->path))
+    rc = -errno;
+  if (!commit || rc)
+    unlink(exp->part);
+
+  free(exp);
+  return rc;
+}
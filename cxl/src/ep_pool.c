@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/* std includes */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "ep_pool.h"
+
+/* What a worker leaves behind in the mapping shared with the parent */
+struct ep_result {
+  int rc;
+  bool stored; /* false: the worker died before action() returned */
+};
+
+struct ep_worker {
+  pid_t pid;
+  FILE *out;
+  bool done;
+  bool lost;
+};
+
+static void ep_pool_flush(FILE *out) {
+  char buf[4096];
+  size_t n;
+
+  fflush(out);
+  rewind(out);
+  while ((n = fread(buf, 1, sizeof(buf), out)) > 0)
+    fwrite(buf, 1, n, stdout);
+  fflush(stdout);
+}
+
+static void ep_pool_spawn(struct ep_worker *w, struct cxlmi_endpoint *ep,
+                          int (*action)(struct cxlmi_endpoint *ep),
+                          struct ep_result *result) {
+  result->stored = false;
+
+  w->out = tmpfile();
+  if (!w->out) {
+    /* no buffer, leave it to the parent once its turn comes */
+    w->pid = -1;
+    w->done = true;
+    return;
+  }
+
+  w->pid = fork();
+  if (w->pid == 0) {
+    /* worker: everything printed for this endpoint lands in w->out */
+    if (dup2(fileno(w->out), STDOUT_FILENO) < 0)
+      _exit(1);
+    result->rc = action(ep);
+    result->stored = true;
+    fflush(stdout);
+    _exit(0);
+  }
+
+  if (w->pid < 0) {
+    fclose(w->out);
+    w->out = NULL;
+    w->done = true;
+  }
+}
+
+/* Mark the worker behind pid, if it is one of ours, as finished */
+static void ep_pool_reaped(struct ep_worker *workers, int from, int to,
+                           pid_t pid, int status) {
+  int i;
+
+  for (i = from; i < to; i++) {
+    if (workers[i].pid != pid || workers[i].done)
+      continue;
+    workers[i].done = true;
+    workers[i].lost = !WIFEXITED(status) || WEXITSTATUS(status);
+    return;
+  }
+}
+
+/*
+ * Reap a finished worker: any that is done already, else block on the
+ * oldest one still running. Only the pool's own pids are waited for, other
+ * children of the process (serve connections, popen) are left alone.
+ * Returns false once no worker can be waited for.
+ */
+static bool ep_pool_wait(struct ep_worker *workers, int from, int to) {
+  int i, status, oldest = -1;
+  pid_t pid;
+
+  for (i = from; i < to; i++) {
+    if (workers[i].done || workers[i].pid <= 0)
+      continue;
+    if (oldest < 0)
+      oldest = i;
+    pid = waitpid(workers[i].pid, &status, WNOHANG);
+    if (pid > 0) {
+      ep_pool_reaped(workers, from, to, pid, status);
+      return true;
+    }
+  }
+  if (oldest < 0)
+    return false;
+
+  do {
+    pid = waitpid(workers[oldest].pid, &status, 0);
+  } while (pid < 0 && errno == EINTR);
+
+  if (pid < 0) {
+    /* reaped behind our back, whatever was captured is final */
+    workers[oldest].done = true;
+    workers[oldest].lost = true;
+    return true;
+  }
+  ep_pool_reaped(workers, from, to, pid, status);
+  return true;
+}
+
+int ep_pool_run(struct cxlmi_endpoint **eps, int nr_eps, int jobs,
+                int (*action)(struct cxlmi_endpoint *ep), int *results) {
+  struct ep_worker *workers;
+  struct ep_result *shared;
+  int i, next = 0, flushed = 0, running = 0, lost = 0;
+
+  if (jobs > EP_POOL_MAX_JOBS)
+    jobs = EP_POOL_MAX_JOBS;
+
+  if (jobs <= 1 || nr_eps <= 1)
+    goto serial;
+
+  /* workers report their return code through a shared mapping */
+  shared = mmap(NULL, nr_eps * sizeof(*shared), PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED)
+    goto serial;
+
+  workers = calloc(nr_eps, sizeof(*workers));
+  if (!workers) {
+    munmap(shared, nr_eps * sizeof(*shared));
+    goto serial;
+  }
+
+  /* don't let the workers inherit (and re-emit) pending output */
+  fflush(stdout);
+  fflush(stderr);
+
+  while (flushed < nr_eps) {
+    while (running < jobs && next < nr_eps) {
+      ep_pool_spawn(&workers[next], eps[next], action, &shared[next]);
+      if (workers[next].pid > 0)
+        running++;
+      next++;
+    }
+
+    /* emit finished endpoints, strictly in order */
+    while (flushed < next && workers[flushed].done) {
+      struct ep_worker *w = &workers[flushed];
+
+      if (!w->out) {
+        /* could not fork/buffer this one, run it inline */
+        results[flushed] = action(eps[flushed]);
+      } else {
+        ep_pool_flush(w->out);
+        fclose(w->out);
+        if (!shared[flushed].stored)
+          w->lost = true;
+        if (w->lost) {
+          fprintf(stderr, "worker for '%s' exited abnormally\n",
+                  get_devname(eps[flushed]));
+          results[flushed] = -ECHILD;
+          lost++;
+        } else {
+          results[flushed] = shared[flushed].rc;
+        }
+      }
+      flushed++;
+    }
+
+    if (running && ep_pool_wait(workers, flushed, next))
+      running--;
+    else
+      running = 0;
+  }
+
+  free(workers);
+  munmap(shared, nr_eps * sizeof(*shared));
+
+  return lost ? -ECHILD : 0;
+
+serial:
+  for (i = 0; i < nr_eps; i++)
+    results[i] = action(eps[i]);
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/* std includes */
+#include <dirent.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* vendor includes */
+#include "ep_select.h"
+#include <vendor_emu.h>
+
+/* "memN" with nothing trailing */
+static bool ep_parse_id(const char *name, unsigned int *id) {
+  int n = 0;
+
+  if (sscanf(name, "mem%u%n", id, &n) != 1)
+    return false;
+  return name[n] == '\0';
+}
+
+static int ep_entry_cmp(const void *a, const void *b) {
+  const struct ep_entry *x = a, *y = b;
+
+  return (x->id > y->id) - (x->id < y->id);
+}
+
+static int ep_table_add(struct ep_table *tbl, int *cap, unsigned int id,
+                        const char *name) {
+  struct ep_entry *ents;
+
+  if (tbl->nr == *cap) {
+    *cap = *cap ? *cap * 2 : 16;
+    ents = realloc(tbl->ents, *cap * sizeof(*ents));
+    if (!ents)
+      return -ENOMEM;
+    tbl->ents = ents;
+  }
+
+  tbl->ents[tbl->nr].id = id;
+  snprintf(tbl->ents[tbl->nr].name, EP_NAME_MAX, "%s", name);
+  tbl->nr++;
+
+  return 0;
+}
+
+static bool ep_table_has(const struct ep_table *tbl, const char *name) {
+  int i;
+
+  for (i = 0; i < tbl->nr; i++)
+    if (strcmp(tbl->ents[i].name, name) == 0)
+      return true;
+  return false;
+}
+
+void ep_table_free(struct ep_table *tbl) {
+  free(tbl->ents);
+  tbl->ents = NULL;
+  tbl->nr = 0;
+}
+
+int ep_discover(struct ep_table *tbl) {
+  struct dirent *de;
+  unsigned int id;
+  int i, cap = 0, rc = 0;
+  DIR *dir;
+
+  tbl->ents = NULL;
+  tbl->nr = 0;
+
+  /* the emulated devices replace whatever sysfs has */
+  if (cxlmi_emu_enabled()) {
+    for (i = 0; i < cxlmi_emu_count() && !rc; i++) {
+      if (ep_parse_id(cxlmi_emu_devname(i), &id))
+        rc = ep_table_add(tbl, &cap, id, cxlmi_emu_devname(i));
+    }
+    goto sort;
+  }
+
+  dir = opendir(EP_SYSFS_DEVICES);
+  if (!dir)
+    return 0;
+
+  while ((de = readdir(dir))) {
+    if (!ep_parse_id(de->d_name, &id))
+      continue;
+    rc = ep_table_add(tbl, &cap, id, de->d_name);
+    if (rc)
+      break;
+  }
+  closedir(dir);
+
+sort:
+  if (rc) {
+    ep_table_free(tbl);
+    return rc;
+  }
+
+  qsort(tbl->ents, tbl->nr, sizeof(*tbl->ents), ep_entry_cmp);
+
+  return tbl->nr;
+}
+
+static bool ep_match(const char *selector, const struct ep_entry *ent) {
+  unsigned int lo, hi;
+  int n = 0;
+
+  if (strcmp(selector, "all") == 0)
+    return true;
+
+  if (sscanf(selector, "mem[%u-%u]%n", &lo, &hi, &n) == 2 &&
+      selector[n] == '\0')
+    return ent->id >= lo && ent->id <= hi;
+
+  return fnmatch(selector, ent->name, 0) == 0;
+}
+
+int ep_select(struct ep_table *sel, int argc, const char **argv) {
+  struct ep_table found;
+  unsigned int id;
+  int i, j, cap = 0, rc, matched;
+
+  sel->ents = NULL;
+  sel->nr = 0;
+
+  rc = ep_discover(&found);
+  if (rc < 0)
+    return rc;
+
+  for (i = 0; i < argc; i++) {
+    if (ep_parse_id(argv[i], &id)) {
+      if (!ep_table_has(sel, argv[i])) {
+        rc = ep_table_add(sel, &cap, id, argv[i]);
+        if (rc)
+          goto out;
+      }
+      continue;
+    }
+
+    if (strcmp(argv[i], "all") != 0 && strncmp(argv[i], "mem", 3) != 0) {
+      fprintf(stderr, "'%s' is not a valid ep name\n", argv[i]);
+      continue;
+    }
+
+    matched = 0;
+    for (j = 0; j < found.nr; j++) {
+      if (!ep_match(argv[i], &found.ents[j]))
+        continue;
+      matched++;
+      if (ep_table_has(sel, found.ents[j].name))
+        continue;
+      rc = ep_table_add(sel, &cap, found.ents[j].id, found.ents[j].name);
+      if (rc)
+        goto out;
+    }
+    if (!matched)
+      fprintf(stderr, "no endpoint matches '%s'\n", argv[i]);
+  }
+  rc = sel->nr;
+
+out:
+  ep_table_free(&found);
+  if (rc < 0)
+    ep_table_free(sel);
+  return rc;
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/*
+ * Event record payload decoding, one table of fields per event UUID. Fields
+ * are read straight from record->data, so decoding a record is a UUID
+ * compare and a few byte loads per field, cheap enough for watch-events and
+ * get-event-records --drain going through thousands of records.
+ */
+
+/* std includes */
+#include <stdio.h>
+#include <string.h>
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "event_decode.h"
+
+#define CXL_DPA_FLAGS_MASK 0x3fULL
+
+/* DRAM Event Record, CXL 3.0 8.2.9.2.1.2; offsets from byte 0x30 */
+static const struct cxl_event_field dram_fields[] = {
+    {"dpa", 0x00, 8, -1, CXL_EVF_DPA},
+    {"dpa_flags", 0x00, 1, -1, CXL_EVF_DPA_FLAGS},
+    {"memory_event_descriptor", 0x08, 1, -1, CXL_EVF_HEX},
+    {"memory_event_type", 0x09, 1, -1, CXL_EVF_HEX},
+    {"transaction_type", 0x0a, 1, -1, CXL_EVF_HEX},
+    {"channel", 0x0d, 1, 0, CXL_EVF_DEC},
+    {"rank", 0x0e, 1, 1, CXL_EVF_DEC},
+    {"nibble_mask", 0x0f, 3, 2, CXL_EVF_HEX},
+    {"bank_group", 0x12, 1, 3, CXL_EVF_DEC},
+    {"bank", 0x13, 1, 4, CXL_EVF_DEC},
+    {"row", 0x14, 3, 5, CXL_EVF_DEC},
+    {"column", 0x17, 2, 6, CXL_EVF_DEC},
+};
+
+/* Memory Module Event Record, CXL 3.0 8.2.9.2.1.3; offsets from byte 0x30 */
+static const struct cxl_event_field mem_module_fields[] = {
+    {"device_event_type", 0x00, 1, -1, CXL_EVF_HEX},
+    {"health_status", 0x01, 1, -1, CXL_EVF_HEX},
+    {"media_status", 0x02, 1, -1, CXL_EVF_HEX},
+    {"additional_status", 0x03, 1, -1, CXL_EVF_HEX},
+    {"life_used", 0x04, 1, -1, CXL_EVF_DEC},
+    {"device_temperature", 0x05, 2, -1, CXL_EVF_S16},
+    {"dirty_shutdown_count", 0x07, 4, -1, CXL_EVF_DEC},
+    {"corrected_volatile_error_count", 0x0b, 4, -1, CXL_EVF_DEC},
+    {"corrected_persistent_error_count", 0x0f, 4, -1, CXL_EVF_DEC},
+};
+
+#define DECODER_FIELDS(f) .fields = (f), .nr_fields = sizeof(f) / sizeof((f)[0])
+
+static const struct cxl_event_decoder decoders[] = {
+    {
+        /* 601dcbb3-9c06-4eab-b8af-4e9bfb5c9624 */
+        .uuid = {0x60, 0x1d, 0xcb, 0xb3, 0x9c, 0x06, 0x4e, 0xab, 0xb8, 0xaf,
+                 0x4e, 0x9b, 0xfb, 0x5c, 0x96, 0x24},
+        .name = "DRAM",
+        .type = "dram",
+        .valid_off = 0x0b,
+        .valid_width = 2,
+        DECODER_FIELDS(dram_fields),
+    },
+    {
+        /* fe927475-dd59-4339-a586-79bab113b774 */
+        .uuid = {0xfe, 0x92, 0x74, 0x75, 0xdd, 0x59, 0x43, 0x39, 0xa5, 0x86,
+                 0x79, 0xba, 0xb1, 0x13, 0xb7, 0x74},
+        .name = "Memory Module Event",
+        .type = "memory_module",
+        DECODER_FIELDS(mem_module_fields),
+    },
+};
+
+static inline uint64_t ev_load_le(const uint8_t *p, int width) {
+  uint64_t v = 0;
+
+  while (width--)
+    v = v << 8 | p[width];
+  return v;
+}
+
+const struct cxl_event_decoder *
+cxl_event_decoder_find(const struct cxlmi_event_record *r) {
+  for (size_t i = 0; i < sizeof(decoders) / sizeof(decoders[0]); i++)
+    if (memcmp(r->uuid, decoders[i].uuid, sizeof(r->uuid)) == 0)
+      return &decoders[i];
+  return NULL;
+}
+
+uint64_t cxl_event_field_get(const struct cxlmi_event_record *r,
+                             const struct cxl_event_field *f) {
+  uint64_t v = ev_load_le(r->data + f->off, f->width);
+
+  switch (f->fmt) {
+  case CXL_EVF_DPA:
+    return v & ~CXL_DPA_FLAGS_MASK;
+  case CXL_EVF_DPA_FLAGS:
+    return v & CXL_DPA_FLAGS_MASK;
+  case CXL_EVF_S16:
+    return (uint64_t)(int64_t)(int16_t)v;
+  default:
+    return v;
+  }
+}
+
+bool cxl_event_field_valid(const struct cxl_event_decoder *dec,
+                           const struct cxlmi_event_record *r,
+                           const struct cxl_event_field *f) {
+  uint64_t flags;
+
+  if (f->valid_bit < 0 || !dec->valid_width)
+    return true;
+  flags = ev_load_le(r->data + dec->valid_off, dec->valid_width);
+  return flags >> f->valid_bit & 1;
+}
+
+void cxl_event_decode_print(const struct cxl_event_decoder *dec,
+                            const struct cxlmi_event_record *r, int indent) {
+  const struct cxl_event_field *f;
+  uint64_t v;
+
+  for (int i = 0; i < dec->nr_fields; i++) {
+    f = &dec->fields[i];
+    if (!cxl_event_field_valid(dec, r, f))
+      continue;
+    v = cxl_event_field_get(r, f);
+    if (f->fmt == CXL_EVF_DEC)
+      printf("%*s%s: %llu\n", indent, "", f->name, (unsigned long long)v);
+    else if (f->fmt == CXL_EVF_S16)
+      printf("%*s%s: %lld\n", indent, "", f->name, (long long)v);
+    else
+      printf("%*s%s: 0x%llx\n", indent, "", f->name, (unsigned long long)v);
+  }
+}
+
+void cxl_event_decode_json(const struct cxl_event_decoder *dec,
+                           const struct cxlmi_event_record *r) {
+  const struct cxl_event_field *f;
+  uint64_t v;
+
+  printf(", \"type\": \"%s\"", dec->type);
+  for (int i = 0; i < dec->nr_fields; i++) {
+    f = &dec->fields[i];
+    if (!cxl_event_field_valid(dec, r, f))
+      continue;
+    v = cxl_event_field_get(r, f);
+    if (f->fmt == CXL_EVF_S16)
+      printf(", \"%s\": %lld", f->name, (long long)v);
+    else
+      printf(", \"%s\": %llu", f->name, (unsigned long long)v);
+  }
+}
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/* std includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "fw_checkpoint.h"
+#include <vendor_commands.h>
+
+#define FW_CKPT_MAGIC 0x43584643 /* "CXFC" */
+#define FW_CKPT_VERSION 1
+#define FW_RECORD_MAGIC 0x43584652 /* "CXFR" */
+#define FW_RECORD_VERSION 1
+
+static const char *fw_checkpoint_dir(void) {
+  const char *s = getenv("CXL_FW_CKPT_DIR");
+
+  return s && *s ? s : FW_CKPT_DIR_DEFAULT;
+}
+
+static int fw_checkpoint_path(struct cxlmi_endpoint *ep, char *path,
+                              size_t path_sz) {
+  if (!ep || !ep->devname || strchr(ep->devname, '/'))
+    return -EINVAL;
+
+  snprintf(path, path_sz, "%s/%s.ckpt", fw_checkpoint_dir(), ep->devname);
+  return 0;
+}
+
+int fw_checkpoint_init(struct fw_checkpoint *ck, struct cxlmi_endpoint *ep,
+                       uint16_t opcode, uint32_t slot, size_t image_size,
+                       uint32_t image_crc) {
+  memset(ck, 0, sizeof(*ck));
+  ck->magic = FW_CKPT_MAGIC;
+  ck->version = FW_CKPT_VERSION;
+  ck->opcode = opcode;
+  ck->slot = slot;
+  ck->image_size = image_size;
+  ck->image_hash = image_crc;
+
+  /* without a serial a swapped device cannot be told apart: no resume */
+  return get_cxl_serial(ep, &ck->serial);
+}
+
+int fw_checkpoint_match(const struct fw_checkpoint *a,
+                        const struct fw_checkpoint *b) {
+  return a->serial == b->serial && a->opcode == b->opcode &&
+         a->slot == b->slot && a->image_size == b->image_size &&
+         a->image_hash == b->image_hash;
+}
+
+int fw_checkpoint_load(struct cxlmi_endpoint *ep, struct fw_checkpoint *ck) {
+  char path[PATH_MAX];
+  ssize_t n;
+  int fd;
+
+  if (fw_checkpoint_path(ep, path, sizeof(path)))
+    return -ENOENT;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -ENOENT;
+  n = read(fd, ck, sizeof(*ck));
+  close(fd);
+
+  if (n != sizeof(*ck) || ck->magic != FW_CKPT_MAGIC ||
+      ck->version != FW_CKPT_VERSION || !ck->block_size ||
+      ck->next_block >= ck->nr_blocks)
+    return -ENOENT;
+
+  return 0;
+}
+
+static int fw_checkpoint_mkdir(void) {
+  char dir[PATH_MAX], *p;
+
+  snprintf(dir, sizeof(dir), "%s", fw_checkpoint_dir());
+  for (p = dir + 1; *p; p++) {
+    if (*p != '/')
+      continue;
+    *p = 0;
+    if (mkdir(dir, 0700) && errno != EEXIST)
+      return -errno;
+    *p = '/';
+  }
+  if (mkdir(dir, 0700) && errno != EEXIST)
+    return -errno;
+
+  return 0;
+}
+
+int fw_checkpoint_open(struct cxlmi_endpoint *ep) {
+  char path[PATH_MAX];
+  int fd, rc;
+
+  rc = fw_checkpoint_path(ep, path, sizeof(path));
+  if (rc)
+    return rc;
+  rc = fw_checkpoint_mkdir();
+  if (rc)
+    return rc;
+
+  fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+  return fd < 0 ? -errno : fd;
+}
+
+/*
+ * A single small pwrite at offset 0: cheap enough for every block, and a
+ * reader never sees a file shorter than a checkpoint.
+ */
+int fw_checkpoint_write(int fd, const struct fw_checkpoint *ck) {
+  if (pwrite(fd, ck, sizeof(*ck), 0) != sizeof(*ck))
+    return -EIO;
+
+  return 0;
+}
+
+void fw_checkpoint_remove(struct cxlmi_endpoint *ep) {
+  char path[PATH_MAX];
+
+  if (!fw_checkpoint_path(ep, path, sizeof(path)))
+    unlink(path);
+}
+
+static int fw_slot_record_path(struct cxlmi_endpoint *ep, bool is_os,
+                               uint32_t slot, char *path, size_t path_sz) {
+  if (!ep || !ep->devname || strchr(ep->devname, '/'))
+    return -EINVAL;
+
+  snprintf(path, path_sz, "%s/%s.%s%u", fw_checkpoint_dir(), ep->devname,
+           is_os ? "os" : "fw", slot);
+  return 0;
+}
+
+int fw_slot_record_load(struct cxlmi_endpoint *ep, bool is_os, uint32_t slot,
+                        struct fw_slot_record *rec) {
+  char path[PATH_MAX];
+  uint64_t serial;
+  ssize_t n;
+  int fd;
+
+  if (fw_slot_record_path(ep, is_os, slot, path, sizeof(path)))
+    return -ENOENT;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -ENOENT;
+  n = read(fd, rec, sizeof(*rec));
+  close(fd);
+
+  /* a record of the device that used to sit behind this name is no use */
+  if (n != sizeof(*rec) || rec->magic != FW_RECORD_MAGIC ||
+      rec->version != FW_RECORD_VERSION || rec->slot != slot ||
+      rec->is_os != is_os || get_cxl_serial(ep, &serial) ||
+      rec->serial != serial)
+    return -ENOENT;
+
+  return 0;
+}
+
+int fw_slot_record_store(struct cxlmi_endpoint *ep,
+                         const struct fw_slot_record *rec) {
+  char path[PATH_MAX], tmp[PATH_MAX + 16];
+  struct fw_slot_record r = *rec;
+  int fd, rc;
+
+  rc = fw_slot_record_path(ep, rec->is_os, rec->slot, path, sizeof(path));
+  if (rc)
+    return rc;
+  rc = fw_checkpoint_mkdir();
+  if (rc)
+    return rc;
+
+  r.magic = FW_RECORD_MAGIC;
+  r.version = FW_RECORD_VERSION;
+
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid());
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return -errno;
+  if (write(fd, &r, sizeof(r)) != sizeof(r))
+    rc = -EIO;
+  close(fd);
+
+  if (!rc && rename(tmp, path))
+    rc = -errno;
+  if (rc)
+    unlink(tmp);
+
+  return rc;
+}
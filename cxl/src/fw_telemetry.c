@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/* std includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "fw_telemetry.h"
+#include <vendor_timing.h>
+
+#define FW_TELEMETRY_MIN_SAMPLES 64
+
+void fw_telemetry_init(struct fw_telemetry *t, struct cxlmi_endpoint *ep,
+                       bool enabled, bool json) {
+  memset(t, 0, sizeof(*t));
+  t->ep = ep;
+  t->enabled = enabled || json;
+  t->json = json;
+  t->start_ns = cxlmi_timing_now();
+}
+
+static void fw_telemetry_sample(struct fw_telemetry *t, uint64_t xfer_ns,
+                                uint64_t hbo_ns) {
+  uint64_t *x, *h;
+  uint32_t cap;
+
+  if (t->nr == t->cap) {
+    cap = t->cap ? t->cap * 2 : FW_TELEMETRY_MIN_SAMPLES;
+    x = realloc(t->xfer_block_ns, cap * sizeof(*x));
+    if (x)
+      t->xfer_block_ns = x;
+    h = realloc(t->hbo_block_ns, cap * sizeof(*h));
+    if (h)
+      t->hbo_block_ns = h;
+    /* out of memory: keep the totals, drop the percentiles from here */
+    if (!x || !h)
+      return;
+    t->cap = cap;
+  }
+
+  t->xfer_block_ns[t->nr] = xfer_ns;
+  t->hbo_block_ns[t->nr] = hbo_ns;
+  t->nr++;
+}
+
+void fw_telemetry_block(struct fw_telemetry *t, int block, int nr_blocks,
+                        uint32_t offset, int bytes, uint64_t xfer_ns,
+                        uint64_t hbo_ns, uint32_t hbo_polls,
+                        uint32_t retries) {
+  t->bytes += bytes;
+  if (!t->enabled)
+    return;
+
+  fw_telemetry_sample(t, xfer_ns, hbo_ns);
+  if (t->json)
+    printf("{\"event\": \"block\", \"dev\": \"%s\", \"block\": %d, "
+           "\"blocks\": %d, \"offset\": %u, \"bytes\": %d, "
+           "\"xfer_ns\": %lu, \"hbo_ns\": %lu, \"hbo_polls\": %u, "
+           "\"retries\": %u}\n",
+           get_devname(t->ep), block, nr_blocks, offset, bytes,
+           (unsigned long)xfer_ns, (unsigned long)hbo_ns, hbo_polls, retries);
+}
+
+static int fw_telemetry_cmp(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* p50, p90, p99 and max of ns[], sorted in place */
+static void fw_telemetry_pcts(uint64_t *ns, uint32_t nr, unsigned long *p) {
+  if (!nr) {
+    p[0] = p[1] = p[2] = p[3] = 0;
+    return;
+  }
+
+  qsort(ns, nr, sizeof(*ns), fw_telemetry_cmp);
+  p[0] = ns[nr / 2];
+  p[1] = ns[nr * 90 / 100];
+  p[2] = ns[nr * 99 / 100];
+  p[3] = ns[nr - 1];
+}
+
+void fw_telemetry_report(struct fw_telemetry *t, int rc) {
+  uint64_t total = cxlmi_timing_now() - t->start_ns;
+  uint64_t other = total - t->xfer_ns - t->backoff_ns - t->hbo_ns;
+  unsigned long xp[4], hp[4];
+  double bps = total ? t->bytes * 1e9 / total : 0;
+
+  if (!t->enabled)
+    goto out;
+
+  fw_telemetry_pcts(t->xfer_block_ns, t->nr, xp);
+  fw_telemetry_pcts(t->hbo_block_ns, t->nr, hp);
+
+  if (t->json) {
+    printf("{\"event\": \"summary\", \"dev\": \"%s\", \"rc\": %d, "
+           "\"bytes\": %lu, \"blocks\": %u, \"block_size\": %u, "
+           "\"total_ns\": %lu, \"xfer_ns\": %lu, \"backoff_ns\": %lu, "
+           "\"hbo_ns\": %lu, \"other_ns\": %lu, \"bytes_per_sec\": %.0f, "
+           "\"hbo_polls\": %u, \"retries\": %u, "
+           "\"xfer_p50_ns\": %lu, \"xfer_p90_ns\": %lu, "
+           "\"xfer_p99_ns\": %lu, \"xfer_max_ns\": %lu, "
+           "\"hbo_p50_ns\": %lu, \"hbo_p90_ns\": %lu, "
+           "\"hbo_p99_ns\": %lu, \"hbo_max_ns\": %lu}\n",
+           get_devname(t->ep), rc, (unsigned long)t->bytes, t->nr,
+           t->block_size, (unsigned long)total, (unsigned long)t->xfer_ns,
+           (unsigned long)t->backoff_ns, (unsigned long)t->hbo_ns,
+           (unsigned long)other, bps, t->hbo_polls, t->retries, xp[0], xp[1],
+           xp[2], xp[3], hp[0], hp[1], hp[2], hp[3]);
+    goto out;
+  }
+
+  printf("Transfer telemetry: %s\n", get_devname(t->ep));
+  printf("  %lu bytes in %u blocks of %u, %.1f ms, %.1f KiB/s\n",
+         (unsigned long)t->bytes, t->nr, t->block_size, total / 1e6,
+         bps / 1024);
+  printf("  time: transfer %.1f ms, retry backoff %.1f ms, hbo wait %.1f ms, "
+         "other %.1f ms\n",
+         t->xfer_ns / 1e6, t->backoff_ns / 1e6, t->hbo_ns / 1e6, other / 1e6);
+  printf("  block transfer us: p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+         xp[0] / 1e3, xp[1] / 1e3, xp[2] / 1e3, xp[3] / 1e3);
+  printf("  block hbo wait us: p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+         hp[0] / 1e3, hp[1] / 1e3, hp[2] / 1e3, hp[3] / 1e3);
+  printf("  hbo polls %u, retries %u\n", t->hbo_polls, t->retries);
+
+out:
+  free(t->xfer_block_ns);
+  free(t->hbo_block_ns);
+  t->xfer_block_ns = t->hbo_block_ns = NULL;
+  t->nr = t->cap = 0;
+}
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/*
+ * cxl rollout: firmware update across many devices in waves. A canary wave
+ * goes first, then fixed size waves. Every device in a wave is transferred
+ * (up to --jobs at once), activated and health checked; the next wave only
+ * starts if the failures so far stay within --max-failures.
+ */
+
+/* std includes */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "cxl_main.h"
+#include "ep_pool.h"
+#include "ep_select.h"
+#include <parse_option.h>
+#include <vendor_commands.h>
+#include <vendor_types.h>
+
+#define ROLLOUT_SLOT_MASK 0x07
+
+/* Device states, as reported in the summary */
+enum {
+  ROLLOUT_PENDING,
+  ROLLOUT_OK,
+  ROLLOUT_FAILED,
+  ROLLOUT_SKIPPED,
+};
+
+static const char *const rollout_state_str[] = {
+    [ROLLOUT_PENDING] = "pending",
+    [ROLLOUT_OK] = "ok",
+    [ROLLOUT_FAILED] = "failed",
+    [ROLLOUT_SKIPPED] = "skipped",
+};
+
+static struct _rollout_params {
+  const char *filepath;
+  uint32_t slot;
+  bool hbo;
+  bool is_os;
+  int jobs;
+  int canary;
+  int wave;
+  const char *activate;
+  int settle;
+  int max_failures;
+  bool skip_health;
+  bool resume;
+  const char *crc32c;
+  bool telemetry;
+  bool telemetry_json;
+} rollout_params;
+
+#define ROLLOUT_OPTIONS()                                                      \
+  OPT_FILENAME('f', "file", &rollout_params.filepath, "rom-file",              \
+               "filepath to read ROM for firmware update"),                    \
+      OPT_UINTEGER('s', "slot", &rollout_params.slot,                          \
+                   "slot to use for firmware loading"),                        \
+      OPT_BOOLEAN('b', "background", &rollout_params.hbo,                      \
+                  "transfer with the hbo vendor opcode"),                      \
+      OPT_BOOLEAN('z', "osimage", &rollout_params.is_os,                       \
+                  "select OS(a.k.a boot1) image"),                             \
+      OPT_INTEGER('j', "jobs", &rollout_params.jobs,                           \
+                  "devices transferring at once (default 1)"),                 \
+      OPT_INTEGER('c', "canary", &rollout_params.canary,                       \
+                  "devices in the first wave (default 1)"),                    \
+      OPT_INTEGER('w', "wave", &rollout_params.wave,                           \
+                  "devices per wave after the canary (default all)"),          \
+      OPT_STRING('a', "activate", &rollout_params.activate, "mode",            \
+                 "online (default), reset or none"),                           \
+      OPT_INTEGER(0, "settle", &rollout_params.settle,                         \
+                  "seconds between activation and health check (default 5)"),  \
+      OPT_INTEGER(0, "max-failures", &rollout_params.max_failures,             \
+                  "failed devices tolerated before stopping (default 0)"),     \
+      OPT_BOOLEAN(0, "skip-health", &rollout_params.skip_health,               \
+                  "gate on fw info only, not on get-health-info"),             \
+      OPT_BOOLEAN(0, "resume", &rollout_params.resume,                         \
+                  "continue transfers left open by a timed out rollout"),      \
+      OPT_STRING(0, "crc32c", &rollout_params.crc32c, "hex",                   \
+                 "refuse the image unless its crc32c matches"),               \
+      OPT_BOOLEAN(0, "telemetry", &rollout_params.telemetry,                   \
+                  "print transfer throughput and latency per device"),         \
+      OPT_BOOLEAN(0, "telemetry-json", &rollout_params.telemetry_json,         \
+                  "transfer telemetry as JSON lines")
+
+static const struct option cmd_rollout_options[] = {
+    ROLLOUT_OPTIONS(),
+    OPT_END(),
+};
+
+/* Activation mode, parsed from --activate; < 0 means none */
+static int rollout_activate;
+static int rollout_wave_nr, rollout_nr_waves;
+
+static void rollout_progress(struct cxlmi_endpoint *ep, int percent) {
+  fprintf(stderr, "[wave %d/%d] %s: transfer %d%%\n", rollout_wave_nr,
+          rollout_nr_waves, get_devname(ep), percent);
+}
+
+static int rollout_fail(struct cxlmi_endpoint *ep, const char *stage, int rc) {
+  fprintf(stderr, "[wave %d/%d] %s: %s failed (%d)\n", rollout_wave_nr,
+          rollout_nr_waves, get_devname(ep), stage, rc);
+  return rc ? rc : -EIO;
+}
+
+/* The image must be in the expected slot: active, or staged for a reset */
+static int rollout_check_fw(struct cxlmi_endpoint *ep) {
+  struct cxlmi_cmd_get_fw_info fw_info;
+  int rc, slot;
+
+  /* straight to the device, never from the response cache */
+  if (rollout_params.is_os)
+    rc = cxlmi_cmd_get_os_fw_info(ep, NULL, &fw_info);
+  else
+    rc = cxlmi_cmd_get_fw_info(ep, NULL, &fw_info);
+  if (rc)
+    return rc;
+
+  if (rollout_activate == ACTIVATE_ON_RESET)
+    slot = (fw_info.slot_info >> 3) & ROLLOUT_SLOT_MASK;
+  else
+    slot = fw_info.slot_info & ROLLOUT_SLOT_MASK;
+  if (rollout_activate >= 0 && slot != rollout_params.slot) {
+    fprintf(stderr, "%s: slot %d %s, expected %d\n", get_devname(ep), slot,
+            rollout_activate == ACTIVATE_ON_RESET ? "staged" : "active",
+            rollout_params.slot);
+    return -EIO;
+  }
+
+  return 0;
+}
+
+static int rollout_check_health(struct cxlmi_endpoint *ep) {
+  struct cxlmi_cmd_memdev_get_health_info health_info;
+  int rc;
+
+  rc = cxlmi_cmd_memdev_get_health_info(ep, NULL, &health_info);
+  if (rc)
+    return rc;
+
+  /* any of maintenance needed, performance degraded, replacement needed */
+  if (health_info.health_status || health_info.media_status) {
+    fprintf(stderr, "%s: health_state 0x%x media_status 0x%x\n",
+            get_devname(ep), health_info.health_status,
+            health_info.media_status);
+    return -EIO;
+  }
+
+  return 0;
+}
+
+/* Runs in an ep_pool worker: transfer, activate, settle, gate */
+static int rollout_device(struct cxlmi_endpoint *ep) {
+  struct _update_fw_params params = {
+      .filepath = rollout_params.filepath,
+      .slot = rollout_params.slot,
+      .hbo = rollout_params.hbo,
+      .resume = rollout_params.resume,
+      .crc32c = rollout_params.crc32c,
+      .telemetry = rollout_params.telemetry,
+      .telemetry_json = rollout_params.telemetry_json,
+      .progress = rollout_progress,
+  };
+  int rc;
+
+  rc = cxl_cmd_update_device_fw(ep, rollout_params.is_os, &params);
+  if (rc)
+    return rollout_fail(ep, "transfer", rc);
+
+  if (rollout_activate >= 0) {
+    rc = cxl_cmd_activate_fw(ep, rollout_params.hbo || rollout_params.is_os,
+                             rollout_activate, rollout_params.slot);
+    if (rc)
+      return rollout_fail(ep, "activate", rc);
+    if (rollout_params.settle > 0)
+      sleep(rollout_params.settle);
+  }
+
+  rc = rollout_check_fw(ep);
+  if (rc)
+    return rollout_fail(ep, "fw info check", rc);
+
+  if (!rollout_params.skip_health) {
+    rc = rollout_check_health(ep);
+    if (rc)
+      return rollout_fail(ep, "health check", rc);
+  }
+
+  fprintf(stderr, "[wave %d/%d] %s: done\n", rollout_wave_nr,
+          rollout_nr_waves, get_devname(ep));
+  return 0;
+}
+
+/* Canary first, then --wave devices at a time (default: all the rest) */
+static int rollout_wave_size(int start, int nr_eps) {
+  int n;
+
+  if (start == 0 && rollout_params.canary)
+    n = rollout_params.canary;
+  else
+    n = rollout_params.wave ? rollout_params.wave : nr_eps - start;
+
+  return n < nr_eps - start ? n : nr_eps - start;
+}
+
+static int rollout_parse_activate(const char *mode) {
+  if (!mode || strcmp(mode, "online") == 0)
+    return ACTIVATE_ONLINE;
+  if (strcmp(mode, "reset") == 0)
+    return ACTIVATE_ON_RESET;
+  if (strcmp(mode, "none") == 0)
+    return -1;
+  return -2;
+}
+
+int cmd_rollout(int argc, const char **argv, struct cxlmi_ctx *ctx) {
+  const char *const u[] = {
+      "cxl " STR_ROLLOUT " <mem0> [<mem1>..<memN>] -f <rom-file> -s <slot> "
+      "[<options>]",
+      NULL};
+  _cleanup_free_ struct cxlmi_endpoint **eps = NULL;
+  _cleanup_free_ bool *opened = NULL;
+  _cleanup_free_ int *results = NULL;
+  _cleanup_free_ int *state = NULL;
+  struct ep_table sel;
+  int i, n, rc, start, nr_eps = 0, failed = 0;
+
+  reset_options(cmd_rollout_options);
+  rollout_params.jobs = 1;
+  rollout_params.canary = 1;
+  rollout_params.settle = 5;
+  argc = parse_options(argc, argv, cmd_rollout_options, u, 0);
+  if (argc == 0 || !rollout_params.filepath || !rollout_params.slot)
+    usage_with_options(u, cmd_rollout_options);
+
+  rollout_activate = rollout_parse_activate(rollout_params.activate);
+  if (rollout_activate < -1) {
+    fprintf(stderr, "--activate must be online, reset or none\n");
+    return EXIT_FAILURE;
+  }
+  if (rollout_params.jobs < 1 || rollout_params.jobs > EP_POOL_MAX_JOBS) {
+    fprintf(stderr, "--jobs must be between 1 and %d\n", EP_POOL_MAX_JOBS);
+    return EXIT_FAILURE;
+  }
+  if (rollout_params.canary < 0 || rollout_params.wave < 0 ||
+      rollout_params.max_failures < 0) {
+    fprintf(stderr, "--canary, --wave and --max-failures must be >= 0\n");
+    return EXIT_FAILURE;
+  }
+  if (access(rollout_params.filepath, R_OK)) {
+    fprintf(stderr, "cannot read %s: %s\n", rollout_params.filepath,
+            strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  rc = ep_select(&sel, argc, argv);
+  if (rc <= 0) {
+    fprintf(stderr, "no endpoint selected\n");
+    return EXIT_FAILURE;
+  }
+
+  eps = calloc(sel.nr, sizeof(*eps));
+  opened = calloc(sel.nr, sizeof(*opened));
+  results = calloc(sel.nr, sizeof(*results));
+  state = calloc(sel.nr, sizeof(*state));
+  if (!eps || !opened || !results || !state) {
+    ep_table_free(&sel);
+    return EXIT_FAILURE;
+  }
+
+  /* endpoints kept open by batch or serve are reused, and left open */
+  for (i = 0; i < sel.nr; i++) {
+    eps[nr_eps] = cmd_find_open_ep(ctx, sel.ents[i].name);
+    if (!eps[nr_eps]) {
+      eps[nr_eps] = cmd_open_ep(ctx, sel.ents[i].name);
+      opened[nr_eps] = eps[nr_eps] != NULL;
+    }
+    if (!eps[nr_eps]) {
+      fprintf(stderr, "cannot open '%s' endpoint, left out\n",
+              sel.ents[i].name);
+      continue;
+    }
+    nr_eps++;
+  }
+  ep_table_free(&sel);
+
+  rollout_nr_waves = 0;
+  for (start = 0; start < nr_eps; start += rollout_wave_size(start, nr_eps))
+    rollout_nr_waves++;
+
+  for (start = 0, rollout_wave_nr = 1; start < nr_eps; rollout_wave_nr++) {
+    n = rollout_wave_size(start, nr_eps);
+    fprintf(stderr, "[wave %d/%d] %d device(s)\n", rollout_wave_nr,
+            rollout_nr_waves, n);
+    rc = ep_pool_run(eps + start, n, rollout_params.jobs, rollout_device,
+                     results + start);
+
+    for (i = start; i < start + n; i++) {
+      state[i] = results[i] ? ROLLOUT_FAILED : ROLLOUT_OK;
+      if (results[i])
+        failed++;
+    }
+    start += n;
+
+    /*
+     * A worker that died may have left its device mid transfer, whatever
+     * --max-failures allows: don't take any more devices down with it.
+     */
+    if ((rc < 0 || failed > rollout_params.max_failures) && start < nr_eps) {
+      fprintf(stderr,
+              "[wave %d/%d] %d failure(s)%s, stopping with %d device(s) "
+              "left\n",
+              rollout_wave_nr, rollout_nr_waves, failed,
+              rc < 0 ? ", worker lost" : "", nr_eps - start);
+      for (i = start; i < nr_eps; i++)
+        state[i] = ROLLOUT_SKIPPED;
+      break;
+    }
+  }
+
+  printf("rollout summary:\n");
+  for (i = 0; i < nr_eps; i++)
+    printf("    %-8s %s\n", get_devname(eps[i]),
+           rollout_state_str[state[i]]);
+
+  for (i = 0; i < nr_eps; i++) {
+    if (opened[i])
+      cmd_close_ep(eps[i]);
+  }
+
+  return failed || rc < 0 ? EXIT_FAILURE : 0;
+}
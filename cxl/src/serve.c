@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/* std includes */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "cxl_main.h"
+#include "ep_select.h"
+#include <parse_option.h>
+
+/* One request is a single line: "<cmd> [<args>...]\n" */
+#define SERVE_REQ_MAX 4096
+#define SERVE_ARGS_MAX 64
+#define SERVE_BACKLOG 64
+
+static volatile sig_atomic_t serve_stop;
+
+static void serve_on_signal(int sig) {
+  if (sig != SIGCHLD)
+    serve_stop = 1;
+}
+
+static struct _serve_params {
+  const char *socket;
+} serve_params;
+
+#define SERVE_OPTIONS()                                                        \
+  OPT_STRING('s', "socket", &serve_params.socket, "path",                      \
+             "unix socket to listen on (default " STR_SERVE_SOCKET_DEFAULT     \
+             ")")
+
+static const struct option cmd_serve_options[] = {
+    SERVE_OPTIONS(),
+    OPT_END(),
+};
+
+/* The socket we bound, so that only that one is removed on exit */
+static dev_t serve_sock_dev;
+static ino_t serve_sock_ino;
+
+/*
+ * A socket left behind by a previous run would make bind() fail. Remove it,
+ * but only when it is a socket nobody listens on any more: path comes from
+ * the command line and must never cost an unrelated file.
+ */
+static int serve_remove_stale(const struct sockaddr_un *addr) {
+  const char *path = addr->sun_path;
+  struct stat st;
+  int fd, rc;
+
+  if (lstat(path, &st))
+    return errno == ENOENT ? 0 : -errno;
+  if (!S_ISSOCK(st.st_mode)) {
+    fprintf(stderr, "%s exists and is not a socket\n", path);
+    return -EEXIST;
+  }
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -errno;
+  rc = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) ? -errno : 0;
+  close(fd);
+
+  if (!rc) {
+    fprintf(stderr, "%s is in use by another server\n", path);
+    return -EADDRINUSE;
+  }
+  if (rc != -ECONNREFUSED) {
+    fprintf(stderr, "cannot probe %s: %s\n", path, strerror(-rc));
+    return rc;
+  }
+
+  return unlink(path) ? -errno : 0;
+}
+
+static int serve_listen(const char *path) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  struct stat st;
+  mode_t mask;
+  int fd, rc;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "socket path too long: %s\n", path);
+    return -ENAMETOOLONG;
+  }
+  strcpy(addr.sun_path, path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -errno;
+
+  rc = serve_remove_stale(&addr);
+  if (rc) {
+    close(fd);
+    return rc;
+  }
+
+  /* owner only socket; the umask of the daemon itself stays as it was */
+  mask = umask(0077);
+  rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ? -errno : 0;
+  umask(mask);
+  if (!rc && listen(fd, SERVE_BACKLOG) < 0)
+    rc = -errno;
+  if (rc) {
+    fprintf(stderr, "cannot listen on %s: %s\n", path, strerror(-rc));
+    close(fd);
+    return rc;
+  }
+
+  if (!lstat(path, &st)) {
+    serve_sock_dev = st.st_dev;
+    serve_sock_ino = st.st_ino;
+  }
+
+  return fd;
+}
+
+/* Remove the socket on exit, unless it has been replaced meanwhile */
+static void serve_unlink(const char *path) {
+  struct stat st;
+
+  if (!lstat(path, &st) && S_ISSOCK(st.st_mode) &&
+      st.st_dev == serve_sock_dev && st.st_ino == serve_sock_ino)
+    unlink(path);
+}
+
+static int serve_read_request(int fd, char *buf, size_t len) {
+  size_t off = 0;
+  ssize_t n;
+
+  while (off < len - 1) {
+    n = read(fd, buf + off, len - 1 - off);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    off += n;
+    if (memchr(buf + off - n, '\n', n))
+      break;
+  }
+  buf[off] = '\0';
+
+  return off ? 0 : -EIO;
+}
+
+/*
+ * Runs in its own process per connection. The command itself runs in a
+ * further child so that exit() from option parsing or run_builtin() still
+ * lets us report the status back to the client.
+ */
+static void serve_handle(int cfd, struct cxlmi_ctx *ctx) {
+  char req[SERVE_REQ_MAX], status[32];
+  const char *argv[SERVE_ARGS_MAX + 1];
+  char *tok, *save = NULL;
+  int argc = 0, wstatus, rc;
+  pid_t pid;
+
+  if (serve_read_request(cfd, req, sizeof(req)))
+    _exit(EXIT_FAILURE);
+
+  for (tok = strtok_r(req, " \t\r\n", &save);
+       tok && argc < SERVE_ARGS_MAX; tok = strtok_r(NULL, " \t\r\n", &save))
+    argv[argc++] = tok;
+  argv[argc] = NULL;
+
+  if (!argc || strcmp(argv[0], STR_SERVE) == 0) {
+    dprintf(cfd, "invalid request\nexit-status: %d\n", EXIT_FAILURE);
+    _exit(EXIT_FAILURE);
+  }
+
+  pid = fork();
+  if (pid == 0) {
+    dup2(cfd, STDOUT_FILENO);
+    dup2(cfd, STDERR_FILENO);
+    close(cfd);
+    cxl_handle_internal_command(argc, argv, ctx);
+    /* only reached for unknown commands */
+    fflush(stdout);
+    exit(EXIT_FAILURE);
+  }
+
+  if (pid < 0) {
+    rc = EXIT_FAILURE;
+  } else {
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR)
+      ;
+    rc = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+  }
+
+  snprintf(status, sizeof(status), "exit-status: %d\n", rc);
+  if (write(cfd, status, strlen(status)) < 0)
+    _exit(EXIT_FAILURE);
+  close(cfd);
+  _exit(rc);
+}
+
+int cmd_serve(int argc, const char **argv, struct cxlmi_ctx *ctx) {
+  const char *const u[] = {
+      "cxl " STR_SERVE " [<mem0>..<memN> | mem[A-B] | mem* | all] [<options>]",
+      NULL};
+  const char *all[] = {"all"};
+  struct sigaction sa = {.sa_handler = serve_on_signal};
+  struct cxlmi_endpoint *ep;
+  struct ep_table sel;
+  int i, lfd, cfd, rc;
+  pid_t pid;
+
+  serve_params.socket = STR_SERVE_SOCKET_DEFAULT;
+  argc = parse_options(argc, argv, cmd_serve_options, u, 0);
+  if (argc == 0) {
+    argc = 1;
+    argv = all;
+  }
+
+  /* keep every selected endpoint open for the lifetime of the daemon */
+  rc = ep_select(&sel, argc, argv);
+  if (rc < 0)
+    return EXIT_FAILURE;
+  for (i = 0; i < sel.nr; i++) {
+    ep = cmd_open_ep(ctx, sel.ents[i].name);
+    if (!ep)
+      fprintf(stderr, "cannot open '%s' endpoint\n", sel.ents[i].name);
+  }
+  ep_table_free(&sel);
+  cmd_keep_endpoints_open(true);
+
+  lfd = serve_listen(serve_params.socket);
+  if (lfd < 0)
+    return EXIT_FAILURE;
+
+  /* no SA_RESTART: signals must kick us out of accept() */
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGCHLD, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  fflush(stdout);
+  fflush(stderr);
+
+  while (!serve_stop) {
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+      ;
+
+    cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+    if (cfd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      fprintf(stderr, "accept failed: %s\n", strerror(errno));
+      break;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+      close(lfd);
+      serve_handle(cfd, ctx);
+    }
+    if (pid < 0) {
+      fprintf(stderr, "cannot fork for a request: %s\n", strerror(errno));
+      dprintf(cfd, "server busy\nexit-status: %d\n", EXIT_FAILURE);
+    }
+    close(cfd);
+  }
+
+  close(lfd);
+  serve_unlink(serve_params.socket);
+
+  return 0;
+}
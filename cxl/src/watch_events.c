@@ -0,0 +1,444 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+/*
+ * cxl watch-events: keep polling the event logs of one or more devices and
+ * print every new record exactly once, as a JSON line, clearing it once it
+ * is out. Each device is polled on its own interval, which follows how fast
+ * its logs fill: the estimated time for a log to reach a quarter of its
+ * capacity, backing off while the logs stay quiet and dropping to the
+ * minimum on an overflow.
+ */
+
+/* std includes */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* libcxlmi includes */
+#include <ccan/endian/endian.h>
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include "cxl_cmd.h"
+#include "cxl_main.h"
+#include "ep_select.h"
+#include "event_decode.h"
+#include <parse_option.h>
+#include <vendor_commands.h>
+#include <vendor_timing.h>
+
+#define WATCH_MIN_MS_DEFAULT 100
+#define WATCH_MAX_MS_DEFAULT 10000
+/* poll again by the time a log is expected to be this full, in percent */
+#define WATCH_FILL_TARGET 25
+/* weight of the latest poll in the fill rate estimate, in percent */
+#define WATCH_RATE_WEIGHT 50
+/* when identify cannot tell the size of a log */
+#define WATCH_LOG_SIZE_DEFAULT 32
+/* pages read per log per poll, so one busy log cannot starve the others */
+#define WATCH_PAGES_MAX 16
+
+struct watch_log {
+  uint16_t size;     /* records the log holds, from identify */
+  uint16_t overflow; /* last overflow_err_count reported */
+  double rate;       /* records per second, smoothed */
+  /* printed but not cleared yet: never printed again, cleared next poll */
+  uint16_t *pending;
+  int nr_pending;
+};
+
+struct watch_dev {
+  struct cxlmi_endpoint *ep;
+  bool opened;
+  uint64_t last_ns;
+  uint64_t next_ns;
+  uint32_t interval_ms;
+  bool irq_saved;
+  struct cxlmi_cmd_get_event_interrupt_policy irq;
+  struct watch_log log[CXL_EVENT_LOG_NR];
+};
+
+static struct _watch_params {
+  int min_ms;
+  int max_ms;
+  int duration;
+  bool irq_off;
+} watch_params;
+
+static const struct option cmd_watch_events_options[] = {
+    OPT_INTEGER(0, "min-interval", &watch_params.min_ms,
+                "shortest poll interval in ms (default 100)"),
+    OPT_INTEGER(0, "max-interval", &watch_params.max_ms,
+                "longest poll interval in ms (default 10000)"),
+    OPT_INTEGER('d', "duration", &watch_params.duration,
+                "stop after this many seconds (default: until signalled)"),
+    OPT_BOOLEAN(0, "irq-off", &watch_params.irq_off,
+                "turn event interrupts off while watching"),
+    OPT_END(),
+};
+
+static volatile sig_atomic_t watch_stop;
+
+static void watch_on_signal(int sig) { watch_stop = 1; }
+
+static void watch_emit_record(struct watch_dev *d, int log,
+                              struct cxlmi_event_record *r) {
+  const struct cxl_event_decoder *dec = cxl_event_decoder_find(r);
+  char uuid[40];
+
+  uuid_unparse(r->uuid, uuid);
+  printf("{\"event\": \"record\", \"dev\": \"%s\", \"log\": \"%s\", "
+         "\"handle\": %u, \"related_handle\": %u, \"timestamp\": %llu, "
+         "\"uuid\": \"%s\", \"flags\": \"0x%02x%02x%02x\", \"length\": %u, "
+         "\"data\": \"",
+         get_devname(d->ep), cxl_event_log_names[log], le16_to_cpu(r->handle),
+         le16_to_cpu(r->related_handle),
+         (unsigned long long)le64_to_cpu(r->timestamp), uuid, r->flags[0],
+         r->flags[1], r->flags[2], r->length);
+  for (size_t i = 0; i < sizeof(r->data); i++)
+    printf("%02x", r->data[i]);
+  printf("\"");
+  if (dec)
+    cxl_event_decode_json(dec, r);
+  printf("}\n");
+}
+
+static void watch_emit_overflow(struct watch_dev *d, int log,
+                                struct cxlmi_cmd_get_event_records_rsp *page) {
+  printf("{\"event\": \"overflow\", \"dev\": \"%s\", \"log\": \"%s\", "
+         "\"overflow_err_count\": %u, \"first_overflow_timestamp\": %llu, "
+         "\"last_overflow_timestamp\": %llu}\n",
+         get_devname(d->ep), cxl_event_log_names[log],
+         page->overflow_err_count,
+         (unsigned long long)le64_to_cpu(page->first_overflow_timestamp),
+         (unsigned long long)le64_to_cpu(page->last_overflow_timestamp));
+}
+
+static bool watch_is_pending(struct watch_log *l, uint16_t handle) {
+  for (int i = 0; i < l->nr_pending; i++)
+    if (l->pending[i] == handle)
+      return true;
+  return false;
+}
+
+static int watch_add_pending(struct watch_log *l, const uint16_t *handles,
+                             int nr) {
+  uint16_t *p;
+
+  p = realloc(l->pending, (l->nr_pending + nr) * sizeof(*p));
+  if (!p)
+    return -ENOMEM;
+  memcpy(p + l->nr_pending, handles, nr * sizeof(*p));
+  l->pending = p;
+  l->nr_pending += nr;
+  return 0;
+}
+
+/*
+ * Print and clear what is new in one log. *nr_new counts the records
+ * printed; *hurry is set on a new overflow, or when records are still left
+ * after WATCH_PAGES_MAX pages. A failed clear keeps the handles pending, so
+ * the records are skipped rather than printed again.
+ */
+static int watch_poll_log(struct watch_dev *d, int log,
+                          struct cxlmi_cmd_get_event_records_rsp *page,
+                          uint16_t *handles, uint32_t *nr_new, bool *hurry) {
+  struct cxlmi_cmd_get_event_records_req req = {.event_log = log};
+  struct watch_log *l = &d->log[log];
+  uint16_t handle;
+  int rc, nr;
+
+  if (l->nr_pending &&
+      !cxl_event_clear_handles(d->ep, log, l->pending, l->nr_pending))
+    l->nr_pending = 0;
+
+  for (int pg = 0; pg < WATCH_PAGES_MAX; pg++) {
+    rc = cxlmi_cmd_get_event_records(d->ep, NULL, &req, page);
+    if (rc)
+      return rc;
+
+    if ((page->flags & CXL_EVENT_FLAG_OVERFLOW) &&
+        page->overflow_err_count != l->overflow) {
+      watch_emit_overflow(d, log, page);
+      *hurry = true;
+    }
+    l->overflow = page->flags & CXL_EVENT_FLAG_OVERFLOW
+                      ? page->overflow_err_count
+                      : 0;
+
+    nr = 0;
+    for (int rec = 0; rec < page->record_count; rec++) {
+      handle = le16_to_cpu(page->records[rec].handle);
+      if (watch_is_pending(l, handle))
+        continue;
+      watch_emit_record(d, log, &page->records[rec]);
+      handles[nr++] = handle;
+    }
+    fflush(stdout);
+    *nr_new += nr;
+
+    /* nothing but pending records: clearing them failed already */
+    if (!nr)
+      return 0;
+    rc = cxl_event_clear_handles(d->ep, log, handles, nr);
+    if (rc) {
+      fprintf(stderr, "%s: clear %s event records failed: %d\n",
+              get_devname(d->ep), cxl_event_log_names[log], rc);
+      return watch_add_pending(l, handles, nr);
+    }
+
+    if (!(page->flags & CXL_EVENT_FLAG_MORE_RECORDS))
+      return 0;
+  }
+
+  *hurry = true;
+  return 0;
+}
+
+/*
+ * Next interval: the time the fastest filling log takes to reach
+ * WATCH_FILL_TARGET of its size at its smoothed rate. Quiet logs back off
+ * by doubling, so a burst after a quiet spell is caught within one interval;
+ * hurry (an overflow, a log not read to the end) goes straight to the
+ * minimum.
+ */
+static void watch_update_interval(struct watch_dev *d, const uint32_t *nr_new,
+                                  bool hurry, uint64_t now) {
+  double dt = (now - d->last_ns) / 1e9, ms;
+  uint32_t interval = watch_params.max_ms;
+  struct watch_log *l;
+
+  for (int log = 0; log < CXL_EVENT_LOG_NR; log++) {
+    l = &d->log[log];
+    if (dt > 0)
+      l->rate = (WATCH_RATE_WEIGHT * (nr_new[log] / dt) +
+                 (100 - WATCH_RATE_WEIGHT) * l->rate) /
+                100;
+    if (l->rate <= 0)
+      continue;
+    ms = 1000.0 * l->size * WATCH_FILL_TARGET / 100 / l->rate;
+    if (ms < interval)
+      interval = ms;
+  }
+
+  if (interval > d->interval_ms * 2)
+    interval = d->interval_ms * 2;
+  if (hurry || interval < (uint32_t)watch_params.min_ms)
+    interval = watch_params.min_ms;
+  if (interval > (uint32_t)watch_params.max_ms)
+    interval = watch_params.max_ms;
+
+  d->interval_ms = interval;
+  d->last_ns = now;
+}
+
+static int watch_poll(struct watch_dev *d,
+                      struct cxlmi_cmd_get_event_records_rsp *page,
+                      uint16_t *handles) {
+  uint32_t nr_new[CXL_EVENT_LOG_NR] = {};
+  bool hurry = false;
+  uint64_t now;
+  int rc = 0;
+
+  for (int log = 0; log < CXL_EVENT_LOG_NR && !watch_stop; log++) {
+    rc = watch_poll_log(d, log, page, handles, &nr_new[log], &hurry);
+    if (rc) {
+      fprintf(stderr, "%s: get %s event records failed: %d\n",
+              get_devname(d->ep), cxl_event_log_names[log], rc);
+      break;
+    }
+  }
+
+  now = cxlmi_timing_now();
+  if (rc)
+    d->interval_ms = watch_params.max_ms;
+  else
+    watch_update_interval(d, nr_new, hurry, now);
+  d->next_ns = now + d->interval_ms * 1000000ULL;
+
+  return rc;
+}
+
+static void watch_setup(struct watch_dev *d) {
+  struct cxlmi_cmd_set_event_interrupt_policy off = {};
+  struct cxlmi_cmd_memdev_identify id;
+  uint16_t sizes[CXL_EVENT_LOG_NR] = {};
+
+  if (!cxlmi_cmd_memdev_identify(d->ep, NULL, &id)) {
+    sizes[0] = le16_to_cpu(id.info_event_log_size);
+    sizes[1] = le16_to_cpu(id.warning_event_log_size);
+    sizes[2] = le16_to_cpu(id.failure_event_log_size);
+    sizes[3] = le16_to_cpu(id.fatal_event_log_size);
+  }
+  for (int log = 0; log < CXL_EVENT_LOG_NR; log++)
+    d->log[log].size = sizes[log] ? sizes[log] : WATCH_LOG_SIZE_DEFAULT;
+
+  d->interval_ms = watch_params.min_ms;
+  d->last_ns = d->next_ns = cxlmi_timing_now();
+
+  if (!watch_params.irq_off)
+    return;
+  if (cxlmi_cmd_get_event_interrupt_policy(d->ep, NULL, &d->irq) ||
+      cxlmi_cmd_set_event_interrupt_policy(d->ep, NULL, &off)) {
+    fprintf(stderr, "%s: cannot turn event interrupts off\n",
+            get_devname(d->ep));
+    return;
+  }
+  d->irq_saved = true;
+}
+
+static void watch_teardown(struct watch_dev *d) {
+  struct cxlmi_cmd_set_event_interrupt_policy irq = {0};
+
+  if (d->irq_saved) {
+    irq.informational_settings = d->irq.informational_settings;
+    irq.warning_settings = d->irq.warning_settings;
+    irq.failure_settings = d->irq.failure_settings;
+    irq.fatal_settings = d->irq.fatal_settings;
+    if (cxlmi_cmd_set_event_interrupt_policy(d->ep, NULL, &irq))
+      fprintf(stderr, "%s: cannot restore the event interrupt policy\n",
+              get_devname(d->ep));
+  }
+  for (int log = 0; log < CXL_EVENT_LOG_NR; log++)
+    free(d->log[log].pending);
+  if (d->opened)
+    cmd_close_ep(d->ep);
+}
+
+static void watch_sleep_until(uint64_t ns) {
+  uint64_t now = cxlmi_timing_now();
+  struct timespec ts;
+
+  if (ns <= now)
+    return;
+  ns -= now;
+  ts.tv_sec = ns / 1000000000ULL;
+  ts.tv_nsec = ns % 1000000000ULL;
+  /* a signal cuts the sleep short, the caller checks watch_stop */
+  nanosleep(&ts, NULL);
+}
+
+int cmd_watch_events(int argc, const char **argv, struct cxlmi_ctx *ctx) {
+  const char *const u[] = {"cxl " STR_WATCH_EVENTS
+                           " [<mem0>..<memN> | mem[A-B] | mem* | all] "
+                           "[<options>]",
+                           NULL};
+  const char *all[] = {"all"};
+  _cleanup_free_ struct cxlmi_cmd_get_event_records_rsp *page = NULL;
+  _cleanup_free_ struct watch_dev *devs = NULL;
+  _cleanup_free_ uint16_t *handles = NULL;
+  struct sigaction sa = {.sa_handler = watch_on_signal};
+  struct sigaction old_int, old_term;
+  bool sig_set = false;
+  struct watch_dev *d;
+  struct ep_table sel;
+  int i, rc, nr_devs = 0, payload_max, page_max = 0, failed = 0;
+  uint64_t deadline = 0;
+
+  /* a batch or serve session may run watch-events more than once */
+  watch_stop = 0;
+
+  reset_options(cmd_watch_events_options);
+  watch_params.min_ms = WATCH_MIN_MS_DEFAULT;
+  watch_params.max_ms = WATCH_MAX_MS_DEFAULT;
+  argc = parse_options(argc, argv, cmd_watch_events_options, u, 0);
+  if (argc == 0) {
+    argc = 1;
+    argv = all;
+  }
+  if (watch_params.min_ms < 1 || watch_params.max_ms < watch_params.min_ms ||
+      watch_params.duration < 0) {
+    fprintf(stderr, "need 1 <= --min-interval <= --max-interval and "
+                    "--duration >= 0\n");
+    return EXIT_FAILURE;
+  }
+
+  rc = ep_select(&sel, argc, argv);
+  if (rc <= 0) {
+    fprintf(stderr, "no endpoint selected\n");
+    return EXIT_FAILURE;
+  }
+  devs = calloc(sel.nr, sizeof(*devs));
+  if (!devs) {
+    ep_table_free(&sel);
+    return EXIT_FAILURE;
+  }
+
+  /* endpoints kept open by batch or serve are reused, and left open */
+  for (i = 0; i < sel.nr; i++) {
+    d = &devs[nr_devs];
+    d->ep = cmd_find_open_ep(ctx, sel.ents[i].name);
+    if (!d->ep) {
+      d->ep = cmd_open_ep(ctx, sel.ents[i].name);
+      d->opened = d->ep != NULL;
+    }
+    if (!d->ep) {
+      fprintf(stderr, "cannot open '%s' endpoint, left out\n",
+              sel.ents[i].name);
+      continue;
+    }
+    payload_max = get_cxl_maxpayload(d->ep);
+    if (payload_max <= (int)sizeof(*page))
+      payload_max = CXL_EVENT_PAGE_MAX;
+    if (payload_max > page_max)
+      page_max = payload_max;
+    nr_devs++;
+  }
+  ep_table_free(&sel);
+  if (!nr_devs)
+    return EXIT_FAILURE;
+
+  /* one page and one handle per record it can hold, shared by all devices */
+  page = calloc(1, page_max);
+  handles = calloc((page_max - sizeof(*page)) / sizeof(page->records[0]) + 1,
+                   sizeof(*handles));
+  if (!page || !handles)
+    goto out;
+
+  for (i = 0; i < nr_devs; i++)
+    watch_setup(&devs[i]);
+
+  /* no SA_RESTART: signals must cut the sleep between polls short */
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, &old_int);
+  sigaction(SIGTERM, &sa, &old_term);
+  sig_set = true;
+
+  if (watch_params.duration)
+    deadline = cxlmi_timing_now() + watch_params.duration * 1000000000ULL;
+
+  while (!watch_stop) {
+    /* the device due first */
+    d = &devs[0];
+    for (i = 1; i < nr_devs; i++)
+      if (devs[i].next_ns < d->next_ns)
+        d = &devs[i];
+
+    if (deadline && d->next_ns >= deadline) {
+      watch_sleep_until(deadline);
+      break;
+    }
+    watch_sleep_until(d->next_ns);
+    if (watch_stop)
+      break;
+
+    if (watch_poll(d, page, handles))
+      failed++;
+  }
+
+out:
+  for (i = 0; i < nr_devs; i++)
+    watch_teardown(&devs[i]);
+  /* only once every policy is restored, so that ^C cannot cut that short */
+  if (sig_set) {
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+  }
+  fflush(stdout);
+
+  return !page || !handles || failed ? EXIT_FAILURE : 0;
+}
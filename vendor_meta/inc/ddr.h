@@ -8,6 +8,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdio.h>
 #define NUM_BANK 16
 #define NUM_CS 4
 
@@ -198,6 +199,27 @@ struct _ddr_addr_info_out {
   uint8_t ppr_state;
 } __attribute__((packed));
 
+/* Text output of a DDR stats run, one section each (cxl/src/ddr.c) */
+void display_pmon_stats(ddr_stats_data_t *disp_stats, uint32_t loop_count);
+void display_cs_pm_stats(ddr_stats_data_t *disp_stats, uint32_t loop_count);
+void display_cs_bank_pm_stats(ddr_stats_data_t *disp_stats,
+                              uint32_t loop_count);
+void display_mc_pm_stats(ddr_stats_data_t *disp_stats, uint32_t loop_count);
+
+/* The same sections a row at a time, for a run read back in chunks */
+void print_pmon_stats_hdr(FILE *f);
+void print_pmon_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                          uint32_t loop);
+void print_cs_pm_stats_hdr(FILE *f);
+void print_cs_pm_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                           uint32_t loop);
+void print_cs_bank_pm_stats_hdr(FILE *f);
+void print_cs_bank_pm_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                                uint32_t loop);
+void print_mc_pm_stats_hdr(FILE *f);
+void print_mc_pm_stats_row(FILE *f, const ddr_stats_data_t *disp_stats,
+                           uint32_t loop);
+
 #ifdef __cplusplus
 }
 #endif
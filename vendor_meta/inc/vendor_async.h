@@ -0,0 +1,71 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef __VENDOR_ASYNC_H__
+#define __VENDOR_ASYNC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libcxlmi.h>
+
+/*
+ * Asynchronous mailbox queue, one per endpoint.
+ *
+ * The mailbox itself is synchronous, so each queue owns a worker thread
+ * that issues the commands back to back. Callers submit from any thread
+ * and collect completions with cxlmi_async_poll(), which runs the
+ * completion callbacks in the polling thread. cxlmi_async_fd() returns a
+ * descriptor that turns readable when completions are pending, so a
+ * single thread can poll() the queues of many endpoints at once.
+ *
+ * While a queue exists, the endpoint must only be used through it.
+ */
+struct cxlmi_async_queue;
+
+/*
+ * rc is the mailbox result (0 on success). For raw opcodes, 'out' holds
+ * the response payload, 'out_sz' bytes of it.
+ */
+typedef void (*cxlmi_async_cb)(int rc, void *out, size_t out_sz, void *priv);
+
+/* Any synchronous cxlmi_cmd_* call wrapped to run on the worker */
+typedef int (*cxlmi_async_fn)(struct cxlmi_endpoint *ep, void *arg);
+
+struct cxlmi_async_queue *cxlmi_async_queue_new(struct cxlmi_endpoint *ep);
+
+/* Waits for outstanding commands, drops their callbacks, frees the queue */
+void cxlmi_async_queue_free(struct cxlmi_async_queue *q);
+
+/*
+ * Queue a raw vendor opcode. 'in' is copied at submit time. 'out' must
+ * stay valid until the callback has run. Returns 0 or a negative errno.
+ */
+int cxlmi_async_submit(struct cxlmi_async_queue *q, uint8_t cmdset,
+                       uint8_t opcode, const void *in, size_t in_sz, void *out,
+                       size_t out_sz, cxlmi_async_cb cb, void *priv);
+
+/* Queue fn(ep, arg); the callback gets fn's return code and 'arg' as out */
+int cxlmi_async_submit_fn(struct cxlmi_async_queue *q, cxlmi_async_fn fn,
+                          void *arg, cxlmi_async_cb cb, void *priv);
+
+/*
+ * Run callbacks for completed commands. Waits up to timeout_ms for at
+ * least one completion (-1 blocks, 0 does not wait). Returns the number
+ * of callbacks run or a negative errno.
+ */
+int cxlmi_async_poll(struct cxlmi_async_queue *q, int timeout_ms);
+
+/* Submitted commands whose callback has not run yet */
+int cxlmi_async_pending(struct cxlmi_async_queue *q);
+
+int cxlmi_async_fd(struct cxlmi_async_queue *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VENDOR_ASYNC_H__ */
@@ -0,0 +1,48 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef __VENDOR_CACHE_H__
+#define __VENDOR_CACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libcxlmi.h>
+
+/*
+ * On-disk cache for responses that only change across a reboot or a
+ * firmware update (identify, device info, dimm slot info, spd, fw info).
+ *
+ * Entries are keyed by endpoint, device serial, opcode and request payload,
+ * one file each under <dir>/<devname>-<serial>/. Keying on the serial means
+ * a swapped device never sees the previous one's data, and the default
+ * directory is on tmpfs so a host reboot empties it.
+ *
+ *   CXL_CACHE_DIR=<path>   cache directory, default CXLMI_CACHE_DIR_DEFAULT
+ *   CXL_CACHE_TTL=<sec>    default lifetime of an entry, 0 (the default)
+ *                          disables the cache
+ */
+#define CXLMI_CACHE_DIR_DEFAULT "/run/cxl/cache"
+
+/* ttl_sec < 0 goes back to CXL_CACHE_TTL, 0 disables load and store */
+void cxlmi_cache_set_ttl(int ttl_sec);
+unsigned int cxlmi_cache_ttl(void);
+
+/* 0 and out filled in on a hit, -ENOENT on a miss or a stale entry */
+int cxlmi_cache_load(struct cxlmi_endpoint *ep, uint16_t opcode,
+                     const void *in, size_t in_sz, void *out, size_t out_sz);
+int cxlmi_cache_store(struct cxlmi_endpoint *ep, uint16_t opcode,
+                      const void *in, size_t in_sz, const void *out,
+                      size_t out_sz);
+
+/* Drop every entry of ep, whatever the TTL; for commands that change them */
+int cxlmi_cache_invalidate(struct cxlmi_endpoint *ep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VENDOR_CACHE_H__ */
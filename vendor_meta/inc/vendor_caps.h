@@ -0,0 +1,42 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef __VENDOR_CAPS_H__
+#define __VENDOR_CAPS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libcxlmi.h>
+
+/*
+ * Opcodes a device supports, from its Command Effects Log (CEL). The CEL
+ * is read once per endpoint and kept as a 64 Kbit opcode bitmap, stored in
+ * the response cache (vendor_cache.h) next to identify, so it survives
+ * across invocations for as long as the cache entries do.
+ * send_cmd_cci_timed() consults it before every vendor command: an opcode
+ * the CEL does not list fails with CXLMI_RET_UNSUPPORTED without a mailbox
+ * round trip.
+ *
+ *   CXL_CAPS=1     always check, reading the CEL in every process
+ *   CXL_CAPS=0     never check
+ *   (unset)        check while the response cache is enabled
+ *
+ * A device with no CEL, or a CEL that lists no vendor opcode at all, is
+ * assumed to support everything.
+ */
+
+/* false only when the CEL of ep is known and does not list opcode */
+bool cxlmi_caps_supported(struct cxlmi_endpoint *ep, uint16_t opcode);
+
+/* Drop the bitmap kept for ep; the next check reads the CEL again */
+void cxlmi_caps_forget(struct cxlmi_endpoint *ep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VENDOR_CAPS_H__ */
@@ -10,6 +10,8 @@ extern "C" {
 #include <libcxlmi.h>
 #include <vendor_types.h>
 
+struct cxlmi_cci_msg;
+
 int cxlmi_cmd_get_os_fw_info(struct cxlmi_endpoint *ep,
                              struct cxlmi_tunnel_info *ti,
                              struct cxlmi_cmd_get_fw_info *out);
@@ -21,6 +23,60 @@ int cxlmi_cmd_vendor_transfer_fw(struct cxlmi_endpoint *ep,
                                  struct cxlmi_cmd_transfer_fw *in,
                                  uint32_t opcode);
 
+/* As above, with data_sz bytes of in->data instead of one 128 byte block */
+int cxlmi_cmd_vendor_transfer_fw_len(struct cxlmi_endpoint *ep,
+                                     struct cxlmi_tunnel_info *ti,
+                                     struct cxlmi_cmd_transfer_fw *in,
+                                     size_t data_sz, uint32_t opcode);
+
+/*
+ * As above, sending req as it is: its payload is a struct
+ * cxlmi_cmd_transfer_fw with action and slot set and data_sz bytes of image
+ * filled in place, so that one message can carry every block of a transfer.
+ */
+int cxlmi_cmd_vendor_transfer_fw_msg(struct cxlmi_endpoint *ep,
+                                     struct cxlmi_tunnel_info *ti,
+                                     struct cxlmi_cci_msg *req,
+                                     uint32_t offset, size_t data_sz,
+                                     uint32_t opcode);
+
+/* Pioneer vendor opcode for activating an hbo/OS image transferred above */
+int cxlmi_cmd_vendor_activate_fw(struct cxlmi_endpoint *ep,
+                                 struct cxlmi_tunnel_info *ti,
+                                 struct cxlmi_cmd_activate_fw *in);
+
+/* Mailbox payload_max of ep from sysfs, 0 when it cannot be read */
+int get_cxl_maxpayload(struct cxlmi_endpoint *ep);
+
+/* Device serial number from sysfs; quiet, unlike get_cxl_maxpayload() */
+int get_cxl_serial(struct cxlmi_endpoint *ep, uint64_t *serial);
+
+/* Write all of buf, whatever the short writes; 0 or -errno */
+int cxlmi_write_full(int fd, const void *buf, size_t len);
+
+/*
+ * Read length bytes of log uuid from offset 0, one Get Log per payload_max
+ * sized chunk. Each chunk lands at its offset in buf when given, and is
+ * appended to fd when >= 0 as soon as it arrives; without buf a single
+ * chunk is all the memory used, whatever the size of the log.
+ */
+int cxlmi_get_log_paged(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
+                        const uint8_t *uuid, uint32_t length, void *buf,
+                        int fd);
+
+/* Size of log uuid from Get Supported Logs, 0 when it is not listed */
+int cxlmi_get_log_size(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
+                       const uint8_t *uuid, uint32_t *size);
+
+/* Each chunk of a paged Get Log as it arrives; non zero stops the read */
+typedef int (*cxlmi_log_sink)(const void *chunk, uint32_t len, void *priv);
+
+/* As cxlmi_get_log_paged(), handing the chunks to sink instead of an fd */
+int cxlmi_get_log_stream(struct cxlmi_endpoint *ep,
+                         struct cxlmi_tunnel_info *ti, const uint8_t *uuid,
+                         uint32_t length, void *buf, cxlmi_log_sink sink,
+                         void *priv);
+
 int cxlmi_cmd_get_hbo_status(struct cxlmi_endpoint *ep,
                              struct cxlmi_tunnel_info *ti,
                              struct cxlmi_cmd_hbo_status_fields *ret);
@@ -261,6 +317,12 @@ int cxlmi_cmd_ddr_init_err_info_get(
     struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
     struct cxlmi_cmd_ddr_init_err_info_get *ret);
 
+/* send_cmd_cci() plus a mailbox latency sample keyed by opcode */
+int send_cmd_cci_timed(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
+                       struct cxlmi_cci_msg *req_msg, size_t req_msg_sz,
+                       struct cxlmi_cci_msg *rsp_msg, size_t rsp_msg_sz,
+                       size_t rsp_msg_sz_min);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,25 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef __VENDOR_CRC_H__
+#define __VENDOR_CRC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * CRC32C (Castagnoli), as printed by `crc32c` style tools: start with 0 and
+ * pass the previous return value to continue over more data. Uses the
+ * SSE4.2 / ARMv8 crc32c instructions when the CPU has them, a slicing-by-8
+ * table otherwise, or when CXL_CRC32C=sw is set in the environment.
+ */
+uint32_t cxlmi_crc32c(uint32_t crc, const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VENDOR_CRC_H__ */
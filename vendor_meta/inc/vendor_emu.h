@@ -0,0 +1,64 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef __VENDOR_EMU_H__
+#define __VENDOR_EMU_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libcxlmi.h>
+
+/*
+ * Software device emulator for the vendor mailbox opcodes.
+ *
+ * Enabled through the environment, so no flag has to be threaded through
+ * the commands:
+ *
+ *   CXL_EMU=<n> | <mem0,mem1,..>  emulate n devices (mem0..mem<n-1>) or
+ *                                 the listed ones, instead of sysfs
+ *   CXL_EMU_LATENCY=<lat>[,<opcode>=<lat>..]
+ *                                 mailbox latency, default and per opcode,
+ *                                 opcode as 0xCCOO, lat as <n>[ns|us|ms|s]
+ *                                 (bare numbers are us)
+ *   CXL_EMU_BG=<lat>              how long background operations (eye,
+ *                                 margin, stats, scrub, fw transfer) run
+ *   CXL_EMU_PAYLOAD_MAX=<bytes>   reported payload_max
+ *
+ * Device state lives in a shared mapping, so workers forked by --jobs or
+ * serve all see the same devices. Only vendor opcodes are emulated; the
+ * spec commands issued inside libcxlmi still need real hardware.
+ */
+#define CXLMI_EMU_MAX_DEVS 64
+
+/* Parse the environment and set up the shared state; call before forking */
+int cxlmi_emu_init(void);
+
+bool cxlmi_emu_enabled(void);
+int cxlmi_emu_count(void);
+const char *cxlmi_emu_devname(int i);
+
+/* Emulated endpoints are not linked into ctx, track them here instead */
+struct cxlmi_endpoint *cxlmi_emu_open(struct cxlmi_ctx *ctx,
+                                      const char *devname);
+void cxlmi_emu_close(struct cxlmi_endpoint *ep);
+struct cxlmi_endpoint *cxlmi_emu_find(const char *devname);
+bool cxlmi_emu_is_emulated(struct cxlmi_endpoint *ep);
+
+int cxlmi_emu_payload_max(void);
+uint64_t cxlmi_emu_serial(struct cxlmi_endpoint *ep);
+
+/* send_cmd_cci() stand-in: 0 or the CXLMI_RET_* the device would return */
+struct cxlmi_cci_msg;
+int cxlmi_emu_send(struct cxlmi_endpoint *ep, struct cxlmi_cci_msg *req,
+                   size_t req_sz, struct cxlmi_cci_msg *rsp, size_t rsp_sz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VENDOR_EMU_H__ */
@@ -0,0 +1,65 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef __VENDOR_POLL_H__
+#define __VENDOR_POLL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libcxlmi.h>
+#include <vendor_types.h>
+
+/*
+ * Exponential backoff with jitter and a deadline, for retrying busy
+ * mailbox commands and polling background operations. Every wait sleeps
+ * a random delay in [cur/2, cur], then doubles cur up to max_ms; no wait
+ * runs past the deadline.
+ */
+struct cxlmi_backoff {
+  uint64_t deadline_ns;
+  uint32_t min_ms;
+  uint32_t max_ms;
+  uint32_t cur_ms;
+  unsigned int seed;
+};
+
+void cxlmi_backoff_init(struct cxlmi_backoff *b, uint32_t min_ms,
+                        uint32_t max_ms, uint32_t timeout_ms);
+
+/* Progress was made, start again from min_ms (the deadline stays) */
+void cxlmi_backoff_reset(struct cxlmi_backoff *b);
+
+/* 0 after sleeping, -ETIMEDOUT once the deadline has passed */
+int cxlmi_backoff_wait(struct cxlmi_backoff *b);
+
+/*
+ * Worth retrying: busy, retry required, or a transport error that may not
+ * recur (-EAGAIN, -ETIMEDOUT, -EIO). Any other error is final.
+ */
+bool cxlmi_ret_transient(int rc);
+
+/*
+ * Wait for the background operation reported by OEM_HBO_STATUS to finish.
+ * Returns 0 when nothing is running, the operation's return code if it
+ * failed, -ETIMEDOUT, or the status command's own non transient error.
+ * status, if given, holds the last decoded status.
+ */
+int cxlmi_hbo_wait(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
+                   uint32_t timeout_ms,
+                   struct cxlmi_cmd_hbo_status_fields *status);
+
+/* As cxlmi_hbo_wait(), adding the status commands sent to *polls */
+int cxlmi_hbo_wait_count(struct cxlmi_endpoint *ep,
+                         struct cxlmi_tunnel_info *ti, uint32_t timeout_ms,
+                         struct cxlmi_cmd_hbo_status_fields *status,
+                         uint32_t *polls);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VENDOR_POLL_H__ */
@@ -0,0 +1,49 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+#ifndef __VENDOR_TIMING_H__
+#define __VENDOR_TIMING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Always-on latency counters. Every sample lands in a log2(ns) histogram
+ * keyed by phase, opcode and command name. The table lives in a shared
+ * mapping, so samples taken in forked workers (--jobs, serve) are seen by
+ * the parent as well.
+ */
+enum cxlmi_timing_phase {
+  CXLMI_TIMING_CMD,  /* whole command, as dispatched from cxl_commands[] */
+  CXLMI_TIMING_OPEN, /* cxlmi_open() of one endpoint */
+  CXLMI_TIMING_MBOX, /* one send_cmd_cci() round trip */
+  CXLMI_TIMING_HOST, /* per endpoint action minus its mailbox time */
+  CXLMI_TIMING_NR,
+};
+
+#define CXLMI_TIMING_BUCKETS 40 /* 1ns .. ~9 minutes */
+#define CXLMI_TIMING_NAME_MAX 32
+
+/* Set up the shared table; call before forking anything */
+int cxlmi_timing_init(void);
+
+uint64_t cxlmi_timing_now(void);
+
+/* opcode is (cmdset << 8 | cmd) for mailbox samples, 0 otherwise */
+void cxlmi_timing_record(enum cxlmi_timing_phase phase, uint16_t opcode,
+                         const char *name, uint64_t ns);
+
+/* Mailbox time spent by this process so far, for HOST accounting */
+uint64_t cxlmi_timing_mbox_ns(void);
+
+void cxlmi_timing_dump(FILE *fp);
+void cxlmi_timing_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VENDOR_TIMING_H__ */
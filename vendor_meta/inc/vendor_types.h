@@ -97,6 +97,16 @@ enum {
 #define DDR_INIT_ERR_INFO_GET 0x36
 };
 
+/* Transfer FW/OS actions */
+#define INITIATE_TRANSFER 1
+#define CONTINUE_TRANSFER 2
+#define END_TRANSFER 3
+#define ABORT_TRANSFER 4
+
+/* Activate FW actions */
+#define ACTIVATE_ONLINE 0
+#define ACTIVATE_ON_RESET 1
+
 /* Structure for HBO status */
 struct cxlmi_cmd_hbo_status_out {
   __le64 bo_status;
@@ -0,0 +1,323 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+/* std includes */
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include <vendor_async.h>
+#include <vendor_commands.h>
+
+struct cxlmi_async_req {
+  struct cxlmi_async_req *next;
+  cxlmi_async_fn fn;
+  void *fn_arg;
+  cxlmi_async_cb cb;
+  void *priv;
+  int rc;
+
+  /* raw opcode requests only */
+  uint8_t cmdset;
+  uint8_t opcode;
+  void *in;
+  size_t in_sz;
+  void *out;
+  size_t out_sz;
+};
+
+struct cxlmi_async_list {
+  struct cxlmi_async_req *head;
+  struct cxlmi_async_req *tail;
+};
+
+struct cxlmi_async_queue {
+  struct cxlmi_endpoint *ep;
+  pthread_t worker;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct cxlmi_async_list submitted;
+  struct cxlmi_async_list done;
+  int pending;
+  int efd;
+  bool stop;
+};
+
+static void async_list_add(struct cxlmi_async_list *l,
+                           struct cxlmi_async_req *r) {
+  r->next = NULL;
+  if (l->tail)
+    l->tail->next = r;
+  else
+    l->head = r;
+  l->tail = r;
+}
+
+static void async_req_free(struct cxlmi_async_req *r) {
+  free(r->in);
+  free(r);
+}
+
+static int async_raw_cmd(struct cxlmi_endpoint *ep, void *arg) {
+  struct cxlmi_async_req *r = arg;
+  _cleanup_free_ struct cxlmi_cci_msg *req = NULL;
+  _cleanup_free_ struct cxlmi_cci_msg *rsp = NULL;
+  size_t req_sz = sizeof(*req) + r->in_sz;
+  size_t rsp_sz = sizeof(*rsp) + r->out_sz;
+  int rc;
+
+  req = calloc(1, req_sz);
+  rsp = calloc(1, rsp_sz);
+  if (!req || !rsp)
+    return -ENOMEM;
+
+  arm_cci_request(ep, req, r->in_sz, r->cmdset, r->opcode);
+  if (r->in_sz)
+    memcpy(req->payload, r->in, r->in_sz);
+
+  /* variable sized responses are fine, whatever fits lands in out */
+  rc = send_cmd_cci_timed(ep, NULL, req, req_sz, rsp, rsp_sz, sizeof(*rsp));
+  if (rc)
+    return rc;
+
+  if (r->out_sz)
+    memcpy(r->out, rsp->payload, r->out_sz);
+
+  return 0;
+}
+
+static void *async_worker(void *arg) {
+  struct cxlmi_async_queue *q = arg;
+  struct cxlmi_async_req *r;
+  uint64_t one = 1;
+
+  pthread_mutex_lock(&q->lock);
+  for (;;) {
+    while (!q->submitted.head && !q->stop)
+      pthread_cond_wait(&q->cond, &q->lock);
+
+    /* stop only once everything submitted has been issued */
+    r = q->submitted.head;
+    if (!r)
+      break;
+    q->submitted.head = r->next;
+    if (!q->submitted.head)
+      q->submitted.tail = NULL;
+
+    pthread_mutex_unlock(&q->lock);
+    r->rc = r->fn(q->ep, r->fn_arg);
+    pthread_mutex_lock(&q->lock);
+
+    async_list_add(&q->done, r);
+    if (write(q->efd, &one, sizeof(one)) < 0) {
+      /* counter saturated, the fd is readable anyway */
+    }
+  }
+  pthread_mutex_unlock(&q->lock);
+
+  return NULL;
+}
+
+CXLMI_EXPORT struct cxlmi_async_queue *
+cxlmi_async_queue_new(struct cxlmi_endpoint *ep) {
+  struct cxlmi_async_queue *q;
+
+  if (!ep)
+    return NULL;
+
+  q = calloc(1, sizeof(*q));
+  if (!q)
+    return NULL;
+
+  q->ep = ep;
+  q->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (q->efd < 0)
+    goto err_free;
+
+  pthread_mutex_init(&q->lock, NULL);
+  pthread_cond_init(&q->cond, NULL);
+
+  if (pthread_create(&q->worker, NULL, async_worker, q))
+    goto err_close;
+
+  return q;
+
+err_close:
+  pthread_cond_destroy(&q->cond);
+  pthread_mutex_destroy(&q->lock);
+  close(q->efd);
+err_free:
+  free(q);
+  return NULL;
+}
+
+CXLMI_EXPORT void cxlmi_async_queue_free(struct cxlmi_async_queue *q) {
+  struct cxlmi_async_req *r, *next;
+
+  if (!q)
+    return;
+
+  pthread_mutex_lock(&q->lock);
+  q->stop = true;
+  pthread_cond_signal(&q->cond);
+  pthread_mutex_unlock(&q->lock);
+  pthread_join(q->worker, NULL);
+
+  for (r = q->done.head; r; r = next) {
+    next = r->next;
+    async_req_free(r);
+  }
+
+  pthread_cond_destroy(&q->cond);
+  pthread_mutex_destroy(&q->lock);
+  close(q->efd);
+  free(q);
+}
+
+static int async_queue_req(struct cxlmi_async_queue *q,
+                           struct cxlmi_async_req *r) {
+  pthread_mutex_lock(&q->lock);
+  if (q->stop) {
+    pthread_mutex_unlock(&q->lock);
+    async_req_free(r);
+    return -ESHUTDOWN;
+  }
+  async_list_add(&q->submitted, r);
+  q->pending++;
+  pthread_cond_signal(&q->cond);
+  pthread_mutex_unlock(&q->lock);
+
+  return 0;
+}
+
+CXLMI_EXPORT int cxlmi_async_submit(struct cxlmi_async_queue *q,
+                                    uint8_t cmdset, uint8_t opcode,
+                                    const void *in, size_t in_sz, void *out,
+                                    size_t out_sz, cxlmi_async_cb cb,
+                                    void *priv) {
+  struct cxlmi_async_req *r;
+
+  if (!q || (in_sz && !in) || (out_sz && !out))
+    return -EINVAL;
+
+  r = calloc(1, sizeof(*r));
+  if (!r)
+    return -ENOMEM;
+
+  if (in_sz) {
+    r->in = malloc(in_sz);
+    if (!r->in) {
+      free(r);
+      return -ENOMEM;
+    }
+    memcpy(r->in, in, in_sz);
+  }
+
+  r->fn = async_raw_cmd;
+  r->fn_arg = r;
+  r->cb = cb;
+  r->priv = priv;
+  r->cmdset = cmdset;
+  r->opcode = opcode;
+  r->in_sz = in_sz;
+  r->out = out;
+  r->out_sz = out_sz;
+
+  return async_queue_req(q, r);
+}
+
+CXLMI_EXPORT int cxlmi_async_submit_fn(struct cxlmi_async_queue *q,
+                                       cxlmi_async_fn fn, void *arg,
+                                       cxlmi_async_cb cb, void *priv) {
+  struct cxlmi_async_req *r;
+
+  if (!q || !fn)
+    return -EINVAL;
+
+  r = calloc(1, sizeof(*r));
+  if (!r)
+    return -ENOMEM;
+
+  r->fn = fn;
+  r->fn_arg = arg;
+  r->cb = cb;
+  r->priv = priv;
+
+  return async_queue_req(q, r);
+}
+
+CXLMI_EXPORT int cxlmi_async_poll(struct cxlmi_async_queue *q,
+                                  int timeout_ms) {
+  struct cxlmi_async_req *r, *next;
+  struct pollfd pfd;
+  uint64_t cnt;
+  int n = 0;
+
+  if (!q)
+    return -EINVAL;
+
+  pthread_mutex_lock(&q->lock);
+  if (!q->done.head && timeout_ms && q->pending) {
+    pthread_mutex_unlock(&q->lock);
+
+    pfd.fd = q->efd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, timeout_ms) < 0)
+      return -errno;
+
+    pthread_mutex_lock(&q->lock);
+  }
+
+  if (read(q->efd, &cnt, sizeof(cnt)) < 0) {
+    /* EAGAIN: nothing new since the last poll */
+  }
+
+  r = q->done.head;
+  q->done.head = q->done.tail = NULL;
+  pthread_mutex_unlock(&q->lock);
+
+  /* callbacks run unlocked, they may submit follow-up commands */
+  for (; r; r = next) {
+    next = r->next;
+    if (r->cb) {
+      if (r->fn == async_raw_cmd)
+        r->cb(r->rc, r->out, r->out_sz, r->priv);
+      else
+        r->cb(r->rc, r->fn_arg, 0, r->priv);
+    }
+    async_req_free(r);
+    n++;
+  }
+
+  pthread_mutex_lock(&q->lock);
+  q->pending -= n;
+  pthread_mutex_unlock(&q->lock);
+
+  return n;
+}
+
+CXLMI_EXPORT int cxlmi_async_pending(struct cxlmi_async_queue *q) {
+  int pending;
+
+  if (!q)
+    return -EINVAL;
+
+  pthread_mutex_lock(&q->lock);
+  pending = q->pending;
+  pthread_mutex_unlock(&q->lock);
+
+  return pending;
+}
+
+CXLMI_EXPORT int cxlmi_async_fd(struct cxlmi_async_queue *q) {
+  return q ? q->efd : -EINVAL;
+}
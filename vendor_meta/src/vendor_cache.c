@@ -0,0 +1,247 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+/* std includes */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include <vendor_cache.h>
+#include <vendor_caps.h>
+#include <vendor_commands.h>
+
+#define CACHE_MAGIC 0x43584c43 /* "CXLC" */
+#define CACHE_VERSION 1
+
+struct cache_hdr {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t opcode;
+  uint32_t in_hash;
+  uint32_t size;
+  int64_t stamp; /* CLOCK_REALTIME seconds, comparable across processes */
+};
+
+static int cache_ttl = -1;
+
+static unsigned int cache_env_ttl(void) {
+  const char *s = getenv("CXL_CACHE_TTL");
+  long v;
+
+  if (!s || !*s)
+    return 0;
+  v = strtol(s, NULL, 0);
+  return v > 0 ? v : 0;
+}
+
+CXLMI_EXPORT void cxlmi_cache_set_ttl(int ttl_sec) { cache_ttl = ttl_sec; }
+
+CXLMI_EXPORT unsigned int cxlmi_cache_ttl(void) {
+  return cache_ttl < 0 ? cache_env_ttl() : (unsigned int)cache_ttl;
+}
+
+static const char *cache_dir(void) {
+  const char *s = getenv("CXL_CACHE_DIR");
+
+  return s && *s ? s : CXLMI_CACHE_DIR_DEFAULT;
+}
+
+static uint32_t cache_hash(const void *in, size_t in_sz) {
+  const unsigned char *p = in;
+  uint32_t h = 2166136261u;
+
+  while (in_sz--)
+    h = (h ^ *p++) * 16777619u;
+
+  return h;
+}
+
+static int cache_path(struct cxlmi_endpoint *ep, uint16_t opcode,
+                      uint32_t in_hash, char *dir, size_t dir_sz, char *file,
+                      size_t file_sz) {
+  uint64_t serial;
+  int rc;
+
+  if (!ep || !ep->devname || strchr(ep->devname, '/'))
+    return -EINVAL;
+
+  /* no serial just means no caching */
+  rc = get_cxl_serial(ep, &serial);
+  if (rc)
+    return rc;
+
+  snprintf(dir, dir_sz, "%s/%s-%016llx", cache_dir(), ep->devname,
+           (unsigned long long)serial);
+  snprintf(file, file_sz, "%s/%04x-%08x", dir, opcode, in_hash);
+  return 0;
+}
+
+static int64_t cache_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec;
+}
+
+CXLMI_EXPORT int cxlmi_cache_load(struct cxlmi_endpoint *ep, uint16_t opcode,
+                                  const void *in, size_t in_sz, void *out,
+                                  size_t out_sz) {
+  char dir[PATH_MAX], file[PATH_MAX];
+  unsigned int ttl = cxlmi_cache_ttl();
+  uint32_t in_hash = cache_hash(in, in_sz);
+  struct cache_hdr hdr;
+  int64_t now;
+  int fd, rc = -ENOENT;
+
+  if (!ttl || !out || !out_sz)
+    return -ENOENT;
+  if (cache_path(ep, opcode, in_hash, dir, sizeof(dir), file, sizeof(file)))
+    return -ENOENT;
+
+  fd = open(file, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -ENOENT;
+
+  if (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+    goto out;
+
+  now = cache_now();
+  if (hdr.magic != CACHE_MAGIC || hdr.version != CACHE_VERSION ||
+      hdr.opcode != opcode || hdr.in_hash != in_hash || hdr.size != out_sz)
+    goto out;
+  /* a clock that went backwards makes the entry stale too */
+  if (hdr.stamp > now || now - hdr.stamp >= (int64_t)ttl)
+    goto out;
+
+  if (read(fd, out, out_sz) == (ssize_t)out_sz)
+    rc = 0;
+out:
+  close(fd);
+  return rc;
+}
+
+static int cache_mkdir(const char *dir) {
+  char tmp[PATH_MAX], *p;
+
+  snprintf(tmp, sizeof(tmp), "%s", dir);
+  for (p = tmp + 1; *p; p++) {
+    if (*p != '/')
+      continue;
+    *p = 0;
+    if (mkdir(tmp, 0700) && errno != EEXIST)
+      return -errno;
+    *p = '/';
+  }
+  if (mkdir(tmp, 0700) && errno != EEXIST)
+    return -errno;
+
+  return 0;
+}
+
+CXLMI_EXPORT int cxlmi_cache_store(struct cxlmi_endpoint *ep, uint16_t opcode,
+                                   const void *in, size_t in_sz,
+                                   const void *out, size_t out_sz) {
+  char dir[PATH_MAX], file[PATH_MAX], tmp[PATH_MAX + 16];
+  struct cache_hdr hdr = {
+      .magic = CACHE_MAGIC,
+      .version = CACHE_VERSION,
+      .opcode = opcode,
+      .in_hash = cache_hash(in, in_sz),
+      .size = out_sz,
+      .stamp = cache_now(),
+  };
+  int fd, rc;
+
+  if (!cxlmi_cache_ttl() || !out || !out_sz)
+    return 0;
+
+  rc = cache_path(ep, opcode, hdr.in_hash, dir, sizeof(dir), file,
+                  sizeof(file));
+  if (rc)
+    return rc;
+  rc = cache_mkdir(dir);
+  if (rc)
+    return rc;
+
+  /* write aside and rename, so --jobs workers never read a torn entry */
+  snprintf(tmp, sizeof(tmp), "%s.%d", file, getpid());
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return -errno;
+
+  if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+      write(fd, out, out_sz) != (ssize_t)out_sz)
+    rc = -EIO;
+  close(fd);
+
+  if (!rc && rename(tmp, file))
+    rc = -errno;
+  if (rc)
+    unlink(tmp);
+
+  return rc;
+}
+
+static void cache_rmdir(int dfd, const char *name) {
+  struct dirent *de;
+  DIR *d;
+  int fd;
+
+  fd = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  d = fdopendir(fd);
+  if (!d) {
+    close(fd);
+    return;
+  }
+
+  while ((de = readdir(d))) {
+    if (strcmp(de->d_name, ".") && strcmp(de->d_name, ".."))
+      unlinkat(fd, de->d_name, 0);
+  }
+  closedir(d);
+  unlinkat(dfd, name, AT_REMOVEDIR);
+}
+
+/*
+ * Drop every <devname>-<serial> directory, not only the current serial's:
+ * the command invalidating may be the one that made the serial unreadable.
+ */
+CXLMI_EXPORT int cxlmi_cache_invalidate(struct cxlmi_endpoint *ep) {
+  struct dirent *de;
+  size_t len;
+  DIR *d;
+
+  if (!ep || !ep->devname)
+    return -EINVAL;
+
+  /* the firmware changed, and its opcodes with it */
+  cxlmi_caps_forget(ep);
+
+  d = opendir(cache_dir());
+  if (!d)
+    return errno == ENOENT ? 0 : -errno;
+
+  len = strlen(ep->devname);
+  while ((de = readdir(d))) {
+    if (strncmp(de->d_name, ep->devname, len) == 0 &&
+        de->d_name[len] == '-')
+      cache_rmdir(dirfd(d), de->d_name);
+  }
+  closedir(d);
+
+  return 0;
+}
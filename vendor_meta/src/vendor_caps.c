@@ -0,0 +1,146 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+/* std includes */
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include <vendor_cache.h>
+#include <vendor_caps.h>
+#include <vendor_commands.h>
+#include <vendor_emu.h>
+
+#define CAPS_BITMAP_SZ (0x10000 / 8)
+/* first opcode of the vendor specific range */
+#define CAPS_VENDOR_OPCODE 0xc000
+/* cache key: Get Log, with the CEL uuid as the request */
+#define CAPS_CACHE_OPCODE (LOGS << 8 | 0x01)
+
+static const uint8_t cel_uuid[0x10] = {0x0d, 0xa9, 0xc0, 0xb5, 0xbf, 0x41,
+                                       0x4b, 0x78, 0x8f, 0x79, 0x96, 0xb1,
+                                       0x62, 0x3b, 0x3f, 0x17};
+
+struct caps_ent {
+  struct cxlmi_endpoint *ep;
+  bool from_cel; /* false: no usable CEL, everything goes through */
+  uint8_t bits[CAPS_BITMAP_SZ];
+};
+
+/* async queues send from their own threads, one per endpoint */
+static pthread_mutex_t caps_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct caps_ent **caps;
+static int nr_caps;
+
+static bool caps_enabled(void) {
+  const char *s = getenv("CXL_CAPS");
+
+  if (s && *s)
+    return strcmp(s, "0") != 0;
+  return cxlmi_cache_ttl() > 0;
+}
+
+/* 0 and bits filled in from the CEL, < 0 when there is no usable CEL */
+static int caps_read_cel(struct cxlmi_endpoint *ep, uint8_t *bits) {
+  _cleanup_free_ struct cxlmi_cmd_get_log_cel_rsp *cel = NULL;
+  uint32_t size, nr;
+  bool vendor = false;
+  uint16_t op;
+  int i, rc;
+
+  rc = cxlmi_get_log_size(ep, NULL, cel_uuid, &size);
+  if (rc)
+    return rc < 0 ? rc : -EIO;
+  nr = size / sizeof(*cel);
+  if (!nr)
+    return -ENOENT;
+
+  cel = calloc(nr, sizeof(*cel));
+  if (!cel)
+    return -ENOMEM;
+  rc = cxlmi_get_log_paged(ep, NULL, cel_uuid, nr * sizeof(*cel), cel, -1);
+  if (rc)
+    return rc < 0 ? rc : -EIO;
+
+  memset(bits, 0, CAPS_BITMAP_SZ);
+  for (i = 0; i < nr; i++) {
+    op = cel[i].opcode;
+    bits[op / 8] |= 1 << (op % 8);
+    vendor |= op >= CAPS_VENDOR_OPCODE;
+  }
+
+  /* firmware that leaves its own vendor commands out is not to be trusted */
+  return vendor ? 0 : -ENODATA;
+}
+
+static struct caps_ent *caps_load(struct cxlmi_endpoint *ep) {
+  struct caps_ent *ent, **tmp;
+
+  ent = calloc(1, sizeof(*ent));
+  if (!ent)
+    return NULL;
+  tmp = realloc(caps, (nr_caps + 1) * sizeof(*caps));
+  if (!tmp) {
+    free(ent);
+    return NULL;
+  }
+  caps = tmp;
+  caps[nr_caps++] = ent;
+  ent->ep = ep;
+
+  if (!cxlmi_cache_load(ep, CAPS_CACHE_OPCODE, cel_uuid, sizeof(cel_uuid),
+                        ent->bits, sizeof(ent->bits))) {
+    ent->from_cel = true;
+    return ent;
+  }
+
+  ent->from_cel = !caps_read_cel(ep, ent->bits);
+  if (ent->from_cel)
+    cxlmi_cache_store(ep, CAPS_CACHE_OPCODE, cel_uuid, sizeof(cel_uuid),
+                      ent->bits, sizeof(ent->bits));
+  return ent;
+}
+
+CXLMI_EXPORT bool cxlmi_caps_supported(struct cxlmi_endpoint *ep,
+                                       uint16_t opcode) {
+  struct caps_ent *ent = NULL;
+  bool supported = true;
+  int i;
+
+  /* the emulator has no CEL and answers for what it emulates */
+  if (!ep || cxlmi_emu_is_emulated(ep) || !caps_enabled())
+    return true;
+
+  pthread_mutex_lock(&caps_lock);
+  for (i = 0; i < nr_caps && !ent; i++) {
+    if (caps[i]->ep == ep)
+      ent = caps[i];
+  }
+  if (!ent)
+    ent = caps_load(ep);
+  if (ent && ent->from_cel)
+    supported = ent->bits[opcode / 8] >> (opcode % 8) & 1;
+  pthread_mutex_unlock(&caps_lock);
+
+  return supported;
+}
+
+CXLMI_EXPORT void cxlmi_caps_forget(struct cxlmi_endpoint *ep) {
+  int i;
+
+  pthread_mutex_lock(&caps_lock);
+  for (i = 0; i < nr_caps; i++) {
+    if (caps[i]->ep != ep)
+      continue;
+    free(caps[i]);
+    caps[i] = caps[--nr_caps];
+    break;
+  }
+  pthread_mutex_unlock(&caps_lock);
+}
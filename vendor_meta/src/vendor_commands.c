@@ -3,7 +3,9 @@
 /* std includes */
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 /* libcxlmi includes */
@@ -13,11 +15,16 @@
 #include <libcxlmi.h>
 
 /* vendor includes */
+#include <vendor_caps.h>
 #include <vendor_commands.h>
+#include <vendor_emu.h>
+#include <vendor_timing.h>
 #include <vendor_types.h>
 
 /* Helper function */
 #define SYSFS_ATTR_SIZE 1024
+/* Get Log chunk when payload_max is unknown: the smallest mailbox payload */
+#define LOG_CHUNK_MIN 256
 
 int read_sysfs_attr(char *path, char *buf) {
 
@@ -59,6 +66,8 @@ int get_cxl_maxpayload(struct cxlmi_endpoint *ep) {
   if (!ep) {
     return -ENODEV;
   }
+  if (cxlmi_emu_is_emulated(ep))
+    return cxlmi_emu_payload_max();
   memset(path, 0x0, MAX_PATH_LEN);
 
   sprintf(path, "/sys/bus/cxl/devices/%s/payload_max", ep->devname);
@@ -72,6 +81,156 @@ int get_cxl_maxpayload(struct cxlmi_endpoint *ep) {
   return (max_payload < 0 ? 0 : max_payload);
 }
 
+int get_cxl_serial(struct cxlmi_endpoint *ep, uint64_t *serial) {
+  char path[PATH_MAX], buf[SYSFS_ATTR_SIZE];
+  ssize_t n;
+  int fd;
+
+  if (!ep || !ep->devname)
+    return -ENODEV;
+  if (cxlmi_emu_is_emulated(ep)) {
+    *serial = cxlmi_emu_serial(ep);
+    return 0;
+  }
+
+  snprintf(path, sizeof(path), "/sys/bus/cxl/devices/%s/serial", ep->devname);
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -errno;
+  n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (n <= 0)
+    return -EIO;
+  buf[n] = 0;
+
+  *serial = strtoull(buf, NULL, 0);
+  return *serial ? 0 : -ENODATA;
+}
+
+/*
+ * send_cmd_cci() plus a mailbox latency sample keyed by opcode. Emulated
+ * endpoints are answered by the emulator instead of the transport. Opcodes
+ * missing from the endpoint's CEL fail right away, see vendor_caps.h; the
+ * CEL says nothing about a tunneled target, so those always go out.
+ */
+int send_cmd_cci_timed(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
+                       struct cxlmi_cci_msg *req_msg, size_t req_msg_sz,
+                       struct cxlmi_cci_msg *rsp_msg, size_t rsp_msg_sz,
+                       size_t rsp_msg_sz_min) {
+  uint16_t opcode = req_msg->command_set << 8 | req_msg->command;
+  uint64_t start;
+  int rc;
+
+  if (!ti && !cxlmi_caps_supported(ep, opcode))
+    return CXLMI_RET_UNSUPPORTED;
+
+  start = cxlmi_timing_now();
+  if (cxlmi_emu_is_emulated(ep))
+    rc = cxlmi_emu_send(ep, req_msg, req_msg_sz, rsp_msg, rsp_msg_sz);
+  else
+    rc = send_cmd_cci(ep, ti, req_msg, req_msg_sz, rsp_msg, rsp_msg_sz,
+                      rsp_msg_sz_min);
+  cxlmi_timing_record(CXLMI_TIMING_MBOX, opcode, NULL,
+                      cxlmi_timing_now() - start);
+
+  return rc;
+}
+
+CXLMI_EXPORT int cxlmi_write_full(int fd, const void *buf, size_t len) {
+  const char *p = buf;
+  ssize_t n;
+
+  while (len) {
+    n = write(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -errno;
+    }
+    p += n;
+    len -= n;
+  }
+
+  return 0;
+}
+
+CXLMI_EXPORT int cxlmi_get_log_stream(struct cxlmi_endpoint *ep,
+                                      struct cxlmi_tunnel_info *ti,
+                                      const uint8_t *uuid, uint32_t length,
+                                      void *buf, cxlmi_log_sink sink,
+                                      void *priv) {
+  uint8_t *bounce = NULL, *dst;
+  struct cxlmi_cmd_get_log_req in;
+  uint32_t chunk, off, n;
+  int rc = 0;
+
+  chunk = get_cxl_maxpayload(ep);
+  if (chunk < LOG_CHUNK_MIN)
+    chunk = LOG_CHUNK_MIN;
+  /* whole CEL entries in every chunk */
+  chunk &= ~(uint32_t)(sizeof(struct cxlmi_cmd_get_log_cel_rsp) - 1);
+
+  if (!buf) {
+    bounce = malloc(chunk);
+    if (!bounce)
+      return -ENOMEM;
+  }
+
+  memcpy(in.uuid, uuid, sizeof(in.uuid));
+  for (off = 0; off < length; off += n) {
+    n = length - off < chunk ? length - off : chunk;
+    dst = buf ? (uint8_t *)buf + off : bounce;
+
+    in.offset = off;
+    in.length = n;
+    rc = cxlmi_cmd_get_log_cel(ep, ti, &in, (void *)dst);
+    if (rc)
+      break;
+    if (sink) {
+      rc = sink(dst, n, priv);
+      if (rc)
+        break;
+    }
+  }
+
+  free(bounce);
+  return rc;
+}
+
+CXLMI_EXPORT int cxlmi_get_log_size(struct cxlmi_endpoint *ep,
+                                    struct cxlmi_tunnel_info *ti,
+                                    const uint8_t *uuid, uint32_t *size) {
+  struct cxlmi_cmd_get_supported_logs *gsl;
+  int i, rc;
+
+  gsl = calloc(1, sizeof(*gsl) +
+                      CXLMI_MAX_SUPPORTED_LOGS * sizeof(*gsl->entries));
+  if (!gsl)
+    return -ENOMEM;
+
+  *size = 0;
+  rc = cxlmi_cmd_get_supported_logs(ep, ti, gsl);
+  for (i = 0; !rc && i < gsl->num_supported_log_entries; i++) {
+    if (memcmp(gsl->entries[i].uuid, uuid, sizeof(gsl->entries[i].uuid)) == 0)
+      *size = gsl->entries[i].log_size;
+  }
+
+  free(gsl);
+  return rc;
+}
+
+static int log_sink_fd(const void *chunk, uint32_t len, void *priv) {
+  return cxlmi_write_full(*(int *)priv, chunk, len);
+}
+
+CXLMI_EXPORT int cxlmi_get_log_paged(struct cxlmi_endpoint *ep,
+                                     struct cxlmi_tunnel_info *ti,
+                                     const uint8_t *uuid, uint32_t length,
+                                     void *buf, int fd) {
+  return cxlmi_get_log_stream(ep, ti, uuid, length, buf,
+                              fd >= 0 ? log_sink_fd : NULL, &fd);
+}
+
 /* CXL command implementation */
 CXLMI_EXPORT int cxlmi_cmd_get_os_fw_info(struct cxlmi_endpoint *ep,
                                           struct cxlmi_tunnel_info *ti,
@@ -91,7 +250,7 @@ CXLMI_EXPORT int cxlmi_cmd_get_os_fw_info(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -111,29 +270,71 @@ CXLMI_EXPORT int cxlmi_cmd_vendor_transfer_fw(struct cxlmi_endpoint *ep,
                                               struct cxlmi_tunnel_info *ti,
                                               struct cxlmi_cmd_transfer_fw *in,
                                               uint32_t opcode) {
+  return cxlmi_cmd_vendor_transfer_fw_len(ep, ti, in, struct_size(in, data, 0),
+                                          opcode);
+}
+
+CXLMI_EXPORT int
+cxlmi_cmd_vendor_transfer_fw_len(struct cxlmi_endpoint *ep,
+                                 struct cxlmi_tunnel_info *ti,
+                                 struct cxlmi_cmd_transfer_fw *in,
+                                 size_t data_sz, uint32_t opcode) {
   struct cxlmi_cmd_transfer_fw *req_pl;
   _cleanup_free_ struct cxlmi_cci_msg *req = NULL;
 
+  req = calloc(1, sizeof(*req) + sizeof(*req_pl) + data_sz);
+  if (!req)
+    return -1;
+
+  req_pl = (struct cxlmi_cmd_transfer_fw *)req->payload;
+  req_pl->action = in->action;
+  req_pl->slot = in->slot;
+  memcpy(req_pl->data, in->data, data_sz);
+
+  return cxlmi_cmd_vendor_transfer_fw_msg(ep, ti, req, in->offset, data_sz,
+                                          opcode);
+}
+
+CXLMI_EXPORT int
+cxlmi_cmd_vendor_transfer_fw_msg(struct cxlmi_endpoint *ep,
+                                 struct cxlmi_tunnel_info *ti,
+                                 struct cxlmi_cci_msg *req, uint32_t offset,
+                                 size_t data_sz, uint32_t opcode) {
+  struct cxlmi_cmd_transfer_fw *req_pl;
+  struct cxlmi_cci_msg rsp;
+  ssize_t req_sz;
+
+  req_sz = sizeof(*req) + sizeof(*req_pl) + data_sz;
+  arm_cci_request(ep, req, sizeof(*req_pl) + data_sz, VENDOR_CMD_OEM_MGMT,
+                  opcode);
+  req_pl = (struct cxlmi_cmd_transfer_fw *)req->payload;
+  req_pl->offset = cpu_to_le32(offset);
+
+  return send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp),
+                            sizeof(rsp));
+}
+
+CXLMI_EXPORT int cxlmi_cmd_vendor_activate_fw(struct cxlmi_endpoint *ep,
+                                              struct cxlmi_tunnel_info *ti,
+                                              struct cxlmi_cmd_activate_fw *in) {
+  struct cxlmi_cmd_activate_fw *req_pl;
+  _cleanup_free_ struct cxlmi_cci_msg *req = NULL;
   struct cxlmi_cci_msg rsp;
-  ssize_t req_sz, data_sz = struct_size(in, data, 0);
-  int rc = -1;
+  ssize_t req_sz;
 
-  req_sz = sizeof(*req_pl) + data_sz + sizeof(*req);
+  req_sz = sizeof(*req_pl) + sizeof(*req);
   req = calloc(1, req_sz);
   if (!req)
     return -1;
 
-  arm_cci_request(ep, req, sizeof(*req_pl), VENDOR_CMD_OEM_MGMT, opcode);
-  req_pl = (struct cxlmi_cmd_transfer_fw *)req->payload;
+  arm_cci_request(ep, req, sizeof(*req_pl), VENDOR_CMD_OEM_MGMT, ACTIVATE_FW);
+  req_pl = (struct cxlmi_cmd_activate_fw *)req->payload;
 
   req_pl->action = in->action;
   req_pl->slot = in->slot;
-  req_pl->offset = cpu_to_le32(in->offset);
-  memcpy(req_pl->data, in->data, data_sz);
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
-
-  return rc;
+  return send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp),
+                            sizeof(rsp));
 }
 
 CXLMI_EXPORT int
@@ -150,12 +351,11 @@ cxlmi_cmd_get_hbo_status(struct cxlmi_endpoint *ep,
   uint8_t running_shift = 23;
   uint8_t retcode_shift = 32;
   uint8_t extended_shift = 48;
-  uint64_t opcode_mask = (1 << percent_shift) - (1 << opcode_shift);    // 0-15
-  uint64_t percent_mask = (1 << running_shift) - (1 << percent_shift);  // 16-22
-  uint64_t running_mask = (1 << running_shift);                         // 23
-  uint64_t retcode_mask = (1 << extended_shift) - (1 << retcode_shift); // 32-47
-  uint64_t extended_mask =
-      0xffffffffffffffff - (1 << extended_shift) + 1; // 48-63
+  uint64_t opcode_mask = (1ULL << percent_shift) - (1ULL << opcode_shift);
+  uint64_t percent_mask = (1ULL << running_shift) - (1ULL << percent_shift);
+  uint64_t running_mask = (1ULL << running_shift); // 23
+  uint64_t retcode_mask = (1ULL << extended_shift) - (1ULL << retcode_shift);
+  uint64_t extended_mask = ~0ULL - (1ULL << extended_shift) + 1; // 48-63
 
   CXLMI_BUILD_BUG_ON(sizeof(*ret) != sizeof(struct cxlmi_cmd_hbo_status_out));
 
@@ -166,7 +366,7 @@ cxlmi_cmd_get_hbo_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -211,7 +411,7 @@ cxlmi_cmd_dimm_spd_read(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -241,7 +441,7 @@ cxlmi_cmd_dimm_slot_info(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -269,7 +469,7 @@ CXLMI_EXPORT int cxlmi_cmd_read_ddr_temp(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -300,7 +500,7 @@ cxlmi_cmd_health_counters_clear(struct cxlmi_endpoint *ep,
 
   req_pl->bitmask = in->bitmask;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -325,7 +525,7 @@ cxlmi_cmd_health_counters_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -353,7 +553,7 @@ int cxlmi_cmd_pmic_vtmon_info(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -382,7 +582,7 @@ int cxlmi_cmd_read_ltssm_states(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -419,7 +619,7 @@ int cxlmi_cmd_pcie_eye_run(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -448,7 +648,7 @@ int cxlmi_cmd_pcie_eye_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -485,7 +685,7 @@ int cxlmi_cmd_pcie_eye_get_sw(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -514,7 +714,7 @@ int cxlmi_cmd_pcie_eye_get_hw(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -543,7 +743,7 @@ int cxlmi_cmd_pcie_eye_get_sw_ber(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -573,7 +773,7 @@ int cxlmi_cmd_get_cxl_link_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -604,7 +804,7 @@ int cxlmi_cmd_get_device_info(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -642,7 +842,7 @@ int cxlmi_cmd_get_ddr_bw(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -675,7 +875,7 @@ int cxlmi_cmd_ddr_margin_run(struct cxlmi_endpoint *ep,
   req_pl->rd_wr_margin = in->rd_wr_margin;
   req_pl->ddr_id = in->ddr_id;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -699,7 +899,7 @@ int cxlmi_cmd_ddr_margin_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -736,7 +936,7 @@ int cxlmi_cmd_ddr_margin_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -765,7 +965,7 @@ int cxlmi_cmd_reboot_mode_set(struct cxlmi_endpoint *ep,
 
   req_pl->reboot_mode = in->reboot_mode;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
   return rc;
 }
 
@@ -788,7 +988,7 @@ int cxlmi_cmd_curr_cxl_boot_mode_get(
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -817,7 +1017,7 @@ int cxlmi_cmd_get_ddr_ecc_err_info(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -854,7 +1054,7 @@ int cxlmi_cmd_i2c_read(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -885,7 +1085,7 @@ int cxlmi_cmd_i2c_write(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
   req_pl->reg_addr = in->reg_addr;
   req_pl->data = in->data;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -916,7 +1116,7 @@ int cxlmi_cmd_get_ddr_latency(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -945,7 +1145,7 @@ int cxlmi_cmd_get_membridge_errors(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -981,7 +1181,7 @@ int cxlmi_cmd_hpa_to_dpa(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -997,8 +1197,8 @@ int cxlmi_cmd_start_ddr_ecc_scrub(struct cxlmi_endpoint *ep,
 
   arm_cci_request(ep, &req, 0, VENDOR_CMD_OTHERS, START_DDR_ECC_SCRUB);
 
-  return send_cmd_cci(ep, ti, &req, sizeof(req), &rsp, sizeof(rsp),
-                      sizeof(rsp));
+  return send_cmd_cci_timed(ep, ti, &req, sizeof(req), &rsp, sizeof(rsp),
+                            sizeof(rsp));
 }
 
 int cxlmi_cmd_ddr_ecc_scrub_status(struct cxlmi_endpoint *ep,
@@ -1020,7 +1220,7 @@ int cxlmi_cmd_ddr_ecc_scrub_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1049,7 +1249,7 @@ int cxlmi_cmd_ddr_init_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1082,7 +1282,7 @@ int cxlmi_cmd_get_membridge_stats(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1113,7 +1313,7 @@ int cxlmi_cmd_ddr_err_inj_en(struct cxlmi_endpoint *ep,
   req_pl->err_type = in->err_type;
   req_pl->ecc_fwc_mask = in->ecc_fwc_mask;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1124,8 +1324,8 @@ int cxlmi_cmd_trigger_coredump(struct cxlmi_endpoint *ep,
 
   arm_cci_request(ep, &req, 0, VENDOR_CMD_OTHERS, TRIGGER_COREDUMP);
 
-  return send_cmd_cci(ep, ti, &req, sizeof(req), &rsp, sizeof(rsp),
-                      sizeof(rsp));
+  return send_cmd_cci_timed(ep, ti, &req, sizeof(req), &rsp, sizeof(rsp),
+                            sizeof(rsp));
 }
 
 int cxlmi_cmd_ddr_stats_run(struct cxlmi_endpoint *ep,
@@ -1149,7 +1349,7 @@ int cxlmi_cmd_ddr_stats_run(struct cxlmi_endpoint *ep,
   req_pl->monitor_time = in->monitor_time;
   req_pl->loop_count = in->loop_count;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1172,7 +1372,7 @@ int cxlmi_cmd_ddr_stats_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1211,7 +1411,7 @@ int cxlmi_cmd_ddr_stats_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1242,7 +1442,7 @@ int cxlmi_cmd_ddr_param_set(struct cxlmi_endpoint *ep,
   req_pl->ddr_inter.ddr_interleave_ctrl_choice =
       in->ddr_inter.ddr_interleave_ctrl_choice;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1265,7 +1465,7 @@ int cxlmi_cmd_ddr_param_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1296,7 +1496,7 @@ int cxlmi_cmd_dimm_level_training_status(
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1325,7 +1525,7 @@ int cxlmi_cmd_viral_inj_en(struct cxlmi_endpoint *ep,
   req_pl = (struct cxlmi_cmd_viral_inj_en *)req->payload;
 
   req_pl->viral_type = in->viral_type;
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1351,7 +1551,7 @@ int cxlmi_cmd_mem_ll_err_inj_en(struct cxlmi_endpoint *ep,
   req_pl->en_dis = in->en_dis;
   req_pl->ll_err_type = in->ll_err_type;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1381,7 +1581,7 @@ int cxlmi_cmd_pci_err_inj_en(struct cxlmi_endpoint *ep,
   req_pl->opt_param1 = in->opt_param1;
   req_pl->opt_param2 = in->opt_param2;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1405,7 +1605,7 @@ int cxlmi_cmd_core_volt_set(struct cxlmi_endpoint *ep,
 
   req_pl->core_volt = in->core_volt;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1428,7 +1628,7 @@ int cxlmi_cmd_core_volt_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1457,7 +1657,7 @@ int cxlmi_cmd_ddr_cont_scrub_status(
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1487,7 +1687,7 @@ int cxlmi_cmd_ddr_cont_scrub_set(struct cxlmi_endpoint *ep,
 
   req_pl->cont_scrub_status = in->cont_scrub_status;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1512,7 +1712,7 @@ int cxlmi_cmd_ddr_page_select_set(struct cxlmi_endpoint *ep,
 
   req_pl->pp_select.page_policy_reg_val = in->pp_select.page_policy_reg_val;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1536,7 +1736,7 @@ int cxlmi_cmd_ddr_page_select_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1565,7 +1765,7 @@ int cxlmi_cmd_ddr_hppr_set(struct cxlmi_endpoint *ep,
 
   req_pl->enable = in->enable;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1588,7 +1788,7 @@ int cxlmi_cmd_ddr_hppr_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1623,7 +1823,7 @@ int cxlmi_cmd_ddr_hppr_addr_info_set(
   req_pl->hppr_addr_info.bank_group = in->hppr_addr_info.bank_group;
   req_pl->hppr_addr_info.row = in->hppr_addr_info.row;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1647,7 +1847,7 @@ int cxlmi_cmd_ddr_hppr_addr_info_get(
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1678,7 +1878,7 @@ int cxlmi_cmd_ddr_hppr_addr_info_clear(
   req_pl->ddr_id = in->ddr_id;
   req_pl->channel_id = in->channel_id;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1702,7 +1902,7 @@ int cxlmi_cmd_ddr_ppr_get_status(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1732,7 +1932,7 @@ int cxlmi_cmd_ddr_refresh_mode_set(struct cxlmi_endpoint *ep,
 
   req_pl->ddr_refresh_val = in->ddr_refresh_val;
 
-  rc = send_cmd_cci(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
+  rc = send_cmd_cci_timed(ep, ti, req, req_sz, &rsp, sizeof(rsp), sizeof(rsp));
 
   return rc;
 }
@@ -1756,7 +1956,7 @@ int cxlmi_cmd_ddr_refresh_mode_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1784,7 +1984,7 @@ int cxlmi_cmd_cxl_err_cntr_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1812,7 +2012,7 @@ int cxlmi_cmd_ddr_freq_get(struct cxlmi_endpoint *ep,
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
@@ -1841,7 +2041,7 @@ int cxlmi_cmd_ddr_init_err_info_get(
   if (!rsp)
     return -1;
 
-  rc = send_cmd_cci(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
+  rc = send_cmd_cci_timed(ep, ti, &req, sizeof(req), rsp, rsp_sz, rsp_sz);
   if (rc)
     return rc;
 
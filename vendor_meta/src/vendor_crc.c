@@ -0,0 +1,127 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+/* std includes */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/* libcxlmi includes */
+#include <ccan/endian/endian.h>
+#include <cxlmi/private.h>
+
+/* vendor includes */
+#include <vendor_crc.h>
+
+#define CRC32C_POLY 0x82f63b78 /* reflected 0x1edc6f41 */
+
+static uint32_t crc32c_table[8][256];
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len) {
+  uint64_t v;
+
+  while (len && ((uintptr_t)p & 7)) {
+    crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    len--;
+  }
+  while (len >= 8) {
+    memcpy(&v, p, sizeof(v));
+    v = le64_to_cpu(v) ^ crc;
+    crc = crc32c_table[7][v & 0xff] ^ crc32c_table[6][(v >> 8) & 0xff] ^
+          crc32c_table[5][(v >> 16) & 0xff] ^
+          crc32c_table[4][(v >> 24) & 0xff] ^
+          crc32c_table[3][(v >> 32) & 0xff] ^
+          crc32c_table[2][(v >> 40) & 0xff] ^
+          crc32c_table[1][(v >> 48) & 0xff] ^ crc32c_table[0][v >> 56];
+    p += 8;
+    len -= 8;
+  }
+  while (len--)
+    crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t
+crc32c_hw(uint32_t crc, const unsigned char *p, size_t len) {
+  uint64_t c = crc, v;
+
+  while (len && ((uintptr_t)p & 7)) {
+    c = _mm_crc32_u8(c, *p++);
+    len--;
+  }
+  while (len >= 8) {
+    memcpy(&v, p, sizeof(v));
+    c = _mm_crc32_u64(c, v);
+    p += 8;
+    len -= 8;
+  }
+  while (len--)
+    c = _mm_crc32_u8(c, *p++);
+
+  return c;
+}
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len) {
+  uint64_t v;
+
+  while (len && ((uintptr_t)p & 7)) {
+    crc = __crc32cb(crc, *p++);
+    len--;
+  }
+  while (len >= 8) {
+    memcpy(&v, p, sizeof(v));
+    crc = __crc32cd(crc, v);
+    p += 8;
+    len -= 8;
+  }
+  while (len--)
+    crc = __crc32cb(crc, *p++);
+
+  return crc;
+}
+#endif
+
+static uint32_t (*crc32c_impl)(uint32_t, const unsigned char *,
+                               size_t) = crc32c_sw;
+
+/* Before main(), so that no caller ever races the table being filled in */
+__attribute__((constructor)) static void crc32c_init(void) {
+  const char *s;
+  uint32_t crc;
+  int i, j;
+
+  for (i = 0; i < 256; i++) {
+    crc = i;
+    for (j = 0; j < 8; j++)
+      crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+    crc32c_table[0][i] = crc;
+  }
+  for (i = 0; i < 256; i++) {
+    for (j = 1; j < 8; j++)
+      crc32c_table[j][i] = crc32c_table[0][crc32c_table[j - 1][i] & 0xff] ^
+                           (crc32c_table[j - 1][i] >> 8);
+  }
+
+  s = getenv("CXL_CRC32C");
+  if (s && strcmp(s, "sw") == 0)
+    return;
+
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2"))
+    crc32c_impl = crc32c_hw;
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+  crc32c_impl = crc32c_hw;
+#endif
+}
+
+CXLMI_EXPORT uint32_t cxlmi_crc32c(uint32_t crc, const void *buf,
+                                   size_t len) {
+  return ~crc32c_impl(~crc, buf, len);
+}
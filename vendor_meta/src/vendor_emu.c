@@ -0,0 +1,1423 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+/* std includes */
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+/* libcxlmi includes */
+#include <ccan/endian/endian.h>
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include <util_main.h>
+#include <vendor_emu.h>
+#include <vendor_timing.h>
+#include <vendor_types.h>
+
+#define EMU_NAME_MAX 32
+#define EMU_LAT_MAX 32
+#define EMU_PAYLOAD_MAX_DEFAULT (1024 * 1024)
+#define EMU_BG_DEFAULT_NS (200 * 1000000ULL)
+#define EMU_FW_SLOTS 4
+#define EMU_HBO_DONE 100
+#define EMU_SERIAL_BASE 0x4d45544100000000ULL /* "META" */
+
+#define EMU_OPCODE(set, cmd) ((set) << 8 | (cmd))
+
+/* Background operations, each runs for CXL_EMU_BG once started */
+enum {
+  EMU_BG_EYE,
+  EMU_BG_MARGIN,
+  EMU_BG_STATS,
+  EMU_BG_SCRUB,
+  EMU_BG_HBO,
+  EMU_BG_NR,
+};
+
+struct emu_bg {
+  uint64_t start_ns;
+  uint64_t end_ns;
+  bool done; /* has completed at least once, results are available */
+};
+
+struct emu_dev {
+  char name[EMU_NAME_MAX];
+  pthread_mutex_t lock;
+  uint64_t boot_ns;
+  struct emu_bg bg[EMU_BG_NR];
+
+  /* firmware transfer and hbo */
+  uint16_t hbo_opcode;
+  bool fw_xfer;
+  uint8_t fw_slot;
+  uint8_t fw_active;
+  uint32_t fw_next_offset;
+  uint32_t fw_blocks;
+  uint32_t fw_images;
+  char fw_rev[EMU_FW_SLOTS][0x10];
+
+  /* results of the last runs */
+  uint8_t eye_sw_scan;
+  uint8_t eye_lane;
+  uint32_t stats_loops;
+
+  /* error counters, bumped by the injection opcodes */
+  struct cxlmi_cmd_health_counters_get health;
+  struct cxlmi_cmd_get_ddr_ecc_err_info ecc;
+  struct cxlmi_cmd_cxl_err_cntr_get cxl_err;
+
+  /* set/get pairs */
+  uint8_t reboot_mode;
+  struct ddr_interleave_options ddr_inter;
+  uint8_t i2c[256];
+  float core_volt;
+  uint32_t cont_scrub;
+  uint8_t page_policy;
+  uint8_t hppr_enable[2];
+  struct _ddr_addr_info_out hppr_addr[2][8];
+  uint8_t refresh_mode;
+};
+
+struct emu_lat {
+  uint16_t opcode;
+  uint64_t ns;
+};
+
+/* Configuration, parsed once from the environment and inherited by forks */
+static struct {
+  int nr_devs;
+  char names[CXLMI_EMU_MAX_DEVS][EMU_NAME_MAX];
+  uint64_t lat_ns;
+  struct emu_lat lat[EMU_LAT_MAX];
+  int nr_lat;
+  uint64_t bg_ns;
+  int payload_max;
+} emu_cfg;
+
+static struct emu_dev *emu_devs;
+
+/* Per process, every open endpoint maps to one shared device */
+static struct {
+  struct cxlmi_endpoint *ep;
+  struct emu_dev *dev;
+} emu_eps[CXLMI_EMU_MAX_DEVS];
+
+/* "<n>[ns|us|ms|s]", bare numbers are microseconds */
+static int emu_parse_lat(const char *s, uint64_t *ns) {
+  char *end;
+  double v = strtod(s, &end);
+
+  if (end == s || v < 0)
+    return -EINVAL;
+
+  if (*end == '\0' || strncmp(end, "us", 2) == 0)
+    v *= 1e3;
+  else if (strncmp(end, "ms", 2) == 0)
+    v *= 1e6;
+  else if (strncmp(end, "s", 1) == 0)
+    v *= 1e9;
+  else if (strncmp(end, "ns", 2) != 0)
+    return -EINVAL;
+
+  *ns = (uint64_t)v;
+  return 0;
+}
+
+static int emu_parse_devs(const char *s) {
+  _cleanup_free_ char *list = NULL;
+  char *tok, *save = NULL;
+  int i, n;
+
+  if (isdigit((unsigned char)s[0])) {
+    n = atoi(s);
+    if (n < 1 || n > CXLMI_EMU_MAX_DEVS)
+      return -EINVAL;
+    for (i = 0; i < n; i++)
+      snprintf(emu_cfg.names[i], EMU_NAME_MAX, "mem%d", i);
+    return n;
+  }
+
+  list = strdup(s);
+  if (!list)
+    return -ENOMEM;
+
+  n = 0;
+  for (tok = strtok_r(list, ",", &save); tok;
+       tok = strtok_r(NULL, ",", &save)) {
+    if (n == CXLMI_EMU_MAX_DEVS)
+      return -E2BIG;
+    snprintf(emu_cfg.names[n++], EMU_NAME_MAX, "%s", tok);
+  }
+  return n ? n : -EINVAL;
+}
+
+static int emu_parse_lat_list(const char *s) {
+  _cleanup_free_ char *list = strdup(s);
+  char *tok, *save = NULL, *eq;
+  struct emu_lat *l;
+
+  if (!list)
+    return -ENOMEM;
+
+  for (tok = strtok_r(list, ",", &save); tok;
+       tok = strtok_r(NULL, ",", &save)) {
+    eq = strchr(tok, '=');
+    if (!eq) {
+      if (emu_parse_lat(tok, &emu_cfg.lat_ns))
+        return -EINVAL;
+      continue;
+    }
+
+    if (emu_cfg.nr_lat == EMU_LAT_MAX)
+      return -E2BIG;
+    l = &emu_cfg.lat[emu_cfg.nr_lat++];
+    *eq = '\0';
+    l->opcode = strtoul(tok, NULL, 0);
+    if (emu_parse_lat(eq + 1, &l->ns))
+      return -EINVAL;
+  }
+  return 0;
+}
+
+static void emu_dev_reset(struct emu_dev *d, const char *name, int idx) {
+  pthread_mutexattr_t attr;
+  int i;
+
+  memset(d, 0, sizeof(*d));
+  snprintf(d->name, sizeof(d->name), "%s", name);
+  d->boot_ns = cxlmi_timing_now();
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutex_init(&d->lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  d->fw_active = 1;
+  for (i = 0; i < EMU_FW_SLOTS; i++)
+    snprintf(d->fw_rev[i], sizeof(d->fw_rev[i]), "emu-1.0.%d", idx);
+
+  d->health.power_on_events = cpu_to_le32(1);
+  d->core_volt = 0.85f;
+  d->ddr_inter.ddr_interleave_sz = 8;
+  d->ddr_inter.ddr_interleave_ctrl_choice = 1;
+  d->refresh_mode = 1;
+}
+
+CXLMI_EXPORT int cxlmi_emu_init(void) {
+  const char *s;
+  uint64_t bg;
+  void *p;
+  int i, rc;
+
+  if (emu_devs)
+    return 0;
+
+  s = getenv("CXL_EMU");
+  if (!s || !*s)
+    return 0;
+
+  rc = emu_parse_devs(s);
+  if (rc < 0) {
+    fprintf(stderr, "CXL_EMU: invalid device list '%s'\n", s);
+    return rc;
+  }
+  emu_cfg.nr_devs = rc;
+
+  s = getenv("CXL_EMU_LATENCY");
+  if (s && emu_parse_lat_list(s)) {
+    fprintf(stderr, "CXL_EMU_LATENCY: invalid value '%s'\n", s);
+    return -EINVAL;
+  }
+
+  emu_cfg.bg_ns = EMU_BG_DEFAULT_NS;
+  s = getenv("CXL_EMU_BG");
+  if (s) {
+    if (emu_parse_lat(s, &bg)) {
+      fprintf(stderr, "CXL_EMU_BG: invalid value '%s'\n", s);
+      return -EINVAL;
+    }
+    emu_cfg.bg_ns = bg;
+  }
+
+  emu_cfg.payload_max = EMU_PAYLOAD_MAX_DEFAULT;
+  s = getenv("CXL_EMU_PAYLOAD_MAX");
+  if (s)
+    emu_cfg.payload_max = strtoul(s, NULL, 0);
+  if (emu_cfg.payload_max < 256) {
+    fprintf(stderr, "CXL_EMU_PAYLOAD_MAX: must be at least 256\n");
+    return -EINVAL;
+  }
+
+  p = mmap(NULL, emu_cfg.nr_devs * sizeof(*emu_devs), PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return -errno;
+
+  emu_devs = p;
+  for (i = 0; i < emu_cfg.nr_devs; i++)
+    emu_dev_reset(&emu_devs[i], emu_cfg.names[i], i);
+
+  return 0;
+}
+
+CXLMI_EXPORT bool cxlmi_emu_enabled(void) { return emu_devs != NULL; }
+
+CXLMI_EXPORT int cxlmi_emu_count(void) {
+  return emu_devs ? emu_cfg.nr_devs : 0;
+}
+
+CXLMI_EXPORT const char *cxlmi_emu_devname(int i) {
+  if (!emu_devs || i < 0 || i >= emu_cfg.nr_devs)
+    return NULL;
+  return emu_devs[i].name;
+}
+
+CXLMI_EXPORT int cxlmi_emu_payload_max(void) { return emu_cfg.payload_max; }
+
+CXLMI_EXPORT struct cxlmi_endpoint *cxlmi_emu_open(struct cxlmi_ctx *ctx,
+                                                   const char *devname) {
+  struct cxlmi_endpoint *ep;
+  struct emu_dev *d = NULL;
+  int i, slot = -1;
+
+  if (!emu_devs || !devname)
+    return NULL;
+
+  for (i = 0; i < emu_cfg.nr_devs; i++) {
+    if (strcmp(emu_devs[i].name, devname) == 0) {
+      d = &emu_devs[i];
+      break;
+    }
+  }
+  if (!d)
+    return NULL;
+
+  for (i = 0; i < CXLMI_EMU_MAX_DEVS; i++) {
+    if (emu_eps[i].ep && emu_eps[i].dev == d)
+      return emu_eps[i].ep;
+    if (!emu_eps[i].ep && slot < 0)
+      slot = i;
+  }
+  if (slot < 0)
+    return NULL;
+
+  ep = calloc(1, sizeof(*ep));
+  if (!ep)
+    return NULL;
+
+  ep->ctx = ctx;
+  ep->fd = -1;
+  ep->devname = strdup(devname);
+  if (!ep->devname) {
+    free(ep);
+    return NULL;
+  }
+
+  emu_eps[slot].ep = ep;
+  emu_eps[slot].dev = d;
+  return ep;
+}
+
+CXLMI_EXPORT void cxlmi_emu_close(struct cxlmi_endpoint *ep) {
+  int i;
+
+  for (i = 0; i < CXLMI_EMU_MAX_DEVS; i++) {
+    if (emu_eps[i].ep == ep) {
+      emu_eps[i].ep = NULL;
+      emu_eps[i].dev = NULL;
+      free(ep->devname);
+      free(ep);
+      return;
+    }
+  }
+}
+
+static struct emu_dev *emu_dev_of(struct cxlmi_endpoint *ep) {
+  int i;
+
+  for (i = 0; ep && i < CXLMI_EMU_MAX_DEVS; i++) {
+    if (emu_eps[i].ep == ep)
+      return emu_eps[i].dev;
+  }
+  return NULL;
+}
+
+CXLMI_EXPORT struct cxlmi_endpoint *cxlmi_emu_find(const char *devname) {
+  int i;
+
+  for (i = 0; devname && i < CXLMI_EMU_MAX_DEVS; i++) {
+    if (emu_eps[i].ep && strcmp(emu_eps[i].dev->name, devname) == 0)
+      return emu_eps[i].ep;
+  }
+  return NULL;
+}
+
+CXLMI_EXPORT bool cxlmi_emu_is_emulated(struct cxlmi_endpoint *ep) {
+  return emu_dev_of(ep) != NULL;
+}
+
+/* Stable per device, derived from its position in CXL_EMU */
+CXLMI_EXPORT uint64_t cxlmi_emu_serial(struct cxlmi_endpoint *ep) {
+  struct emu_dev *d = emu_dev_of(ep);
+
+  return d ? EMU_SERIAL_BASE + (d - emu_devs) : 0;
+}
+
+/* Background operation helpers */
+static void emu_bg_start(struct emu_dev *d, int op) {
+  d->bg[op].start_ns = cxlmi_timing_now();
+  d->bg[op].end_ns = d->bg[op].start_ns + emu_cfg.bg_ns;
+  d->bg[op].done = false;
+}
+
+static bool emu_bg_running(struct emu_dev *d, int op) {
+  if (!d->bg[op].end_ns)
+    return false;
+  if (cxlmi_timing_now() < d->bg[op].end_ns)
+    return true;
+  d->bg[op].done = true;
+  return false;
+}
+
+static int emu_bg_percent(struct emu_dev *d, int op) {
+  uint64_t now = cxlmi_timing_now(), len;
+
+  if (!emu_bg_running(d, op))
+    return EMU_HBO_DONE;
+  len = d->bg[op].end_ns - d->bg[op].start_ns;
+  return len ? (now - d->bg[op].start_ns) * 100 / len : EMU_HBO_DONE;
+}
+
+/*
+ * Opcode handlers. 'in' holds at least the request size from the table,
+ * 'out' at least the response size, or out_sz bytes for variable sized
+ * responses. They return the CXLMI_RET_* code of the command.
+ */
+typedef int (*emu_handler)(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz);
+
+/* OEM_MGMT */
+static int emu_hbo_status(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  struct cxlmi_cmd_hbo_status_out *rsp = out;
+  uint64_t st = d->hbo_opcode;
+
+  st |= (uint64_t)emu_bg_percent(d, EMU_BG_HBO) << 16;
+  if (emu_bg_running(d, EMU_BG_HBO))
+    st |= 1ULL << 23;
+  rsp->bo_status = cpu_to_le64(st);
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_transfer(struct emu_dev *d, const void *in, uint8_t opcode) {
+  const struct cxlmi_cmd_transfer_fw *req = in;
+  uint32_t offset = le32_to_cpu(req->offset);
+
+  /* one block in flight at a time, like the real hbo engine */
+  if (emu_bg_running(d, EMU_BG_HBO))
+    return CXLMI_RET_BUSY;
+
+  switch (req->action) {
+  case INITIATE_TRANSFER:
+    if (offset)
+      return CXLMI_RET_INPUT;
+    d->fw_xfer = true;
+    d->fw_slot = req->slot;
+    d->fw_blocks = 0;
+    break;
+  case CONTINUE_TRANSFER:
+  case END_TRANSFER:
+    if (!d->fw_xfer || offset < d->fw_next_offset)
+      return CXLMI_RET_INPUT;
+    break;
+  case ABORT_TRANSFER:
+    d->fw_xfer = false;
+    return CXLMI_RET_SUCCESS;
+  default:
+    return CXLMI_RET_INPUT;
+  }
+
+  d->fw_next_offset = offset;
+  d->fw_blocks++;
+  d->hbo_opcode = EMU_OPCODE(VENDOR_CMD_OEM_MGMT, opcode);
+  emu_bg_start(d, EMU_BG_HBO);
+
+  if (req->action == END_TRANSFER) {
+    d->fw_xfer = false;
+    d->fw_images++;
+    if (d->fw_slot >= 1 && d->fw_slot <= EMU_FW_SLOTS)
+      snprintf(d->fw_rev[d->fw_slot - 1], sizeof(d->fw_rev[0]), "emu-2.%u.%u",
+               d->fw_images, d->fw_blocks);
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_transfer_fw(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  return emu_transfer(d, in, TRANSFER_FW);
+}
+
+static int emu_transfer_os(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  return emu_transfer(d, in, TRANSFER_OS);
+}
+
+static int emu_activate_fw(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  const struct cxlmi_cmd_activate_fw *req = in;
+
+  if (req->slot < 1 || req->slot > EMU_FW_SLOTS)
+    return CXLMI_RET_INPUT;
+  if (d->fw_xfer || emu_bg_running(d, EMU_BG_HBO))
+    return CXLMI_RET_BUSY;
+  d->fw_active = req->slot;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_get_os_info(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  struct cxlmi_cmd_get_fw_info *rsp = out;
+
+  rsp->slots_supported = EMU_FW_SLOTS;
+  rsp->slot_info = d->fw_active & 0x7;
+  memcpy(rsp->fw_rev1, d->fw_rev[0], sizeof(rsp->fw_rev1));
+  memcpy(rsp->fw_rev2, d->fw_rev[1], sizeof(rsp->fw_rev2));
+  memcpy(rsp->fw_rev3, d->fw_rev[2], sizeof(rsp->fw_rev3));
+  memcpy(rsp->fw_rev4, d->fw_rev[3], sizeof(rsp->fw_rev4));
+  return CXLMI_RET_SUCCESS;
+}
+
+/* DDR_DIMM_MGMT */
+static int emu_spd_read(struct emu_dev *d, const void *in, void *out,
+                        size_t out_sz) {
+  const struct cxlmi_cmd_dimm_spd_read_req *req = in;
+  struct cxlmi_cmd_dimm_spd_read_rsp *rsp = out;
+  uint32_t id = le32_to_cpu(req->spd_id), off = le32_to_cpu(req->offset);
+  uint32_t n = le32_to_cpu(req->num_bytes), i;
+
+  if (id >= DDR_MAX_DIMM_CNT || n > sizeof(rsp->dimm_spd_data))
+    return CXLMI_RET_INPUT;
+
+  /* bytes 0-2 look like a DDR5 RDIMM, the rest is a per dimm pattern */
+  for (i = 0; i < n; i++) {
+    switch (off + i) {
+    case 0:
+      rsp->dimm_spd_data[i] = 0x30;
+      break;
+    case 1:
+      rsp->dimm_spd_data[i] = 0x10;
+      break;
+    case 2:
+      rsp->dimm_spd_data[i] = 0x12;
+      break;
+    default:
+      rsp->dimm_spd_data[i] = (off + i) * 7 + id;
+    }
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_slot_info(struct emu_dev *d, const void *in, void *out,
+                         size_t out_sz) {
+  struct cxlmi_cmd_dimm_slot_info *rsp = out;
+
+  rsp->num_dimm_slots = DDR_MAX_DIMM_CNT;
+  rsp->slot0_spd_i2c_addr = 0x50;
+  rsp->slot0_channel_id = 0;
+  rsp->slot0_dimm_silk_screen = 'A';
+  rsp->slot0_dimm_present = 1;
+  rsp->slot1_spd_i2c_addr = 0x51;
+  rsp->slot1_channel_id = 0;
+  rsp->slot1_dimm_silk_screen = 'B';
+  rsp->slot1_dimm_present = 1;
+  rsp->slot2_spd_i2c_addr = 0x52;
+  rsp->slot2_channel_id = 1;
+  rsp->slot2_dimm_silk_screen = 'C';
+  rsp->slot2_dimm_present = 1;
+  rsp->slot3_spd_i2c_addr = 0x53;
+  rsp->slot3_channel_id = 1;
+  rsp->slot3_dimm_silk_screen = 'D';
+  rsp->slot3_dimm_present = 1;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ddr_temp(struct emu_dev *d, const void *in, void *out,
+                        size_t out_sz) {
+  struct cxlmi_cmd_read_ddr_temp *rsp = out;
+  int i;
+
+  for (i = 0; i < DDR_MAX_DIMM_CNT; i++) {
+    rsp->ddr_dimm_temp_info[i].ddr_temp_valid = 1;
+    rsp->ddr_dimm_temp_info[i].dimm_id = i;
+    rsp->ddr_dimm_temp_info[i].spd_idx = i;
+    rsp->ddr_dimm_temp_info[i].dimm_temp = 40.0f + i * 1.5f;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+/* HEALTH_MGMT */
+static int emu_health_clear(struct emu_dev *d, const void *in, void *out,
+                            size_t out_sz) {
+  const struct cxlmi_cmd_health_counters_clear *req = in;
+  uint32_t mask = le32_to_cpu(req->bitmask);
+  __le32 *cnt = (__le32 *)&d->health;
+  size_t i;
+
+  for (i = 0; i < sizeof(d->health) / sizeof(*cnt) && i < 32; i++) {
+    if (mask & (1U << i))
+      cnt[i] = 0;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_health_get(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  struct cxlmi_cmd_health_counters_get *rsp = out;
+  uint64_t up = cxlmi_timing_now() - d->boot_ns;
+
+  *rsp = d->health;
+  rsp->power_on_hours = cpu_to_le32(up / 3600000000000ULL);
+  return CXLMI_RET_SUCCESS;
+}
+
+/* OTHERS */
+static int emu_pmic_vtmon(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  struct cxlmi_cmd_pmic_vtmon_info *rsp = out;
+  int i;
+
+  for (i = 0; i < MAX_PMIC; i++) {
+    snprintf(rsp->pmic_data[i].pmic_name, PMIC_NAME_MAX_SIZE, "emu_pmic%d", i);
+    rsp->pmic_data[i].vin = 12.0f;
+    rsp->pmic_data[i].vout = 1.1f;
+    rsp->pmic_data[i].iout = 2.0f + i * 0.1f;
+    rsp->pmic_data[i].powr = rsp->pmic_data[i].vout * rsp->pmic_data[i].iout;
+    rsp->pmic_data[i].temp = 45.0f;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ltssm(struct emu_dev *d, const void *in, void *out,
+                     size_t out_sz) {
+  struct cxlmi_cmd_read_ltssm_states *rsp = out;
+  /* detect, polling, config, recovery, then L0 */
+  static const uint32_t train[] = {0x01, 0x02, 0x04, 0x05, 0x0d, 0x10};
+  int i;
+
+  for (i = 0; i < LTSSM_STATE_DUMP_COUNT_MAX; i++)
+    rsp->ltssm_states[i] =
+        i < ARRAY_SIZE(train) ? train[i] : LTSSM_EXPECTED_STATE;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_eye_run(struct emu_dev *d, const void *in, void *out,
+                       size_t out_sz) {
+  const struct cxlmi_cmd_pcie_eye_run_req *req = in;
+  struct cxlmi_cmd_pcie_eye_run_rsp *rsp = out;
+
+  if (emu_bg_running(d, EMU_BG_EYE)) {
+    rsp->pcie_eye_run_status = 1;
+    return CXLMI_RET_BUSY;
+  }
+  if (req->lane > 15)
+    return CXLMI_RET_INPUT;
+
+  d->eye_lane = req->lane;
+  d->eye_sw_scan = req->sw_scan;
+  emu_bg_start(d, EMU_BG_EYE);
+  rsp->pcie_eye_run_status = 0;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_eye_status(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  struct cxlmi_cmd_pcie_eye_status *rsp = out;
+
+  rsp->pcie_eye_status = emu_bg_running(d, EMU_BG_EYE);
+  rsp->error = 0;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_eye_ready(struct emu_dev *d) {
+  if (emu_bg_running(d, EMU_BG_EYE))
+    return CXLMI_RET_BUSY;
+  return d->bg[EMU_BG_EYE].done ? CXLMI_RET_SUCCESS : CXLMI_RET_INPUT;
+}
+
+static int emu_eye_get_sw(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  const struct cxlmi_cmd_pcie_eye_get_sw_req *req = in;
+  struct cxlmi_cmd_pcie_eye_get_sw_rsp *rsp = out;
+  /* 1023 vertical steps around 511, an eye ~60% high and ~80% wide */
+  double dv = ((int)req->offset - 511) / (511 * 0.6), w;
+  int rc = emu_eye_ready(d), h;
+
+  if (rc)
+    return rc;
+  if (!d->eye_sw_scan || req->offset > 1022)
+    return CXLMI_RET_INPUT;
+
+  w = fabs(dv) < 1.0 ? NUM_EYESCOPE_HORIZ_VALS * 0.8 * sqrt(1 - dv * dv) : 0;
+  for (h = 0; h < TOTAL_EYESCOPE_HORIZ_VALS; h++) {
+    int x = h - NUM_EYESCOPE_HORIZ_VALS;
+
+    if (x == 0)
+      rsp->pcie_eye_data[h] = '|';
+    else if (req->offset == 511)
+      rsp->pcie_eye_data[h] = '-';
+    else
+      rsp->pcie_eye_data[h] = abs(x) < w ? ' ' : '1';
+  }
+  rsp->pcie_eye_data[TOTAL_EYESCOPE_HORIZ_VALS] = '\0';
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_eye_get_hw(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  struct cxlmi_cmd_pcie_eye_get_hw *rsp = out;
+  int rc = emu_eye_ready(d);
+
+  if (rc)
+    return rc;
+
+  rsp->eyescope_results.merged_horizontal_eye_left = -0.38;
+  rsp->eyescope_results.merged_horizontal_eye_right = 0.37;
+  rsp->eyescope_results.merged_vertical_eye_top = 41.0;
+  rsp->eyescope_results.merged_vertical_eye_bottom = -40.0;
+  rsp->rx_settings.h1po = 12;
+  rsp->rx_settings.h1no = -12;
+  rsp->rx_settings.aeq = 6;
+  rsp->rx_settings.vga = 9;
+  rsp->eyescope_request_status = 1;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_eye_get_sw_ber(struct emu_dev *d, const void *in, void *out,
+                              size_t out_sz) {
+  struct cxlmi_cmd_pcie_eye_get_sw_ber *rsp = out;
+  int rc = emu_eye_ready(d);
+
+  if (rc)
+    return rc;
+  if (!d->eye_sw_scan)
+    return CXLMI_RET_INPUT;
+
+  rsp->horiz_margin = 0.35f;
+  rsp->vert_margin = 25.0f;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_link_status(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  struct cxlmi_cmd_get_cxl_link_status *rsp = out;
+
+  rsp->cxl_link_status = 2.0f;
+  rsp->link_width = 16;
+  rsp->link_speed = 32;
+  rsp->ltssm_val = LTSSM_EXPECTED_STATE;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_device_info(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  struct cxlmi_cmd_get_device_info *rsp = out;
+
+  rsp->device_id = 0xe000;
+  rsp->revision_id = 1;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ddr_bw(struct emu_dev *d, const void *in, void *out,
+                      size_t out_sz) {
+  const struct cxlmi_cmd_get_ddr_bw_req *req = in;
+  struct cxlmi_cmd_get_ddr_bw_rsp *rsp = out;
+
+  if (!req->iterations)
+    return CXLMI_RET_INPUT;
+  rsp->peak_bw[DDR_CTRL0] = 25.6f;
+  rsp->peak_bw[DDR_CTRL1] = 25.4f;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_margin_run(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  const struct cxlmi_cmd_ddr_margin_run *req = in;
+
+  if (req->ddr_id >= DDR_MAX_SUBSYS || req->slice_num >= DDR_MAX_SLICE)
+    return CXLMI_RET_INPUT;
+  if (emu_bg_running(d, EMU_BG_MARGIN))
+    return CXLMI_RET_BUSY;
+  emu_bg_start(d, EMU_BG_MARGIN);
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_margin_status(struct emu_dev *d, const void *in, void *out,
+                             size_t out_sz) {
+  struct cxlmi_cmd_ddr_margin_status *rsp = out;
+
+  rsp->run_status = emu_bg_running(d, EMU_BG_MARGIN);
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_margin_get(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  struct cxlmi_cmd_ddr_margin_get *rsp = out;
+  size_t fit = (out_sz - sizeof(rsp->row_count)) /
+               sizeof(rsp->ddr_margin_slice_data[0]);
+  struct ddr_margin_info *row;
+  uint32_t i, rows = DDR_MAX_SLICE * MAX_MARGIN_BIT_COUNT;
+
+  if (emu_bg_running(d, EMU_BG_MARGIN))
+    return CXLMI_RET_BUSY;
+  if (!d->bg[EMU_BG_MARGIN].done)
+    return CXLMI_RET_INPUT;
+
+  /* the response is cut to payload_max, like on the device */
+  if (rows > fit)
+    rows = fit;
+  rsp->row_count = rows;
+  for (i = 0; i < rows; i++) {
+    row = &rsp->ddr_margin_slice_data[i];
+    row->slicenumber = i / MAX_MARGIN_BIT_COUNT;
+    row->bitnumber = i % MAX_MARGIN_BIT_COUNT;
+    row->vreflevel = 64;
+    row->margin_low = -20 - (int)(i % 5);
+    row->margin_high = 22 + (int)(i % 3);
+    row->min_delay_ps = row->margin_low * 1.5;
+    row->max_delay_ps = row->margin_high * 1.5;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_reboot_mode_set(struct emu_dev *d, const void *in, void *out,
+                               size_t out_sz) {
+  const struct cxlmi_cmd_reboot_mode_set *req = in;
+
+  if (req->reboot_mode != CXL_IO_MEM_MODE && req->reboot_mode != CXL_IO_MODE)
+    return CXLMI_RET_INPUT;
+  d->reboot_mode = req->reboot_mode;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_boot_mode_get(struct emu_dev *d, const void *in, void *out,
+                             size_t out_sz) {
+  struct cxlmi_cmd_curr_cxl_boot_mode_get *rsp = out;
+
+  rsp->curr_cxl_boot = d->reboot_mode;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ecc_err_info(struct emu_dev *d, const void *in, void *out,
+                            size_t out_sz) {
+  memcpy(out, &d->ecc, sizeof(d->ecc));
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_i2c_read(struct emu_dev *d, const void *in, void *out,
+                        size_t out_sz) {
+  const struct cxlmi_cmd_i2c_read_req *req = in;
+  struct cxlmi_cmd_i2c_read_rsp *rsp = out;
+  int i;
+
+  if (req->num_bytes > I2C_MAX_SIZE_NUM_BYTES)
+    return CXLMI_RET_INPUT;
+  for (i = 0; i < req->num_bytes; i++)
+    rsp->buf[i] = d->i2c[(uint8_t)(req->reg_addr + i)];
+  rsp->num_bytes = req->num_bytes;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_i2c_write(struct emu_dev *d, const void *in, void *out,
+                         size_t out_sz) {
+  const struct cxlmi_cmd_i2c_write *req = in;
+
+  d->i2c[req->reg_addr] = req->data;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ddr_latency(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  struct cxlmi_cmd_get_ddr_latency_rsp *rsp = out;
+  struct ddr_lat_op *op;
+  int i;
+
+  for (i = 0; i < DDR_MAX_SUBSYS; i++) {
+    op = &rsp->ddr_lat_op[i];
+    op->rdsamplecnt = 100000;
+    op->wrsamplecnt = 50000;
+    op->readlat = (uint64_t)op->rdsamplecnt * (95 + i);
+    op->writelat = (uint64_t)op->wrsamplecnt * (80 + i);
+    op->avg_rdlatency = 95.0f + i;
+    op->avg_wrlatency = 80.0f + i;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_zero(struct emu_dev *d, const void *in, void *out,
+                    size_t out_sz) {
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_hpa_to_dpa(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  const struct cxlmi_cmd_hpa_to_dpa_req *req = in;
+  struct cxlmi_cmd_hpa_to_dpa_rsp *rsp = out;
+
+  /* 64GB device, decoded at any 64GB aligned window */
+  rsp->dpa_address = req->hpa_address & ((1ULL << 36) - 1);
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_scrub_start(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  if (emu_bg_running(d, EMU_BG_SCRUB))
+    return CXLMI_RET_BUSY;
+  emu_bg_start(d, EMU_BG_SCRUB);
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_scrub_status(struct emu_dev *d, const void *in, void *out,
+                            size_t out_sz) {
+  struct cxlmi_cmd_ddr_ecc_scrub_status *rsp = out;
+  int i;
+
+  for (i = 0; i < DDR_MAX_SUBSYS; i++)
+    rsp->ecc_scrub_status[i] = emu_bg_running(d, EMU_BG_SCRUB);
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_init_status(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  struct cxlmi_cmd_ddr_init_status *rsp = out;
+
+  rsp->init_status.ddr_init_status = DDR_INIT_PASSED;
+  rsp->init_status.failed_channel_id = CH_NA;
+  rsp->init_status.failed_dimm_silk_screen = ' ';
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_membridge_stats(struct emu_dev *d, const void *in, void *out,
+                               size_t out_sz) {
+  struct cxlmi_cmd_get_membridge_stats *rsp = out;
+  uint64_t us = (cxlmi_timing_now() - d->boot_ns) / 1000;
+
+  /* a steady 2:1 read/write load since power on */
+  rsp->m2s_req_count = us * 2;
+  rsp->m2s_rwd_count = us;
+  rsp->s2m_drs_count = us * 2;
+  rsp->s2m_ndr_count = us;
+  rsp->m2s_rwd_credit_count = 32;
+  rsp->m2s_req_credit_count = 32;
+  rsp->s2m_ndr_credit_count = 32;
+  rsp->s2m_drc_credit_count = 32;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ddr_err_inj(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  const struct cxlmi_cmd_ddr_err_inj_en *req = in;
+  struct ddr_ecc_err *ecc;
+  uint32_t cnt;
+
+  if (req->ddr_id >= DDR_MAX_SUBSYS)
+    return CXLMI_RET_INPUT;
+
+  /* err_type 0 is a correctable error, anything else uncorrectable */
+  ecc = &d->ecc.ddr_ctrl_err[req->ddr_id].ecc;
+  if (req->err_type == 0) {
+    ecc->ecc_warn_bit0_cnt++;
+    cnt = le32_to_cpu(d->health.num_ddr_correctable_ecc_errors);
+    d->health.num_ddr_correctable_ecc_errors = cpu_to_le32(cnt + 1);
+  } else {
+    ecc->ecc_crit_bit2_cnt++;
+    cnt = le32_to_cpu(d->health.num_ddr_uncorrectable_ecc_errors);
+    d->health.num_ddr_uncorrectable_ecc_errors = cpu_to_le32(cnt + 1);
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_coredump(struct emu_dev *d, const void *in, void *out,
+                        size_t out_sz) {
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_stats_run(struct emu_dev *d, const void *in, void *out,
+                         size_t out_sz) {
+  const struct cxlmi_cmd_ddr_stats_run *req = in;
+
+  if (req->ddr_id >= DDR_MAX_SUBSYS || !req->loop_count)
+    return CXLMI_RET_INPUT;
+  if (emu_bg_running(d, EMU_BG_STATS))
+    return CXLMI_RET_BUSY;
+  d->stats_loops = req->loop_count;
+  emu_bg_start(d, EMU_BG_STATS);
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_stats_status(struct emu_dev *d, const void *in, void *out,
+                            size_t out_sz) {
+  struct cxlmi_cmd_ddr_stats_status *rsp = out;
+
+  rsp->run_status = emu_bg_running(d, EMU_BG_STATS);
+  rsp->loop_count = d->stats_loops;
+  return CXLMI_RET_SUCCESS;
+}
+
+/* Sample 'loop' of a stats run; every counter is a function of its index */
+static void emu_stats_sample(uint32_t loop, ddr_stats_data_t *s) {
+  uint8_t *p = (uint8_t *)s;
+  uint32_t w;
+  size_t i;
+
+  /* a word at a time, ddr_stats_data_t is packed */
+  for (i = 0; i < sizeof(*s) / sizeof(w); i++) {
+    w = (loop + 1) * 1000 + i;
+    memcpy(p + i * sizeof(w), &w, sizeof(w));
+  }
+  s->stats.pmon.fr_cnt = (loop + 1) * 100000000ULL;
+  s->stats.pmon.rd_avg_lat = 90 + loop % 10;
+  s->stats.pmon.wr_avg_lat = 70 + loop % 10;
+}
+
+static int emu_stats_get(struct emu_dev *d, const void *in, void *out,
+                         size_t out_sz) {
+  const struct cxlmi_cmd_ddr_stats_get_req *req = in;
+  uint64_t total = (uint64_t)d->stats_loops * sizeof(ddr_stats_data_t);
+  uint64_t pos = req->offset, end = pos + req->transfer_sz;
+  ddr_stats_data_t s;
+  uint8_t *dst = out;
+  size_t n, skip;
+
+  if (emu_bg_running(d, EMU_BG_STATS))
+    return CXLMI_RET_BUSY;
+  if (!d->bg[EMU_BG_STATS].done || end > total || req->transfer_sz > out_sz)
+    return CXLMI_RET_INPUT;
+
+  while (pos < end) {
+    skip = pos % sizeof(s);
+    n = sizeof(s) - skip;
+    if (n > end - pos)
+      n = end - pos;
+    emu_stats_sample(pos / sizeof(s), &s);
+    memcpy(dst, (uint8_t *)&s + skip, n);
+    dst += n;
+    pos += n;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_param_set(struct emu_dev *d, const void *in, void *out,
+                         size_t out_sz) {
+  const struct cxlmi_cmd_ddr_param_set *req = in;
+
+  d->ddr_inter = req->ddr_inter;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_param_get(struct emu_dev *d, const void *in, void *out,
+                         size_t out_sz) {
+  struct cxlmi_cmd_ddr_param_get *rsp = out;
+
+  rsp->ddr_inter = d->ddr_inter;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ll_err_inj(struct emu_dev *d, const void *in, void *out,
+                          size_t out_sz) {
+  const struct cxlmi_cmd_mem_ll_err_inj_en *req = in;
+
+  if (req->en_dis) {
+    d->cxl_err.total_err_cnt++;
+    d->cxl_err.total_corr_err_cnt++;
+    d->cxl_err.corr_err[0]++;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_pci_err_inj(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  const struct cxlmi_cmd_pci_err_inj_en *req = in;
+
+  if (req->en_dis) {
+    d->cxl_err.total_err_cnt += req->count ? req->count : 1;
+    d->cxl_err.total_corr_err_cnt += req->count ? req->count : 1;
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_core_volt_set(struct emu_dev *d, const void *in, void *out,
+                             size_t out_sz) {
+  const struct cxlmi_cmd_core_volt_set *req = in;
+
+  if (req->core_volt < 0.7f || req->core_volt > 1.0f)
+    return CXLMI_RET_INPUT;
+  d->core_volt = req->core_volt;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_core_volt_get(struct emu_dev *d, const void *in, void *out,
+                             size_t out_sz) {
+  struct cxlmi_cmd_core_volt_get *rsp = out;
+
+  rsp->core_volt = d->core_volt;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_cont_scrub_status(struct emu_dev *d, const void *in, void *out,
+                                 size_t out_sz) {
+  struct cxlmi_cmd_ddr_cont_scrub_status *rsp = out;
+
+  rsp->cont_scrub_status = d->cont_scrub;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_cont_scrub_set(struct emu_dev *d, const void *in, void *out,
+                              size_t out_sz) {
+  const struct cxlmi_cmd_ddr_cont_scrub_set *req = in;
+
+  d->cont_scrub = req->cont_scrub_status;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_page_select_set(struct emu_dev *d, const void *in, void *out,
+                               size_t out_sz) {
+  const struct cxlmi_cmd_ddr_page_select_set *req = in;
+
+  d->page_policy = req->pp_select.page_policy_reg_val;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_page_select_get(struct emu_dev *d, const void *in, void *out,
+                               size_t out_sz) {
+  struct cxlmi_cmd_ddr_page_select_get *rsp = out;
+
+  rsp->pp_select.page_policy_reg_val = d->page_policy;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_hppr_set(struct emu_dev *d, const void *in, void *out,
+                        size_t out_sz) {
+  const struct cxlmi_cmd_ddr_hppr_set *req = in;
+
+  d->hppr_enable[0] = req->enable & 0xff;
+  d->hppr_enable[1] = req->enable >> 8;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_hppr_get(struct emu_dev *d, const void *in, void *out,
+                        size_t out_sz) {
+  struct cxlmi_cmd_ddr_hppr_get *rsp = out;
+
+  memcpy(rsp->hppr_enable, d->hppr_enable, sizeof(rsp->hppr_enable));
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_hppr_addr_set(struct emu_dev *d, const void *in, void *out,
+                             size_t out_sz) {
+  const struct cxlmi_cmd_ddr_hppr_addr_info_set *req = in;
+  const struct _ddr_addr_info_in *a = &req->hppr_addr_info;
+  struct _ddr_addr_info_out *slot;
+  int i;
+
+  if (a->ddr_id >= DDR_MAX_SUBSYS)
+    return CXLMI_RET_INPUT;
+
+  /* chip selects 0-1 sit on channel 0, 2-3 on channel 1 */
+  for (i = 0; i < 8; i++) {
+    slot = &d->hppr_addr[a->ddr_id][i];
+    if (slot->ppr_state)
+      continue;
+    slot->ddr_id = a->ddr_id;
+    slot->chip_select = a->chip_select;
+    slot->bank = a->bank;
+    slot->bank_group = a->bank_group;
+    slot->row = a->row;
+    slot->channel = (a->chip_select >> 1) & 1;
+    slot->ppr_state = 1;
+    return CXLMI_RET_SUCCESS;
+  }
+  /* all repair resources of this controller are taken */
+  return CXLMI_RET_BUSY;
+}
+
+static int emu_hppr_addr_get(struct emu_dev *d, const void *in, void *out,
+                             size_t out_sz) {
+  struct cxlmi_cmd_ddr_hppr_addr_info_get *rsp = out;
+
+  memcpy(rsp->hppr_addr_info, d->hppr_addr, sizeof(rsp->hppr_addr_info));
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_hppr_addr_clear(struct emu_dev *d, const void *in, void *out,
+                               size_t out_sz) {
+  const struct cxlmi_cmd_ddr_hppr_addr_info_clear *req = in;
+  int i;
+
+  if (req->ddr_id >= DDR_MAX_SUBSYS || req->channel_id > 1)
+    return CXLMI_RET_INPUT;
+  for (i = 0; i < 8; i++) {
+    if (d->hppr_addr[req->ddr_id][i].channel == req->channel_id)
+      memset(&d->hppr_addr[req->ddr_id][i], 0, sizeof(d->hppr_addr[0][0]));
+  }
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_refresh_set(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  const struct cxlmi_cmd_ddr_refresh_mode_set *req = in;
+
+  d->refresh_mode = req->ddr_refresh_val;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_refresh_get(struct emu_dev *d, const void *in, void *out,
+                           size_t out_sz) {
+  struct cxlmi_cmd_ddr_refresh_mode_get *rsp = out;
+
+  rsp->ddr_refresh_val = d->refresh_mode;
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_cxl_err_cntr(struct emu_dev *d, const void *in, void *out,
+                            size_t out_sz) {
+  memcpy(out, &d->cxl_err, sizeof(d->cxl_err));
+  return CXLMI_RET_SUCCESS;
+}
+
+static int emu_ddr_freq(struct emu_dev *d, const void *in, void *out,
+                        size_t out_sz) {
+  struct cxlmi_cmd_ddr_freq_get *rsp = out;
+
+  rsp->ddr_freq = 5600.0f;
+  return CXLMI_RET_SUCCESS;
+}
+
+#define EMU_CMD(set, cmd, req, rsp, fn)                                        \
+  { EMU_OPCODE(set, cmd), req, rsp, fn }
+#define EMU_OEM(cmd, req, rsp, fn)                                             \
+  EMU_CMD(VENDOR_CMD_OEM_MGMT, cmd, req, rsp, fn)
+#define EMU_DIMM(cmd, req, rsp, fn)                                            \
+  EMU_CMD(VENDOR_CMD_DDR_DIMM_MGMT, cmd, req, rsp, fn)
+#define EMU_HEALTH(cmd, req, rsp, fn)                                          \
+  EMU_CMD(VENDOR_CMD_HEALTH_MGMT, cmd, req, rsp, fn)
+#define EMU_OTHER(cmd, req, rsp, fn)                                           \
+  EMU_CMD(VENDOR_CMD_OTHERS, cmd, req, rsp, fn)
+
+/* Minimum request and response payload sizes; 0 response means variable */
+static const struct emu_cmd {
+  uint16_t opcode;
+  size_t in_sz;
+  size_t out_sz;
+  emu_handler fn;
+} emu_cmds[] = {
+    EMU_OEM(OEM_HBO_STATUS, 0, sizeof(struct cxlmi_cmd_hbo_status_out),
+            emu_hbo_status),
+    EMU_OEM(TRANSFER_FW, sizeof(struct cxlmi_cmd_transfer_fw), 0,
+            emu_transfer_fw),
+    EMU_OEM(ACTIVATE_FW, sizeof(struct cxlmi_cmd_activate_fw), 0,
+            emu_activate_fw),
+    EMU_OEM(GET_OS_INFO, 0, sizeof(struct cxlmi_cmd_get_fw_info),
+            emu_get_os_info),
+    EMU_OEM(TRANSFER_OS, sizeof(struct cxlmi_cmd_transfer_fw), 0,
+            emu_transfer_os),
+
+    EMU_DIMM(DIMM_SPD_READ, sizeof(struct cxlmi_cmd_dimm_spd_read_req),
+             sizeof(struct cxlmi_cmd_dimm_spd_read_rsp), emu_spd_read),
+    EMU_DIMM(DIMM_SLOT_INFO, 0, sizeof(struct cxlmi_cmd_dimm_slot_info),
+             emu_slot_info),
+    EMU_DIMM(READ_DDR_TEMP, 0, sizeof(struct cxlmi_cmd_read_ddr_temp),
+             emu_ddr_temp),
+
+    EMU_HEALTH(HEALTH_COUNTERS_CLEAR,
+               sizeof(struct cxlmi_cmd_health_counters_clear), 0,
+               emu_health_clear),
+    EMU_HEALTH(HEALTH_COUNTERS_GET, 0,
+               sizeof(struct cxlmi_cmd_health_counters_get), emu_health_get),
+
+    EMU_OTHER(PMIC_VTMON_INFO, 0, sizeof(struct cxlmi_cmd_pmic_vtmon_info),
+              emu_pmic_vtmon),
+    EMU_OTHER(READ_LTSSM_STATES, 0, sizeof(struct cxlmi_cmd_read_ltssm_states),
+              emu_ltssm),
+    EMU_OTHER(PCIE_EYE_RUN, sizeof(struct cxlmi_cmd_pcie_eye_run_req),
+              sizeof(struct cxlmi_cmd_pcie_eye_run_rsp), emu_eye_run),
+    EMU_OTHER(PCIE_EYE_STATUS, 0, sizeof(struct cxlmi_cmd_pcie_eye_status),
+              emu_eye_status),
+    EMU_OTHER(PCIE_EYE_GET_SW, sizeof(struct cxlmi_cmd_pcie_eye_get_sw_req),
+              sizeof(struct cxlmi_cmd_pcie_eye_get_sw_rsp), emu_eye_get_sw),
+    EMU_OTHER(PCIE_EYE_GET_HW, 0, sizeof(struct cxlmi_cmd_pcie_eye_get_hw),
+              emu_eye_get_hw),
+    EMU_OTHER(PCIE_EYE_GET_SW_BER, 0,
+              sizeof(struct cxlmi_cmd_pcie_eye_get_sw_ber), emu_eye_get_sw_ber),
+    EMU_OTHER(CXL_LINK_STATUS, 0, sizeof(struct cxlmi_cmd_get_cxl_link_status),
+              emu_link_status),
+    EMU_OTHER(DEVICE_INFO, 0, sizeof(struct cxlmi_cmd_get_device_info),
+              emu_device_info),
+    EMU_OTHER(GET_DDR_BW, sizeof(struct cxlmi_cmd_get_ddr_bw_req),
+              sizeof(struct cxlmi_cmd_get_ddr_bw_rsp), emu_ddr_bw),
+    EMU_OTHER(DDR_MARGIN_RUN, sizeof(struct cxlmi_cmd_ddr_margin_run), 0,
+              emu_margin_run),
+    EMU_OTHER(DDR_MARGIN_STATUS, 0, sizeof(struct cxlmi_cmd_ddr_margin_status),
+              emu_margin_status),
+    EMU_OTHER(DDR_MARGIN_GET, 0, 0, emu_margin_get),
+    EMU_OTHER(REBOOT_MODE_SET, sizeof(struct cxlmi_cmd_reboot_mode_set), 0,
+              emu_reboot_mode_set),
+    EMU_OTHER(CURR_CXL_BOOT_MODE_GET, 0,
+              sizeof(struct cxlmi_cmd_curr_cxl_boot_mode_get),
+              emu_boot_mode_get),
+    EMU_OTHER(GET_DDR_ECC_ERR_INFO, 0,
+              sizeof(struct cxlmi_cmd_get_ddr_ecc_err_info), emu_ecc_err_info),
+    EMU_OTHER(I2C_READ, sizeof(struct cxlmi_cmd_i2c_read_req),
+              sizeof(struct cxlmi_cmd_i2c_read_rsp), emu_i2c_read),
+    EMU_OTHER(I2C_WRITE, sizeof(struct cxlmi_cmd_i2c_write), 0, emu_i2c_write),
+    EMU_OTHER(GET_DDR_LATENCY, sizeof(struct cxlmi_cmd_get_ddr_latency_req),
+              sizeof(struct cxlmi_cmd_get_ddr_latency_rsp), emu_ddr_latency),
+    EMU_OTHER(GET_MEMBRIDGE_ERRORS, 0,
+              sizeof(struct cxlmi_cmd_get_membridge_errors), emu_zero),
+    EMU_OTHER(HPA_TO_DPA, sizeof(struct cxlmi_cmd_hpa_to_dpa_req),
+              sizeof(struct cxlmi_cmd_hpa_to_dpa_rsp), emu_hpa_to_dpa),
+    EMU_OTHER(START_DDR_ECC_SCRUB, 0, 0, emu_scrub_start),
+    EMU_OTHER(DDR_ECC_SCRUB_STATUS, 0,
+              sizeof(struct cxlmi_cmd_ddr_ecc_scrub_status), emu_scrub_status),
+    EMU_OTHER(DDR_INIT_STATUS, 0, sizeof(struct cxlmi_cmd_ddr_init_status),
+              emu_init_status),
+    EMU_OTHER(GET_MEMBRIDGE_STATS, 0,
+              sizeof(struct cxlmi_cmd_get_membridge_stats),
+              emu_membridge_stats),
+    EMU_OTHER(DDR_ERR_INJ_EN, sizeof(struct cxlmi_cmd_ddr_err_inj_en), 0,
+              emu_ddr_err_inj),
+    EMU_OTHER(TRIGGER_COREDUMP, 0, 0, emu_coredump),
+    EMU_OTHER(DDR_STATS_RUN, sizeof(struct cxlmi_cmd_ddr_stats_run), 0,
+              emu_stats_run),
+    EMU_OTHER(DDR_STATS_STATUS, 0, sizeof(struct cxlmi_cmd_ddr_stats_status),
+              emu_stats_status),
+    EMU_OTHER(DDR_STATS_GET, sizeof(struct cxlmi_cmd_ddr_stats_get_req), 0,
+              emu_stats_get),
+    EMU_OTHER(DDR_PARAM_SET, sizeof(struct cxlmi_cmd_ddr_param_set), 0,
+              emu_param_set),
+    EMU_OTHER(DDR_PARAM_GET, 0, sizeof(struct cxlmi_cmd_ddr_param_get),
+              emu_param_get),
+    EMU_OTHER(DIMM_LEVEL_TRAINING_STATUS, 0,
+              sizeof(struct cxlmi_cmd_dimm_level_training_status), emu_zero),
+    EMU_OTHER(CXL_VIRAL_INJ_EN, sizeof(struct cxlmi_cmd_viral_inj_en), 0,
+              emu_zero),
+    EMU_OTHER(CXL_MEM_LL_ERR_INJ_EN, sizeof(struct cxlmi_cmd_mem_ll_err_inj_en),
+              0, emu_ll_err_inj),
+    EMU_OTHER(CXL_IO_LL_ERR_INJ_EN, sizeof(struct cxlmi_cmd_mem_ll_err_inj_en),
+              0, emu_ll_err_inj),
+    EMU_OTHER(CXL_PHY_ERR_INJ_EN, sizeof(struct cxlmi_cmd_mem_ll_err_inj_en), 0,
+              emu_ll_err_inj),
+    EMU_OTHER(PCI_RAS_DES_ERR_INJ_EN, sizeof(struct cxlmi_cmd_pci_err_inj_en),
+              0, emu_pci_err_inj),
+    EMU_OTHER(CORE_VOLT_SET, sizeof(struct cxlmi_cmd_core_volt_set), 0,
+              emu_core_volt_set),
+    EMU_OTHER(CORE_VOLT_GET, 0, sizeof(struct cxlmi_cmd_core_volt_get),
+              emu_core_volt_get),
+    EMU_OTHER(DDR_CONT_SCRUB_STATUS, 0,
+              sizeof(struct cxlmi_cmd_ddr_cont_scrub_status),
+              emu_cont_scrub_status),
+    EMU_OTHER(DDR_CONT_SCRUB_SET, sizeof(struct cxlmi_cmd_ddr_cont_scrub_set),
+              0, emu_cont_scrub_set),
+    EMU_OTHER(DDR_PAGE_SELECT_SET, sizeof(struct cxlmi_cmd_ddr_page_select_set),
+              0, emu_page_select_set),
+    EMU_OTHER(DDR_PAGE_SELECT_GET, 0,
+              sizeof(struct cxlmi_cmd_ddr_page_select_get),
+              emu_page_select_get),
+    EMU_OTHER(DDR_HPPR_SET, sizeof(struct cxlmi_cmd_ddr_hppr_set), 0,
+              emu_hppr_set),
+    EMU_OTHER(DDR_HPPR_GET, 0, sizeof(struct cxlmi_cmd_ddr_hppr_get),
+              emu_hppr_get),
+    EMU_OTHER(DDR_HPPR_ADDR_INFO_SET,
+              sizeof(struct cxlmi_cmd_ddr_hppr_addr_info_set), 0,
+              emu_hppr_addr_set),
+    EMU_OTHER(DDR_HPPR_ADDR_INFO_GET, 0,
+              sizeof(struct cxlmi_cmd_ddr_hppr_addr_info_get),
+              emu_hppr_addr_get),
+    EMU_OTHER(DDR_HPPR_ADDR_INFO_CLEAR,
+              sizeof(struct cxlmi_cmd_ddr_hppr_addr_info_clear), 0,
+              emu_hppr_addr_clear),
+    EMU_OTHER(DDR_PPR_GET_STATUS, 0,
+              sizeof(struct cxlmi_cmd_ddr_ppr_get_status), emu_zero),
+    EMU_OTHER(DDR_REFRESH_MODE_SET,
+              sizeof(struct cxlmi_cmd_ddr_refresh_mode_set), 0,
+              emu_refresh_set),
+    EMU_OTHER(DDR_REFRESH_MODE_GET, 0,
+              sizeof(struct cxlmi_cmd_ddr_refresh_mode_get), emu_refresh_get),
+    EMU_OTHER(CXL_ERR_CNTR_GET, 0, sizeof(struct cxlmi_cmd_cxl_err_cntr_get),
+              emu_cxl_err_cntr),
+    EMU_OTHER(DDR_FREQUENCY_GET, 0, sizeof(struct cxlmi_cmd_ddr_freq_get),
+              emu_ddr_freq),
+    EMU_OTHER(DDR_INIT_ERR_INFO_GET, 0,
+              sizeof(struct cxlmi_cmd_ddr_init_err_info_get), emu_zero),
+};
+
+static uint64_t emu_latency(uint16_t opcode) {
+  int i;
+
+  for (i = 0; i < emu_cfg.nr_lat; i++) {
+    if (emu_cfg.lat[i].opcode == opcode)
+      return emu_cfg.lat[i].ns;
+  }
+  return emu_cfg.lat_ns;
+}
+
+static void emu_sleep(uint64_t ns) {
+  struct timespec ts = {
+      .tv_sec = ns / 1000000000ULL,
+      .tv_nsec = ns % 1000000000ULL,
+  };
+
+  while (ns && nanosleep(&ts, &ts) && errno == EINTR)
+    ;
+}
+
+CXLMI_EXPORT int cxlmi_emu_send(struct cxlmi_endpoint *ep,
+                                struct cxlmi_cci_msg *req, size_t req_sz,
+                                struct cxlmi_cci_msg *rsp, size_t rsp_sz) {
+  struct emu_dev *d = emu_dev_of(ep);
+  uint16_t opcode = EMU_OPCODE(req->command_set, req->command);
+  size_t in_sz = req_sz - sizeof(*req), out_sz = rsp_sz - sizeof(*rsp);
+  const struct emu_cmd *c = NULL;
+  size_t i;
+  int rc;
+
+  if (!d || req_sz < sizeof(*req) || rsp_sz < sizeof(*rsp))
+    return -EINVAL;
+
+  for (i = 0; i < ARRAY_SIZE(emu_cmds); i++) {
+    if (emu_cmds[i].opcode == opcode) {
+      c = &emu_cmds[i];
+      break;
+    }
+  }
+
+  memset(rsp, 0, rsp_sz);
+  rsp->command_set = req->command_set;
+  rsp->command = req->command;
+
+  /* the mailbox is serialized per device, sleeping under the lock is too */
+  pthread_mutex_lock(&d->lock);
+  emu_sleep(emu_latency(opcode));
+  if (!c)
+    rc = CXLMI_RET_UNSUPPORTED;
+  else if (in_sz < c->in_sz || out_sz < c->out_sz)
+    rc = CXLMI_RET_INPUT;
+  else
+    rc = c->fn(d, req->payload, rsp->payload, out_sz);
+  pthread_mutex_unlock(&d->lock);
+
+  rsp->return_code = cpu_to_le16(rc);
+  if (rc == CXLMI_RET_SUCCESS) {
+    rsp->pl_length[0] = out_sz & 0xff;
+    rsp->pl_length[1] = (out_sz >> 8) & 0xff;
+    rsp->pl_length[2] = (out_sz >> 16) & 0xff;
+  }
+  return rc;
+}
@@ -0,0 +1,112 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+/* std includes */
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+#include <libcxlmi.h>
+
+/* vendor includes */
+#include <vendor_commands.h>
+#include <vendor_poll.h>
+#include <vendor_timing.h>
+
+#define HBO_POLL_MIN_MS 1
+#define HBO_POLL_MAX_MS 500
+
+CXLMI_EXPORT void cxlmi_backoff_init(struct cxlmi_backoff *b, uint32_t min_ms,
+                                     uint32_t max_ms, uint32_t timeout_ms) {
+  b->deadline_ns = cxlmi_timing_now() + timeout_ms * 1000000ULL;
+  b->min_ms = min_ms ? min_ms : 1;
+  b->max_ms = max_ms > b->min_ms ? max_ms : b->min_ms;
+  b->cur_ms = b->min_ms;
+  /* so that --jobs workers retrying the same thing spread out */
+  b->seed = (unsigned int)b->deadline_ns ^ ((unsigned int)getpid() << 16);
+}
+
+CXLMI_EXPORT void cxlmi_backoff_reset(struct cxlmi_backoff *b) {
+  b->cur_ms = b->min_ms;
+}
+
+CXLMI_EXPORT int cxlmi_backoff_wait(struct cxlmi_backoff *b) {
+  uint64_t now = cxlmi_timing_now(), ns;
+  struct timespec ts;
+
+  if (now >= b->deadline_ns)
+    return -ETIMEDOUT;
+
+  ns = (b->cur_ms - b->cur_ms / 2 + rand_r(&b->seed) % (b->cur_ms / 2 + 1)) *
+       1000000ULL;
+  if (ns > b->deadline_ns - now)
+    ns = b->deadline_ns - now;
+
+  ts.tv_sec = ns / 1000000000ULL;
+  ts.tv_nsec = ns % 1000000000ULL;
+  while (nanosleep(&ts, &ts) && errno == EINTR)
+    ;
+
+  b->cur_ms = b->cur_ms * 2 < b->max_ms ? b->cur_ms * 2 : b->max_ms;
+  return 0;
+}
+
+CXLMI_EXPORT bool cxlmi_ret_transient(int rc) {
+  switch (rc) {
+  case CXLMI_RET_BUSY:
+  case CXLMI_RET_RETRY:
+  case -EAGAIN:
+  case -ETIMEDOUT:
+  case -EIO:
+    return true;
+  default:
+    return false;
+  }
+}
+
+CXLMI_EXPORT int
+cxlmi_hbo_wait_count(struct cxlmi_endpoint *ep, struct cxlmi_tunnel_info *ti,
+                     uint32_t timeout_ms,
+                     struct cxlmi_cmd_hbo_status_fields *status,
+                     uint32_t *polls) {
+  struct cxlmi_cmd_hbo_status_fields st = {};
+  struct cxlmi_backoff b;
+  int rc, last_percent = -1;
+
+  cxlmi_backoff_init(&b, HBO_POLL_MIN_MS, HBO_POLL_MAX_MS, timeout_ms);
+  for (;;) {
+    /* 1 while is_running is set */
+    rc = cxlmi_cmd_get_hbo_status(ep, ti, &st);
+    if (polls)
+      (*polls)++;
+    if (rc == 0)
+      break;
+    if (rc != 1 && !cxlmi_ret_transient(rc))
+      goto out;
+
+    /* moving along, keep polling at a short interval */
+    if (rc == 1 && st.percent_complete != last_percent) {
+      last_percent = st.percent_complete;
+      cxlmi_backoff_reset(&b);
+    }
+    if (cxlmi_backoff_wait(&b)) {
+      rc = -ETIMEDOUT;
+      goto out;
+    }
+  }
+
+  rc = st.return_code;
+out:
+  if (status)
+    *status = st;
+  return rc;
+}
+
+CXLMI_EXPORT int cxlmi_hbo_wait(struct cxlmi_endpoint *ep,
+                                struct cxlmi_tunnel_info *ti,
+                                uint32_t timeout_ms,
+                                struct cxlmi_cmd_hbo_status_fields *status) {
+  return cxlmi_hbo_wait_count(ep, ti, timeout_ms, status, NULL);
+}
@@ -0,0 +1,242 @@
+// (c) Meta Platforms, Inc. and affiliates. Confidential and proprietary.
+
+/* std includes */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+/* libcxlmi includes */
+#include <cxlmi/private.h>
+
+/* vendor includes */
+#include <vendor_timing.h>
+
+#define TIMING_SLOTS 256
+
+enum {
+  TIMING_SLOT_FREE,
+  TIMING_SLOT_BUSY,
+  TIMING_SLOT_READY,
+};
+
+struct timing_slot {
+  uint32_t state;
+  uint8_t phase;
+  uint16_t opcode;
+  char name[CXLMI_TIMING_NAME_MAX];
+  uint64_t count;
+  uint64_t sum_ns;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  uint64_t buckets[CXLMI_TIMING_BUCKETS];
+};
+
+static const char *const timing_phase_str[CXLMI_TIMING_NR] = {
+    [CXLMI_TIMING_CMD] = "cmd",
+    [CXLMI_TIMING_OPEN] = "open",
+    [CXLMI_TIMING_MBOX] = "mbox",
+    [CXLMI_TIMING_HOST] = "host",
+};
+
+static struct timing_slot *timing_tbl;
+/* added to from async queue workers as well, atomics only */
+static uint64_t timing_mbox_total;
+
+CXLMI_EXPORT int cxlmi_timing_init(void) {
+  void *p;
+
+  if (timing_tbl)
+    return 0;
+
+  p = mmap(NULL, TIMING_SLOTS * sizeof(*timing_tbl), PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return -errno;
+
+  timing_tbl = p;
+  return 0;
+}
+
+CXLMI_EXPORT uint64_t cxlmi_timing_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int timing_hash(uint8_t phase, uint16_t opcode,
+                                const char *name) {
+  unsigned int h = 2166136261u;
+
+  h = (h ^ phase) * 16777619u;
+  h = (h ^ (opcode & 0xff)) * 16777619u;
+  h = (h ^ (opcode >> 8)) * 16777619u;
+  while (name && *name)
+    h = (h ^ (unsigned char)*name++) * 16777619u;
+
+  return h;
+}
+
+static bool timing_slot_match(struct timing_slot *s, uint8_t phase,
+                              uint16_t opcode, const char *name) {
+  return s->phase == phase && s->opcode == opcode &&
+         strncmp(s->name, name ? name : "", sizeof(s->name) - 1) == 0;
+}
+
+/* Find or claim the slot for a key; slots are never released */
+static struct timing_slot *timing_slot_get(uint8_t phase, uint16_t opcode,
+                                           const char *name) {
+  unsigned int h = timing_hash(phase, opcode, name);
+  struct timing_slot *s;
+  uint32_t state;
+  int i;
+
+  for (i = 0; i < TIMING_SLOTS; i++) {
+    s = &timing_tbl[(h + i) % TIMING_SLOTS];
+    state = __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);
+
+    if (state == TIMING_SLOT_FREE) {
+      if (__atomic_compare_exchange_n(&s->state, &state, TIMING_SLOT_BUSY,
+                                      false, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE)) {
+        s->phase = phase;
+        s->opcode = opcode;
+        snprintf(s->name, sizeof(s->name), "%s", name ? name : "");
+        s->min_ns = UINT64_MAX;
+        __atomic_store_n(&s->state, TIMING_SLOT_READY, __ATOMIC_RELEASE);
+        return s;
+      }
+    }
+
+    /* somebody else is filling in this slot, it is only a few stores */
+    while (state == TIMING_SLOT_BUSY)
+      state = __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);
+
+    if (timing_slot_match(s, phase, opcode, name))
+      return s;
+  }
+
+  /* table full, drop the sample */
+  return NULL;
+}
+
+static int timing_bucket(uint64_t ns) {
+  int b = ns ? 63 - __builtin_clzll(ns) : 0;
+
+  return b < CXLMI_TIMING_BUCKETS ? b : CXLMI_TIMING_BUCKETS - 1;
+}
+
+CXLMI_EXPORT void cxlmi_timing_record(enum cxlmi_timing_phase phase,
+                                      uint16_t opcode, const char *name,
+                                      uint64_t ns) {
+  struct timing_slot *s;
+  uint64_t old;
+
+  if (phase == CXLMI_TIMING_MBOX)
+    __atomic_fetch_add(&timing_mbox_total, ns, __ATOMIC_RELAXED);
+
+  if (!timing_tbl && cxlmi_timing_init())
+    return;
+
+  s = timing_slot_get(phase, opcode, name);
+  if (!s)
+    return;
+
+  __atomic_fetch_add(&s->count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&s->sum_ns, ns, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&s->buckets[timing_bucket(ns)], 1, __ATOMIC_RELAXED);
+
+  old = __atomic_load_n(&s->min_ns, __ATOMIC_RELAXED);
+  while (ns < old &&
+         !__atomic_compare_exchange_n(&s->min_ns, &old, ns, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+  old = __atomic_load_n(&s->max_ns, __ATOMIC_RELAXED);
+  while (ns > old &&
+         !__atomic_compare_exchange_n(&s->max_ns, &old, ns, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+CXLMI_EXPORT uint64_t cxlmi_timing_mbox_ns(void) {
+  return __atomic_load_n(&timing_mbox_total, __ATOMIC_RELAXED);
+}
+
+static const char *timing_fmt(char *buf, size_t len, uint64_t ns) {
+  if (ns < 1000ULL)
+    snprintf(buf, len, "%luns", (unsigned long)ns);
+  else if (ns < 1000000ULL)
+    snprintf(buf, len, "%.1fus", ns / 1e3);
+  else if (ns < 1000000000ULL)
+    snprintf(buf, len, "%.1fms", ns / 1e6);
+  else
+    snprintf(buf, len, "%.2fs", ns / 1e9);
+  return buf;
+}
+
+/* Upper bound of the bucket holding the pct-th percentile */
+static uint64_t timing_percentile(struct timing_slot *s, int pct) {
+  uint64_t want = (s->count * pct + 99) / 100, seen = 0;
+  int b;
+
+  for (b = 0; b < CXLMI_TIMING_BUCKETS; b++) {
+    seen += s->buckets[b];
+    if (seen >= want)
+      break;
+  }
+  if (b >= CXLMI_TIMING_BUCKETS - 1 || (2ULL << b) > s->max_ns)
+    return s->max_ns;
+  return 2ULL << b;
+}
+
+CXLMI_EXPORT void cxlmi_timing_dump(FILE *fp) {
+  char avg[16], min[16], max[16], p50[16], p99[16], key[48], lo[16], hi[16];
+  struct timing_slot *s;
+  int phase, i, b;
+
+  if (!timing_tbl)
+    return;
+
+  fprintf(fp, "%-5s %-32s %8s %9s %9s %9s %9s %9s\n", "phase", "key", "count",
+          "avg", "min", "max", "p50<=", "p99<=");
+
+  for (phase = 0; phase < CXLMI_TIMING_NR; phase++) {
+    for (i = 0; i < TIMING_SLOTS; i++) {
+      s = &timing_tbl[i];
+      if (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) != TIMING_SLOT_READY ||
+          s->phase != phase || !s->count)
+        continue;
+
+      if (phase == CXLMI_TIMING_MBOX)
+        snprintf(key, sizeof(key), "0x%04x", s->opcode);
+      else
+        snprintf(key, sizeof(key), "%s", s->name);
+
+      fprintf(fp, "%-5s %-32s %8lu %9s %9s %9s %9s %9s\n",
+              timing_phase_str[phase], key, (unsigned long)s->count,
+              timing_fmt(avg, sizeof(avg), s->sum_ns / s->count),
+              timing_fmt(min, sizeof(min), s->min_ns),
+              timing_fmt(max, sizeof(max), s->max_ns),
+              timing_fmt(p50, sizeof(p50), timing_percentile(s, 50)),
+              timing_fmt(p99, sizeof(p99), timing_percentile(s, 99)));
+
+      for (b = 0; b < CXLMI_TIMING_BUCKETS; b++) {
+        if (!s->buckets[b])
+          continue;
+        fprintf(fp, "      [%8s, %8s) %lu\n",
+                timing_fmt(lo, sizeof(lo), b ? 1ULL << b : 0),
+                timing_fmt(hi, sizeof(hi), 2ULL << b),
+                (unsigned long)s->buckets[b]);
+      }
+    }
+  }
+}
+
+CXLMI_EXPORT void cxlmi_timing_reset(void) {
+  if (timing_tbl)
+    memset(timing_tbl, 0, TIMING_SLOTS * sizeof(*timing_tbl));
+  __atomic_store_n(&timing_mbox_total, 0, __ATOMIC_RELAXED);
+}
@@ -112,6 +112,9 @@ extern int parse_options(int argc, const char **argv,
 extern void usage_with_options(const char *const *usagestr,
                                const struct option *options);
 
+/* Zero every option value, so a command can be parsed again in-process */
+extern void reset_options(const struct option *options);
+
 void uuid_unparse(uint8_t *uuid_arr, char *uuid_str);
 
 void uuid_parse(const char *uuid_str, uint8_t *uuid_arr);
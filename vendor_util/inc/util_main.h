@@ -33,10 +33,16 @@ struct cmd_struct {
   int (*c_fn)(int argc, const char **argv, struct cxlmi_ctx *ctx);
 };
 
+/* Called after every dispatched command with its wall time */
+typedef void (*cmd_timing_fn)(const char *cmd, uint64_t elapsed_ns);
+void main_set_cmd_timing_hook(cmd_timing_fn fn);
+
 int main_handle_options(const char ***argv, int *argc, const char *usage_msg,
                         struct cmd_struct *cmds, int num_cmds);
 void main_handle_internal_command(int argc, const char **argv, void *ctx,
                                   struct cmd_struct *cmds, int num_cmds);
+int main_run_internal_command(int argc, const char **argv, void *ctx,
+                              struct cmd_struct *cmds, int num_cmds);
 
 #ifdef __cplusplus
 }
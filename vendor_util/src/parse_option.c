@@ -725,3 +725,39 @@ int parse_options(int argc, const char **argv, const struct option *options,
   return parse_options_subcommand_prefix(argc, argv, NULL, options, NULL,
                                          (const char **)usagestr, flags);
 }
+
+void reset_options(const struct option *options) {
+  for (; options->type != OPTION_END; options++) {
+    if (!options->value)
+      continue;
+
+    switch (options->type) {
+    case OPTION_BOOLEAN:
+      *(bool *)options->value = false;
+      break;
+    case OPTION_BIT:
+    case OPTION_INCR:
+    case OPTION_INTEGER:
+      *(int *)options->value = 0;
+      break;
+    case OPTION_UINTEGER:
+      *(unsigned int *)options->value = 0;
+      break;
+    case OPTION_LONG:
+      *(long *)options->value = 0;
+      break;
+    case OPTION_U64:
+      *(uint64_t *)options->value = 0;
+      break;
+    case OPTION_STRING:
+    case OPTION_FILENAME:
+      *(const char **)options->value = NULL;
+      break;
+    default:
+      break;
+    }
+
+    if (options->set)
+      *options->set = false;
+  }
+}
@@ -10,6 +10,28 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
+
+static cmd_timing_fn cmd_timing_hook;
+
+void main_set_cmd_timing_hook(cmd_timing_fn fn) { cmd_timing_hook = fn; }
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int run_timed(struct cmd_struct *p, int argc, const char **argv,
+                     void *ctx) {
+  uint64_t start = now_ns();
+  int status = p->c_fn(argc, argv, ctx);
+
+  if (cmd_timing_hook)
+    cmd_timing_hook(p->cmd, now_ns() - start);
+  return status;
+}
 
 int main_handle_options(const char ***argv, int *argc, const char *usage_msg,
                         struct cmd_struct *cmds, int num_cmds) {
@@ -60,7 +82,7 @@ static int run_builtin(struct cmd_struct *p, int argc, const char **argv,
                        void *ctx) {
   int status;
   struct stat st;
-  status = p->c_fn(argc, argv, ctx);
+  status = run_timed(p, argc, argv, ctx);
 
   if (status)
     return status & 0xff;
@@ -91,24 +113,50 @@ out:
   return status;
 }
 
-void main_handle_internal_command(int argc, const char **argv, void *ctx,
-                                  struct cmd_struct *cmds, int num_cmds) {
-  const char *cmd = argv[0];
+static struct cmd_struct *find_internal_command(int argc, const char **argv,
+                                                struct cmd_struct *cmds,
+                                                int num_cmds) {
   int i;
 
   /* Turn "<binary> cmd --help" into "<binary> help cmd" */
   if (argc > 1 && !strcmp(argv[1], "--help")) {
     argv[1] = argv[0];
-    argv[0] = cmd = "help";
+    argv[0] = "help";
   }
 
   for (i = 0; i < num_cmds; i++) {
-    struct cmd_struct *p = cmds + i;
-    if (strcmp(p->cmd, cmd))
-      continue;
-    exit(run_builtin(p, argc, argv, ctx));
+    if (!strcmp(cmds[i].cmd, argv[0]))
+      return cmds + i;
   }
 
-  if (i == num_cmds)
-    printf("Unknown command: '%s'\r\n", argv[0]);
+  printf("Unknown command: '%s'\r\n", argv[0]);
+  return NULL;
+}
+
+void main_handle_internal_command(int argc, const char **argv, void *ctx,
+                                  struct cmd_struct *cmds, int num_cmds) {
+  struct cmd_struct *p = find_internal_command(argc, argv, cmds, num_cmds);
+
+  if (p)
+    exit(run_builtin(p, argc, argv, ctx));
+}
+
+/*
+ * Same as main_handle_internal_command(), but returns the command status
+ * and leaves stdout open, so several commands can run in one process.
+ */
+int main_run_internal_command(int argc, const char **argv, void *ctx,
+                              struct cmd_struct *cmds, int num_cmds) {
+  struct cmd_struct *p = find_internal_command(argc, argv, cmds, num_cmds);
+  int status;
+
+  if (!p)
+    return 1;
+
+  status = run_timed(p, argc, argv, ctx);
+  if (fflush(stdout)) {
+    fprintf(stderr, "write failure on standard output: %s", strerror(errno));
+    return 1;
+  }
+  return status & 0xff;
 }